@@ -1,6 +1,10 @@
 ﻿// Copyright (c) MissiveArts LLC
 
 #include "Supertalk.h"
+#include "SupertalkStats.h"
+#include "SupertalkUtilities.h"
+#include "Misc/CoreDelegates.h"
+#include "UObject/UObjectGlobals.h"
 
 #if !UE_BUILD_SHIPPING
 #include "MessageLogModule.h"
@@ -16,6 +20,15 @@ void FSupertalkModule::StartupModule()
 {
 	UE_LOG(LogSupertalk, Log, TEXT("Supertalk startup"));
 
+	// Cached properties may point into classes that no longer exist after reinstancing or a reload.
+	ReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([](EReloadCompleteReason) { FSupertalkUtilities::ResetPropertyCache(); });
+#if WITH_EDITOR
+	ObjectsReplacedHandle = FCoreUObjectDelegates::OnObjectsReplaced.AddLambda([](const TMap<UObject*, UObject*>&) { FSupertalkUtilities::ResetPropertyCache(); });
+#endif
+#if SUPERTALK_STATS_ENABLED
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FSupertalkStats::RecordFrame);
+#endif
+
 #if !UE_BUILD_SHIPPING
 	if (FModuleManager::Get().IsModuleLoaded("MessageLog"))
 	{
@@ -33,6 +46,15 @@ void FSupertalkModule::ShutdownModule()
 {
 	UE_LOG(LogSupertalk, Log, TEXT("Supertalk shutdown"));
 
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteHandle);
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectsReplaced.Remove(ObjectsReplacedHandle);
+#endif
+#if SUPERTALK_STATS_ENABLED
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+#endif
+	FSupertalkUtilities::ResetPropertyCache();
+
 #if !UE_BUILD_SHIPPING
 	if (FModuleManager::Get().IsModuleLoaded("MessageLog"))
 	{
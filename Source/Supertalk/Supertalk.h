@@ -13,4 +13,9 @@ SUPERTALK_API class FSupertalkModule : public IModuleInterface
 public:
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+	FDelegateHandle ReloadCompleteHandle;
+	FDelegateHandle ObjectsReplacedHandle;
+	FDelegateHandle EndFrameHandle;
 };
\ No newline at end of file
@@ -0,0 +1,22 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkCommandRegistry.h"
+
+void FSupertalkCommandRegistry::RegisterCommand(FName Name, FSupertalkCommandFunction Function)
+{
+	check(Name != NAME_None);
+	check(Function);
+
+	Commands.Add(Name, MakeShared<FSupertalkCommandFunction>(MoveTemp(Function)));
+}
+
+void FSupertalkCommandRegistry::UnregisterCommand(FName Name)
+{
+	Commands.Remove(Name);
+}
+
+TSharedPtr<const FSupertalkCommandFunction> FSupertalkCommandRegistry::FindCommand(FName Name) const
+{
+	const TSharedRef<const FSupertalkCommandFunction>* Command = Commands.Find(Name);
+	return Command ? TSharedPtr<const FSupertalkCommandFunction>(*Command) : nullptr;
+}
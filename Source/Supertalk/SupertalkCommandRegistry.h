@@ -0,0 +1,328 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SupertalkPlayer.h"
+#include "SupertalkValue.h"
+
+namespace SupertalkCommandPrivate
+{
+	FORCEINLINE FString ValueToString(const FSupertalkValue& Value)
+	{
+		return Value.GetType() == ESupertalkValueType::Text ? Value.GetText().ToString() : Value.ToInternalString();
+	}
+
+	// Converts a single script argument into a native parameter.
+	template<typename T, typename Enable = void>
+	struct TArgumentDecoder
+	{
+		static_assert(sizeof(T) == 0, "Unsupported Supertalk command parameter type.");
+	};
+
+	template<>
+	struct TArgumentDecoder<bool>
+	{
+		static bool Decode(const FSupertalkValue& Value, bool& Out)
+		{
+			switch (Value.GetType())
+			{
+			case ESupertalkValueType::Boolean:
+				Out = Value.GetBoolean();
+				return true;
+			case ESupertalkValueType::Number:
+				Out = Value.GetNumber() != 0.0;
+				return true;
+			case ESupertalkValueType::Text:
+				Out = FCString::ToBool(*Value.GetText().ToString());
+				return true;
+			default:
+				return false;
+			}
+		}
+	};
+
+	template<typename T>
+	struct TArgumentDecoder<T, typename TEnableIf<TIsArithmetic<T>::Value && !std::is_same_v<T, bool>>::Type>
+	{
+		static bool Decode(const FSupertalkValue& Value, T& Out)
+		{
+			switch (Value.GetType())
+			{
+			case ESupertalkValueType::Number:
+				{
+					// Converting NaN or a number that doesn't fit is undefined, integers have to be strictly below Max + 1
+					// since Max itself may not be representable as a double.
+					const double Number = Value.GetNumber();
+					if constexpr (std::is_integral_v<T>)
+					{
+						if (FMath::IsNaN(Number) || Number < static_cast<double>(TNumericLimits<T>::Lowest()) || Number >= static_cast<double>(TNumericLimits<T>::Max()) + 1.0)
+						{
+							return false;
+						}
+					}
+					else if (Number < static_cast<double>(TNumericLimits<T>::Lowest()) || Number > static_cast<double>(TNumericLimits<T>::Max()))
+					{
+						return false;
+					}
+
+					Out = static_cast<T>(Number);
+					return true;
+				}
+			case ESupertalkValueType::Boolean:
+				Out = Value.GetBoolean() ? 1 : 0;
+				return true;
+			case ESupertalkValueType::Text:
+				return LexTryParseString(Out, *Value.GetText().ToString());
+			default:
+				return false;
+			}
+		}
+	};
+
+	template<>
+	struct TArgumentDecoder<FString>
+	{
+		static bool Decode(const FSupertalkValue& Value, FString& Out)
+		{
+			Out = ValueToString(Value);
+			return !Value.IsNone();
+		}
+	};
+
+	template<>
+	struct TArgumentDecoder<FName>
+	{
+		static bool Decode(const FSupertalkValue& Value, FName& Out)
+		{
+			Out = Value.GetType() == ESupertalkValueType::Name ? Value.GetName() : FName(ValueToString(Value));
+			return !Value.IsNone();
+		}
+	};
+
+	template<>
+	struct TArgumentDecoder<FText>
+	{
+		static bool Decode(const FSupertalkValue& Value, FText& Out)
+		{
+			Out = Value.ToDisplayText();
+			return !Value.IsNone();
+		}
+	};
+
+	template<>
+	struct TArgumentDecoder<FSupertalkValue>
+	{
+		static bool Decode(const FSupertalkValue& Value, FSupertalkValue& Out)
+		{
+			Out = Value;
+			return true;
+		}
+	};
+
+	template<typename T>
+	struct TArgumentDecoder<T*, typename TEnableIf<TIsDerivedFrom<T, UObject>::Value>::Type>
+	{
+		static bool Decode(const FSupertalkValue& Value, T*& Out)
+		{
+			if (Value.GetType() == ESupertalkValueType::Object)
+			{
+				Out = Cast<T>(Value.GetObject());
+				return Out != nullptr || Value.GetObject() == nullptr;
+			}
+
+			// Object paths, same as what ImportText would accept.
+			const FString Path = ValueToString(Value);
+			if (Path.IsEmpty() || Path == TEXT("None"))
+			{
+				Out = nullptr;
+				return true;
+			}
+
+			Out = LoadObject<T>(nullptr, *Path);
+			return Out != nullptr;
+		}
+	};
+
+	// Parameters that aren't read from the script's arguments.
+	template<typename T>
+	struct TIsInjectedParameter
+	{
+		enum { Value = std::is_same_v<T, FSupertalkLatentFunctionFinalizer> || std::is_same_v<T, USupertalkPlayer*> };
+	};
+
+	template<typename T>
+	bool DecodeParameter(USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, int32& ArgumentIndex, T& Out, FString& OutError)
+	{
+		if constexpr (std::is_same_v<T, FSupertalkLatentFunctionFinalizer>)
+		{
+			// Taking a finalizer makes the command latent.
+			Out = Player.MakeLatentFunction();
+			return true;
+		}
+		else if constexpr (std::is_same_v<T, USupertalkPlayer*>)
+		{
+			Out = &Player;
+			return true;
+		}
+		else
+		{
+			const int32 Index = ArgumentIndex++;
+			if (!Arguments.IsValidIndex(Index))
+			{
+				OutError = FString::Printf(TEXT("missing argument %d"), Index + 1);
+				return false;
+			}
+
+			if (!TArgumentDecoder<T>::Decode(Arguments[Index], Out))
+			{
+				OutError = FString::Printf(TEXT("bad argument %d '%s'"), Index + 1, *Arguments[Index].ToInternalString());
+				return false;
+			}
+
+			return true;
+		}
+	}
+
+	template<typename... ParamTypes>
+	constexpr int32 CountScriptParameters()
+	{
+		return (0 + ... + (TIsInjectedParameter<ParamTypes>::Value ? 0 : 1));
+	}
+
+	template<typename FuncType>
+	struct TCommandTraits;
+
+	template<typename RetType, typename... ParamTypes>
+	struct TCommandTraits<RetType(*)(ParamTypes...)>
+	{
+		using FParameters = TTuple<std::decay_t<ParamTypes>...>;
+		static constexpr int32 NumParameters = sizeof...(ParamTypes);
+		static constexpr int32 NumScriptParameters = CountScriptParameters<std::decay_t<ParamTypes>...>();
+	};
+
+	template<typename UserClass, typename RetType, typename... ParamTypes>
+	struct TCommandTraits<RetType(UserClass::*)(ParamTypes...)>
+	{
+		using FClass = UserClass;
+		using FParameters = TTuple<std::decay_t<ParamTypes>...>;
+		static constexpr int32 NumParameters = sizeof...(ParamTypes);
+		static constexpr int32 NumScriptParameters = CountScriptParameters<std::decay_t<ParamTypes>...>();
+	};
+
+	template<typename UserClass, typename RetType, typename... ParamTypes>
+	struct TCommandTraits<RetType(UserClass::*)(ParamTypes...) const> : public TCommandTraits<RetType(UserClass::*)(ParamTypes...)>
+	{
+	};
+
+	template<typename ParametersType, uint32... Indices>
+	bool DecodeParameters(USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, ParametersType& Parameters, FString& OutError, TIntegerSequence<uint32, Indices...>)
+	{
+		int32 ArgumentIndex = 0;
+		return (true && ... && DecodeParameter(Player, Arguments, ArgumentIndex, Parameters.template Get<Indices>(), OutError));
+	}
+
+	template<typename Traits>
+	bool CheckArgumentCount(TConstArrayView<FSupertalkValue> Arguments, FString& OutError)
+	{
+		if (Arguments.Num() > Traits::NumScriptParameters)
+		{
+			OutError = FString::Printf(TEXT("expected %d arguments but got %d"), Traits::NumScriptParameters, Arguments.Num());
+			return false;
+		}
+
+		return true;
+	}
+}
+
+// A set of native commands that can be called from scripts. Commands are called directly, without going through UFunction
+// lookups or string parsing of their parameters, so they are the fastest way to expose something to scripts.
+// Registries can be shared between any number of players, see USupertalkPlayer::AddCommandRegistry.
+//
+// Supported parameter types are bool, numbers, FString, FName, FText, UObject pointers, and FSupertalkValue. A parameter of type
+// USupertalkPlayer* receives the player running the command. A parameter of type FSupertalkLatentFunctionFinalizer makes the
+// command latent - the script will wait until the finalizer is completed. Neither of these consume a script argument.
+class SUPERTALK_API FSupertalkCommandRegistry
+{
+public:
+	// Free functions or static member functions, i.e. RegisterCommand<&Wait>("Wait").
+	template<auto Func>
+	void RegisterCommand(FName Name)
+	{
+		using Traits = SupertalkCommandPrivate::TCommandTraits<decltype(Func)>;
+
+		RegisterCommand(Name, [](USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, FString& OutError)
+		{
+			typename Traits::FParameters Parameters;
+			if (!SupertalkCommandPrivate::CheckArgumentCount<Traits>(Arguments, OutError)
+				|| !SupertalkCommandPrivate::DecodeParameters(Player, Arguments, Parameters, OutError, TMakeIntegerSequence<uint32, Traits::NumParameters>()))
+			{
+				return false;
+			}
+
+			Parameters.ApplyAfter(Func);
+			return true;
+		});
+	}
+
+	// Member functions, i.e. RegisterCommand<&UMyCutscene::MoveActor>("Move", Cutscene).
+	// UObjects are held weakly, anything else must outlive the registration.
+	template<auto Func>
+	void RegisterCommand(FName Name, typename SupertalkCommandPrivate::TCommandTraits<decltype(Func)>::FClass* Object)
+	{
+		using Traits = SupertalkCommandPrivate::TCommandTraits<decltype(Func)>;
+		using UserClass = typename Traits::FClass;
+
+		check(Object);
+
+		auto Invoke = [](UserClass* Target, USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, FString& OutError)
+		{
+			typename Traits::FParameters Parameters;
+			if (!SupertalkCommandPrivate::CheckArgumentCount<Traits>(Arguments, OutError)
+				|| !SupertalkCommandPrivate::DecodeParameters(Player, Arguments, Parameters, OutError, TMakeIntegerSequence<uint32, Traits::NumParameters>()))
+			{
+				return false;
+			}
+
+			Parameters.ApplyAfter(Func, Target);
+			return true;
+		};
+
+		if constexpr (TIsDerivedFrom<UserClass, UObject>::Value)
+		{
+			RegisterCommand(Name, [WeakObject = TWeakObjectPtr<UserClass>(Object), Invoke](USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, FString& OutError)
+			{
+				UserClass* Target = WeakObject.Get();
+				if (Target == nullptr)
+				{
+					OutError = TEXT("the object this command was registered with no longer exists");
+					return false;
+				}
+
+				return Invoke(Target, Player, Arguments, OutError);
+			});
+		}
+		else
+		{
+			RegisterCommand(Name, [Object, Invoke](USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, FString& OutError)
+			{
+				return Invoke(Object, Player, Arguments, OutError);
+			});
+		}
+	}
+
+	void RegisterCommand(FName Name, FSupertalkCommandFunction Function);
+	void UnregisterCommand(FName Name);
+
+	// Shared so that a command can register or unregister commands (itself included) while it's being called.
+	TSharedPtr<const FSupertalkCommandFunction> FindCommand(FName Name) const;
+
+private:
+	TMap<FName, TSharedRef<const FSupertalkCommandFunction>> Commands;
+};
+
+template<auto Func, typename... ObjectTypes>
+void USupertalkPlayer::RegisterCommand(FName Name, ObjectTypes*... Objects)
+{
+	GetCommandRegistry().template RegisterCommand<Func>(Name, Objects...);
+}
@@ -3,83 +3,71 @@
 #include "SupertalkExpression.h"
 #include "SupertalkValue.h"
 #include "SupertalkPlayer.h"
+#include "SupertalkStats.h"
 
-const USupertalkValue* ResolveExpression(USupertalkPlayer* Player, USupertalkExpression* Expr)
+FSupertalkValue ResolveExpression(USupertalkPlayer* Player, int32 Binding, USupertalkExpression* Expr)
 {
 	if (IsValid(Expr))
 	{
-		const USupertalkValue* Value = Expr->Evaluate(Player);
-		if (IsValid(Value))
-		{
-			return Value->GetResolvedValue(Player);
-		}
+		return Expr->Evaluate(Player, Binding);
 	}
 
-	return nullptr;
+	return FSupertalkValue();
 }
 
-const USupertalkValue* USupertalkExpression_Value::Evaluate(USupertalkPlayer* Player)
+FSupertalkValue USupertalkExpression_Value::Evaluate(USupertalkPlayer* Player, int32 Binding)
 {
-	return Value;
+	SUPERTALK_STAT_INC(ExpressionsEvaluated);
+
+	if (IsValid(Value))
+	{
+		SUPERTALK_STAT_INC(ValuesResolved);
+		return Value->Resolve(Player, Binding);
+	}
+
+	return FSupertalkValue();
 }
 
-const USupertalkValue* USupertalkExpression_Equality::Evaluate(USupertalkPlayer* Player)
+FSupertalkValue USupertalkExpression_Equality::Evaluate(USupertalkPlayer* Player, int32 Binding)
 {
+	SUPERTALK_STAT_INC(ExpressionsEvaluated);
+
 	if (SubExpressions.Num() == 0)
 	{
-		return nullptr;
+		return FSupertalkValue();
 	}
 
 	check(SubExpressions.Num() == Operations.Num() + 1);
-	const USupertalkValue* Result = ResolveExpression(Player, SubExpressions[0]);
+	FSupertalkValue Result = ResolveExpression(Player, Binding, SubExpressions[0]);
 	for (int32 Idx = 1; Idx < SubExpressions.Num(); ++Idx)
 	{
-		USupertalkBooleanValue* BoolResult = NewObject<USupertalkBooleanValue>(Player);
-		if (IsValid(Result))
-		{
-			BoolResult->bValue = Result->IsValueEqualTo(ResolveExpression(Player, SubExpressions[Idx]));
-		}
-		else
-		{
-			BoolResult->bValue = !ResolveExpression(Player, SubExpressions[Idx]);
-		}
-
+		bool bResult = Result.IsValueEqualTo(ResolveExpression(Player, Binding, SubExpressions[Idx]));
 		if (Operations[Idx - 1] == ESupertalkExpression_Equality_Operation::NotEqual)
 		{
-			BoolResult->bValue = !BoolResult->bValue;
+			bResult = !bResult;
 		}
 
-		Result = BoolResult;
+		Result = FSupertalkValue::MakeBoolean(bResult);
 	}
 
 	return Result;
 }
 
-const USupertalkValue* USupertalkExpression_Not::Evaluate(USupertalkPlayer* Player)
+FSupertalkValue USupertalkExpression_Not::Evaluate(USupertalkPlayer* Player, int32 Binding)
 {
-	const USupertalkValue* EvaluatedValue = IsValid(Value) ? Value->Evaluate(Player) : nullptr;
-	EvaluatedValue = EvaluatedValue ? EvaluatedValue->GetResolvedValue(Player) : nullptr;
+	SUPERTALK_STAT_INC(ExpressionsEvaluated);
+
+	FSupertalkValue EvaluatedValue = ResolveExpression(Player, Binding, Value);
 
 	bool Result;
-	if (EvaluatedValue)
+	if (EvaluatedValue.IsBoolean())
 	{
-		if (const USupertalkBooleanValue* BoolValue = Cast<USupertalkBooleanValue>(EvaluatedValue))
-		{
-			Result = BoolValue->bValue;
-		}
-		else
-		{
-			Result = true;
-		}
+		Result = EvaluatedValue.GetBoolean();
 	}
 	else
 	{
-		Result = false;
+		Result = !EvaluatedValue.IsNone();
 	}
 
-	Result = !Result;
-	
-	USupertalkBooleanValue* ResultValue = NewObject<USupertalkBooleanValue>(Player);
-	ResultValue->bValue = Result;
-	return ResultValue;
+	return FSupertalkValue::MakeBoolean(!Result);
 }
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SupertalkValue.h"
 #include "SupertalkExpression.generated.h"
 
 UCLASS(Abstract)
@@ -11,7 +12,9 @@ class SUPERTALK_API USupertalkExpression : public UObject
 	GENERATED_BODY()
 
 public:
-	virtual const class USupertalkValue* Evaluate(class USupertalkPlayer* Player) PURE_VIRTUAL(USupertalkExpression::Evaluate,return nullptr;)
+	// Binding is Player's binding for the script this expression is in (see FSupertalkInstructionContext), or INDEX_NONE
+	// to look variables up by name.
+	virtual FSupertalkValue Evaluate(class USupertalkPlayer* Player, int32 Binding) PURE_VIRTUAL(USupertalkExpression::Evaluate,return FSupertalkValue();)
 };
 
 UCLASS()
@@ -23,7 +26,7 @@ public:
 	UPROPERTY()
 	TObjectPtr<class USupertalkValue> Value;
 	
-	virtual const USupertalkValue* Evaluate(class USupertalkPlayer* Player) override;
+	virtual FSupertalkValue Evaluate(class USupertalkPlayer* Player, int32 Binding) override;
 };
 
 UENUM()
@@ -45,7 +48,7 @@ public:
 	UPROPERTY()
 	TArray<ESupertalkExpression_Equality_Operation> Operations;
 
-	virtual const class USupertalkValue* Evaluate(class USupertalkPlayer* Player) override;
+	virtual FSupertalkValue Evaluate(class USupertalkPlayer* Player, int32 Binding) override;
 };
 
 UCLASS()
@@ -57,5 +60,5 @@ public:
 	UPROPERTY()
 	TObjectPtr<USupertalkExpression> Value;
 
-	virtual const class USupertalkValue* Evaluate(USupertalkPlayer* Player) override;
+	virtual FSupertalkValue Evaluate(USupertalkPlayer* Player, int32 Binding) override;
 };
\ No newline at end of file
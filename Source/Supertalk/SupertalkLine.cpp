@@ -9,15 +9,16 @@
 FText FSupertalkLine::GetSpeakerName(const USupertalkPlayer* Player) const
 {
 	check(Player);
-	
+
+	const int32 Binding = Script ? Player->FindBinding(Script) : INDEX_NONE;
 	if (IsValid(SpeakerNameOverride))
 	{
-		return SpeakerNameOverride->ToResolvedDisplayText(Player);
+		return SpeakerNameOverride->ToResolvedDisplayText(Player, Binding);
 	}
 
 	if (IsValid(Speaker))
 	{
-		return Speaker->ToResolvedDisplayText(Player);
+		return Speaker->ToResolvedDisplayText(Player, Binding);
     }
 
 	return FText();
@@ -25,5 +26,38 @@ FText FSupertalkLine::GetSpeakerName(const USupertalkPlayer* Player) const
 
 FText FSupertalkLine::FormatText(const USupertalkPlayer* Player) const
 {
-	return FSupertalkUtilities::FormatText(Text, Player, true);
+	if (!bHasFormatArguments)
+	{
+		return FSupertalkUtilities::FormatText(Text, Player, true);
+	}
+
+	if (!CachedFormat.IsSet())
+	{
+		CachedFormat.Emplace(Text);
+	}
+
+	// Looked up once per line rather than for every placeholder.
+	const int32 Binding = Script ? Player->FindBinding(Script) : INDEX_NONE;
+	return FSupertalkUtilities::FormatText(CachedFormat.GetValue(), FormatArguments, Player, Binding, true);
+}
+
+void FSupertalkLine::CompileFormat(USupertalkScript* InScript)
+{
+	FormatArguments.Reset();
+	FSupertalkUtilities::GetFormatArguments(Text, FormatArguments, InScript);
+	Script = InScript;
+	bHasFormatArguments = true;
+	CachedFormat.Reset();
+}
+
+void FSupertalkLine::PostSerialize(const FArchive& Ar)
+{
+	if (Ar.IsLoading())
+	{
+		CachedFormat.Reset();
+		if (!bHasFormatArguments)
+		{
+			CompileFormat();
+		}
+	}
 }
@@ -14,6 +14,27 @@ struct SUPERTALK_API FSupertalkAttribute
 	FName Name;
 };
 
+// A placeholder in formatted text, i.e. {Variable} or {Variable.Member}.
+USTRUCT()
+struct SUPERTALK_API FSupertalkFormatArgument
+{
+	GENERATED_BODY()
+
+	// The placeholder as written. This is the argument name and is also displayed if the variable can't be resolved.
+	UPROPERTY()
+	FString Placeholder;
+
+	UPROPERTY()
+	FName Variable;
+
+	UPROPERTY()
+	TArray<FName> Members;
+
+	// Index into USupertalkScript::Variables, INDEX_NONE if the placeholder wasn't compiled with a script.
+	UPROPERTY()
+	int32 VariableSlot = INDEX_NONE;
+};
+
 USTRUCT(BlueprintType)
 struct SUPERTALK_API FSupertalkLine
 {
@@ -23,7 +44,9 @@ struct SUPERTALK_API FSupertalkLine
 	{
 		Speaker = nullptr;
 		SpeakerNameOverride = nullptr;
+		Script = nullptr;
 		bIsBlankLine = false;
+		bHasFormatArguments = false;
 	}
 
 	UPROPERTY()
@@ -43,6 +66,36 @@ struct SUPERTALK_API FSupertalkLine
 	UPROPERTY()
 	uint32 bIsBlankLine : 1;
 
+	// Placeholders in Text, parsed when the script is compiled so that formatting only has to resolve them.
+	UPROPERTY()
+	TArray<FSupertalkFormatArgument> FormatArguments;
+
+	// False for lines compiled before format arguments were stored, these are compiled when loaded.
+	UPROPERTY()
+	uint32 bHasFormatArguments : 1;
+
+	// The script that this line's variable slots belong to, null if they don't have slots.
+	UPROPERTY()
+	TObjectPtr<const class USupertalkScript> Script;
+
 	FText GetSpeakerName(const class USupertalkPlayer* Player) const;
 	FText FormatText(const class USupertalkPlayer* Player) const;
+
+	// Must be called whenever Text is modified. If InScript is set, placeholders are given variable slots in it.
+	void CompileFormat(class USupertalkScript* InScript = nullptr);
+
+	void PostSerialize(const FArchive& Ar);
+
+private:
+	// Built the first time the line is formatted. FTextFormat recompiles itself if the text is relocalized.
+	mutable TOptional<FTextFormat> CachedFormat;
+};
+
+template<>
+struct TStructOpsTypeTraits<FSupertalkLine> : public TStructOpsTypeTraitsBase2<FSupertalkLine>
+{
+	enum
+	{
+		WithPostSerialize = true,
+	};
 };
\ No newline at end of file
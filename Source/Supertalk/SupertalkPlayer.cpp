@@ -2,11 +2,23 @@
 
 #include "SupertalkPlayer.h"
 #include "Supertalk.h"
+#include "SupertalkCommandRegistry.h"
 #include "SupertalkExpression.h"
+#include "SupertalkStats.h"
+#include "SupertalkSubsystem.h"
+#include "SupertalkTrace.h"
 #include "SupertalkUtilities.h"
 #include "SupertalkValue.h"
 #include "EditorFramework/AssetImportData.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Logging/MessageLog.h"
+#include "Serialization/ArchiveProxy.h"
+#include "Serialization/ArchiveUObject.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/SoftObjectPath.h"
+#include "UObject/SoftObjectPtr.h"
 #include "UObject/ObjectSaveContext.h"
 
 #define LOCTEXT_NAMESPACE "Supertalk"
@@ -99,6 +111,446 @@ void USupertalkScript::Serialize(FArchive& Ar)
 }
 #endif
 
+bool FSupertalkProgram::FindSection(int32 Instruction, FName& OutSection, int32& OutOffset) const
+{
+	// Sections are laid out one after another so this is the closest entry before the instruction.
+	int32 BestEntry = INDEX_NONE;
+	for (const TPair<FName, int32>& Entry : SectionEntries)
+	{
+		if (Entry.Value <= Instruction && Entry.Value > BestEntry)
+		{
+			BestEntry = Entry.Value;
+			OutSection = Entry.Key;
+		}
+	}
+
+	OutOffset = Instruction - BestEntry;
+	return BestEntry != INDEX_NONE;
+}
+
+void FSupertalkProgram::Reset()
+{
+	Instructions.Reset();
+	Targets.Reset();
+	SectionEntries.Reset();
+}
+
+void FSupertalkDependencyManifest::GetAssets(FName Section, TArray<FSoftObjectPath>& OutAssets) const
+{
+	if (Section == NAME_None)
+	{
+		OutAssets.Append(Assets);
+		return;
+	}
+
+	if (const FSupertalkSectionDependencies* SectionDependencies = Sections.Find(Section))
+	{
+		OutAssets.Reserve(OutAssets.Num() + SectionDependencies->Assets.Num());
+		for (int32 Idx : SectionDependencies->Assets)
+		{
+			OutAssets.Add(Assets[Idx]);
+		}
+	}
+}
+
+void FSupertalkDependencyManifest::Reset()
+{
+	Assets.Reset();
+	Sections.Reset();
+}
+
+namespace
+{
+	// Finds the assets referenced by an instruction by serializing its params and every object inside the script that
+	// they reference.
+	class FSupertalkDependencyCollector : public FArchiveUObject
+	{
+	public:
+		FSupertalkDependencyCollector(const USupertalkScript* InScript, TArray<FSoftObjectPath>& InAssets)
+			: Script(InScript)
+			, Assets(InAssets)
+		{
+			ArIsObjectReferenceCollector = true;
+			ArIgnoreOuterRef = true;
+			ArIgnoreClassRef = true;
+		}
+
+		void Collect(UObject* Object)
+		{
+			*this << Object;
+		}
+
+		virtual FArchive& operator<<(UObject*& Object) override
+		{
+			if (Object == nullptr)
+			{
+				return *this;
+			}
+
+			if (Object->IsIn(Script))
+			{
+				bool bAlreadyVisited;
+				Visited.Add(Object, &bAlreadyVisited);
+				if (!bAlreadyVisited)
+				{
+					Object->Serialize(*this);
+				}
+			}
+			else if (!Object->GetOutermost()->HasAnyPackageFlags(PKG_CompiledIn))
+			{
+				Assets.AddUnique(FSoftObjectPath(Object));
+			}
+
+			return *this;
+		}
+
+		virtual FArchive& operator<<(FSoftObjectPath& Value) override
+		{
+			if (Value.IsValid())
+			{
+				Assets.AddUnique(Value);
+			}
+
+			return *this;
+		}
+
+		virtual FArchive& operator<<(FSoftObjectPtr& Value) override
+		{
+			FSoftObjectPath Path = Value.ToSoftObjectPath();
+			return *this << Path;
+		}
+
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FSupertalkDependencyCollector");
+		}
+
+	private:
+		const USupertalkScript* Script;
+		TArray<FSoftObjectPath>& Assets;
+		TSet<UObject*> Visited;
+	};
+
+	struct FSupertalkProgramBuilder
+	{
+		FSupertalkProgramBuilder(const USupertalkScript* InScript, FSupertalkProgram& InProgram)
+			: Script(InScript), Program(InProgram)
+		{
+		}
+
+		const USupertalkScript* Script;
+		FSupertalkProgram& Program;
+
+		// Gotos that need to be pointed at the entry of a section once all sections have been emitted.
+		TArray<TTuple<int32, FName>> SectionJumps;
+
+		// First and one past the last instruction of each section.
+		TMap<FName, TTuple<int32, int32>> SectionRanges;
+
+		// Source line of the action currently being emitted.
+		int32 SourceLine = INDEX_NONE;
+
+		int32 Emit(ESupertalkOpCode OpCode, USupertalkOperationParams* Params = nullptr)
+		{
+			FSupertalkInstruction& Instruction = Program.Instructions.AddDefaulted_GetRef();
+			Instruction.OpCode = OpCode;
+			Instruction.Params = Params;
+			Instruction.SourceLine = SourceLine;
+			return Program.Instructions.Num() - 1;
+		}
+
+		int32 EmitGoto(int32 Target = INDEX_NONE)
+		{
+			const int32 Idx = Emit(ESupertalkOpCode::Goto);
+			Program.Instructions[Idx].Operand = Target;
+			return Idx;
+		}
+
+		// Reserves a jump table for an instruction, returns the index of the first target.
+		int32 AddTargets(int32 InstructionIdx, int32 Count)
+		{
+			FSupertalkInstruction& Instruction = Program.Instructions[InstructionIdx];
+			Instruction.Operand = Program.Targets.Num();
+			Instruction.NumTargets = Count;
+			Program.Targets.AddUninitialized(Count);
+			return Instruction.Operand;
+		}
+
+		FORCEINLINE int32 Here() const
+		{
+			return Program.Instructions.Num();
+		}
+
+		void EmitSection(const FSupertalkSection& Section)
+		{
+			const int32 Entry = Here();
+			Program.SectionEntries.Add(Section.Name, Entry);
+			for (const FSupertalkAction& Action : Section.Actions)
+			{
+				EmitAction(Action);
+			}
+
+			// There is no fall-through between sections.
+			Emit(ESupertalkOpCode::End);
+
+			SectionRanges.Add(Section.Name, TTuple<int32, int32>(Entry, Here()));
+		}
+
+		void EmitAction(const FSupertalkAction& Action)
+		{
+			TGuardValue<int32> SourceLineGuard(SourceLine, Action.SourceLine != INDEX_NONE ? Action.SourceLine : SourceLine);
+
+			switch (Action.Operation)
+			{
+			default:
+				checkNoEntry();
+				// fall-through on purpose, count this as a no-op if checks are disabled.
+
+			case ESupertalkOperation::Noop:
+				break;
+
+			case ESupertalkOperation::Line:
+				Emit(ESupertalkOpCode::Line, Action.Params);
+				break;
+
+			case ESupertalkOperation::Choice:
+				EmitChoice(CastChecked<USupertalkPlayChoiceParams>(Action.Params));
+				break;
+
+			case ESupertalkOperation::Assign:
+				Emit(ESupertalkOpCode::Assign, Action.Params);
+				break;
+
+			case ESupertalkOperation::Call:
+				Emit(ESupertalkOpCode::Call, Action.Params);
+				break;
+
+			case ESupertalkOperation::Jump:
+				{
+					const USupertalkJumpParams* Params = CastChecked<USupertalkJumpParams>(Action.Params);
+					if (Params->JumpTarget == NAME_None)
+					{
+						// Forcefully end this stack
+						Emit(ESupertalkOpCode::End);
+					}
+					else
+					{
+						SectionJumps.Add(TTuple<int32, FName>(EmitGoto(), Params->JumpTarget));
+					}
+				}
+				break;
+
+			case ESupertalkOperation::Parallel:
+				EmitParallel(CastChecked<USupertalkParallelParams>(Action.Params));
+				break;
+
+			case ESupertalkOperation::Queue:
+				for (const FSupertalkAction& SubAction : CastChecked<USupertalkQueueParams>(Action.Params)->SubActions)
+				{
+					EmitAction(SubAction);
+				}
+				break;
+
+			case ESupertalkOperation::Conditional:
+				EmitConditional(CastChecked<USupertalkConditionalParams>(Action.Params));
+				break;
+			}
+		}
+
+		void EmitChoice(USupertalkPlayChoiceParams* Params)
+		{
+			check(Params->Choices.Num() > 0);
+
+			// Layout: Choice, [choice body, goto continuation]..., continuation
+			// The last target of a choice is the continuation, used when no choice is made.
+			const int32 ChoiceIdx = Emit(ESupertalkOpCode::Choice, Params);
+			const int32 FirstTarget = AddTargets(ChoiceIdx, Params->Choices.Num() + 1);
+
+			TArray<int32, TInlineAllocator<8>> ContinuationGotos;
+			TArray<int32, TInlineAllocator<8>> EmptyChoices;
+			for (int32 Idx = 0; Idx < Params->Choices.Num(); ++Idx)
+			{
+				const FSupertalkAction& SubAction = Params->Choices[Idx].SubAction;
+				if (SubAction.Operation == ESupertalkOperation::Noop)
+				{
+					EmptyChoices.Add(Idx);
+					continue;
+				}
+
+				Program.Targets[FirstTarget + Idx] = Here();
+				EmitAction(SubAction);
+				ContinuationGotos.Add(EmitGoto());
+			}
+
+			const int32 Continuation = Here();
+			for (int32 Idx : EmptyChoices)
+			{
+				Program.Targets[FirstTarget + Idx] = Continuation;
+			}
+
+			for (int32 Idx : ContinuationGotos)
+			{
+				Program.Instructions[Idx].Operand = Continuation;
+			}
+
+			Program.Targets[FirstTarget + Params->Choices.Num()] = Continuation;
+		}
+
+		void EmitParallel(USupertalkParallelParams* Params)
+		{
+			if (Params->SubActions.Num() == 0)
+			{
+				UE_LOG(LogSupertalk, Warning, TEXT("Parallel action with no subactions in script '%s', skipped"), *Script->GetName());
+				return;
+			}
+
+			// Layout: Parallel, [branch, end]..., continuation
+			const int32 ParallelIdx = Emit(ESupertalkOpCode::Parallel, Params);
+			const int32 FirstTarget = AddTargets(ParallelIdx, Params->SubActions.Num() + 1);
+			for (int32 Idx = 0; Idx < Params->SubActions.Num(); ++Idx)
+			{
+				Program.Targets[FirstTarget + Idx] = Here();
+				EmitAction(Params->SubActions[Idx]);
+				Emit(ESupertalkOpCode::End);
+			}
+
+			Program.Targets[FirstTarget + Params->SubActions.Num()] = Here();
+		}
+
+		void EmitConditional(USupertalkConditionalParams* Params)
+		{
+			// Layout: Branch, true body, [goto end, false body], end
+			const int32 BranchIdx = Emit(ESupertalkOpCode::Branch, Params);
+			const int32 FirstTarget = AddTargets(BranchIdx, 2);
+
+			EmitAction(Params->TrueAction);
+
+			if (Params->FalseAction.Operation != ESupertalkOperation::Noop)
+			{
+				const int32 EndGoto = EmitGoto();
+				Program.Targets[FirstTarget] = Here();
+				EmitAction(Params->FalseAction);
+				Program.Instructions[EndGoto].Operand = Here();
+			}
+			else
+			{
+				Program.Targets[FirstTarget] = Here();
+			}
+
+			Program.Targets[FirstTarget + 1] = Here();
+		}
+
+		void ResolveSectionJumps()
+		{
+			for (const TTuple<int32, FName>& Jump : SectionJumps)
+			{
+				if (const int32* Entry = Program.SectionEntries.Find(Jump.Value))
+				{
+					Program.Instructions[Jump.Key].Operand = *Entry;
+				}
+				else
+				{
+					UE_LOG(LogSupertalk, Error, TEXT("Cannot jump to unknown section '%s' in script '%s'"), *Jump.Value.ToString(), *Script->GetName());
+					Program.Instructions[Jump.Key].OpCode = ESupertalkOpCode::End;
+				}
+			}
+		}
+
+		void BuildDependencies(FSupertalkDependencyManifest& Manifest) const
+		{
+			Manifest.Reset();
+
+			// Assets referenced directly by each section.
+			TMap<FName, TArray<int32>> DirectAssets;
+			for (const TPair<FName, TTuple<int32, int32>>& Range : SectionRanges)
+			{
+				TArray<FSoftObjectPath> SectionAssets;
+				FSupertalkDependencyCollector Collector(Script, SectionAssets);
+				for (int32 Idx = Range.Value.Get<0>(); Idx < Range.Value.Get<1>(); ++Idx)
+				{
+					Collector.Collect(Program.Instructions[Idx].Params);
+				}
+
+				TArray<int32>& Indices = DirectAssets.Add(Range.Key);
+				for (const FSoftObjectPath& Asset : SectionAssets)
+				{
+					Indices.Add(Manifest.Assets.AddUnique(Asset));
+				}
+			}
+
+			// Sections each section can jump to.
+			TMultiMap<FName, FName> Edges;
+			for (const TTuple<int32, FName>& Jump : SectionJumps)
+			{
+				for (const TPair<FName, TTuple<int32, int32>>& Range : SectionRanges)
+				{
+					if (Jump.Key >= Range.Value.Get<0>() && Jump.Key < Range.Value.Get<1>())
+					{
+						Edges.AddUnique(Range.Key, Jump.Value);
+						break;
+					}
+				}
+			}
+
+			for (const TPair<FName, TTuple<int32, int32>>& Range : SectionRanges)
+			{
+				TArray<int32>& Indices = Manifest.Sections.Add(Range.Key).Assets;
+
+				TSet<FName> Reachable;
+				TArray<FName, TInlineAllocator<8>> Open;
+				Open.Add(Range.Key);
+				while (Open.Num() > 0)
+				{
+					const FName Section = Open.Pop(false);
+					bool bAlreadyReachable;
+					Reachable.Add(Section, &bAlreadyReachable);
+					if (bAlreadyReachable)
+					{
+						continue;
+					}
+
+					if (const TArray<int32>* Direct = DirectAssets.Find(Section))
+					{
+						for (int32 Idx : *Direct)
+						{
+							Indices.AddUnique(Idx);
+						}
+					}
+
+					Edges.MultiFind(Section, Open);
+				}
+			}
+		}
+	};
+}
+
+void USupertalkScript::CompileProgram()
+{
+	Program.Reset();
+
+	FSupertalkProgramBuilder Builder(this, Program);
+	for (const TPair<FName, FSupertalkSection>& Section : Sections)
+	{
+		Builder.EmitSection(Section.Value);
+	}
+
+	Builder.ResolveSectionJumps();
+	Builder.BuildDependencies(Dependencies);
+
+	Program.Instructions.Shrink();
+	Program.Targets.Shrink();
+}
+
+void USupertalkScript::PostLoad()
+{
+	Super::PostLoad();
+
+	if (GetLinkerCustomVersion(FSupertalkScriptCustomVersion::GUID) < FSupertalkScriptCustomVersion::DependencyManifest || (Program.IsEmpty() && Sections.Num() > 0))
+	{
+		CompileProgram();
+	}
+}
+
 void USupertalkAssignParams::PostLoad()
 {
 	Super::PostLoad();
@@ -141,69 +593,442 @@ void USupertalkConditionalParams::PostLoad()
 	}
 }
 
+namespace
+{
+	// Splits a command into the function name and the rest of the arguments.
+	void SplitCommand(const FString& Command, FName& OutFunctionName, FString& OutArguments)
+	{
+		const TCHAR* Str = *Command;
+		FString Name;
+		FParse::Token(Str, Name, true);
+
+		OutFunctionName = FName(Name);
+		OutArguments = FString(Str).TrimStart();
+	}
+
+	// Splits arguments the same way as ImportFunctionParameters, but without knowing the parameter types.
+	template<typename AllocatorType>
+	void TokenizeArguments(const FString& Args, TArray<FSupertalkValue, AllocatorType>& OutArguments)
+	{
+		const TCHAR* Str = *Args;
+		FString Token;
+		while (FParse::Token(Str, Token, true))
+		{
+			OutArguments.Add(FSupertalkValue::MakeText(FText::FromString(Token)));
+		}
+	}
+
+	bool IsFunctionParameter(const FProperty* Property)
+	{
+		return (Property->PropertyFlags & (CPF_Parm | CPF_ReturnParm)) == CPF_Parm;
+	}
+
+	void InitializeFunctionParameters(UFunction* Function, uint8* Parms)
+	{
+		FMemory::Memzero(Parms, Function->ParmsSize);
+		for (TFieldIterator<FProperty> It(Function); It && It->HasAnyPropertyFlags(CPF_Parm); ++It)
+		{
+			It->InitializeValue_InContainer(Parms);
+		}
+	}
+
+	void DestroyFunctionParameters(UFunction* Function, uint8* Parms)
+	{
+		for (TFieldIterator<FProperty> It(Function); It && It->HasAnyPropertyFlags(CPF_Parm); ++It)
+		{
+			It->DestroyValue_InContainer(Parms);
+		}
+	}
+
+	void CopyFunctionParameters(UFunction* Function, uint8* Dest, const uint8* Src)
+	{
+		for (TFieldIterator<FProperty> It(Function); It && It->HasAnyPropertyFlags(CPF_Parm); ++It)
+		{
+			It->CopyCompleteValue_InContainer(Dest, Src);
+		}
+	}
+
+	// Reads arguments the same way UObject::CallFunctionByNameWithArguments does so that existing commands keep working, except
+	// that missing arguments aren't filled in from default values, which only exist in editor builds.
+	bool ImportFunctionParameters(UFunction* Function, const TCHAR* Str, uint8* Parms, UObject* Owner, FString& OutError)
+	{
+		FProperty* LastParameter = nullptr;
+		for (TFieldIterator<FProperty> It(Function); It && IsFunctionParameter(*It); ++It)
+		{
+			LastParameter = *It;
+		}
+
+		for (TFieldIterator<FProperty> It(Function); It && IsFunctionParameter(*It); ++It)
+		{
+			FProperty* Param = *It;
+
+			const TCHAR* RemainingStr = Str;
+			FString ArgStr;
+			FParse::Token(Str, ArgStr, true);
+
+			// A string as the last parameter receives everything that's left, quotes and all.
+			if (Param == LastParameter && Param->IsA<FStrProperty>() && *Str != TCHAR('\0'))
+			{
+				ArgStr = FString(RemainingStr).TrimStart();
+			}
+
+			if (Param->ImportText_Direct(*ArgStr, Param->ContainerPtrToValuePtr<uint8>(Parms), Owner, PPF_Localized) == nullptr)
+			{
+				OutError = FString::Printf(TEXT("bad or missing argument '%s'"), *Param->GetName());
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Writes already evaluated arguments directly into the parameters, in order.
+	bool ExportFunctionParameters(UFunction* Function, TConstArrayView<FSupertalkValue> Arguments, uint8* Parms, UObject* Owner, FString& OutError)
+	{
+		int32 ArgumentIndex = 0;
+		for (TFieldIterator<FProperty> It(Function); It && IsFunctionParameter(*It); ++It)
+		{
+			FProperty* Param = *It;
+			void* ValuePtr = Param->ContainerPtrToValuePtr<void>(Parms);
+
+			// Default values for parameters are only kept as editor metadata, so they can't be used here without a command
+			// behaving differently in a packaged game.
+			if (!Arguments.IsValidIndex(ArgumentIndex))
+			{
+				OutError = FString::Printf(TEXT("missing argument '%s'"), *Param->GetName());
+				return false;
+			}
+
+			const FSupertalkValue& Argument = Arguments[ArgumentIndex++];
+			if (!Argument.ExportToProperty(ValuePtr, Owner, Param))
+			{
+				OutError = FString::Printf(TEXT("bad argument '%s' for '%s'"), *Argument.ToInternalString(), *Param->GetName());
+				return false;
+			}
+		}
+
+		if (ArgumentIndex < Arguments.Num())
+		{
+			OutError = FString::Printf(TEXT("expected %d arguments but got %d"), ArgumentIndex, Arguments.Num());
+			return false;
+		}
+
+		return true;
+	}
+
+	constexpr uint8 PlayerStateVersion = 1;
+
+	// Counts read back from saved state are checked against the bytes left in the archive before anything is allocated for
+	// them, so that corrupt data can't ask for more memory than it has bytes. Archives that don't know their size get this
+	// as a limit instead.
+	constexpr int64 MaxPlayerStateSize = 64 * 1024 * 1024;
+
+	bool FitsInArchive(FArchive& Ar, int64 Count)
+	{
+		const int64 TotalSize = Ar.TotalSize();
+		return Count >= 0 && Count <= (TotalSize >= 0 ? TotalSize - Ar.Tell() : MaxPlayerStateSize);
+	}
+
+	// Reads a string the same way FString's serializer does, after checking that its length fits in the archive.
+	void SerializeStateString(FArchive& Ar, FString& String)
+	{
+		const int64 Start = Ar.Tell();
+		int32 SaveNum = 0;
+		Ar << SaveNum;
+
+		const int64 NumBytes = SaveNum < 0 ? -static_cast<int64>(SaveNum) * sizeof(UCS2CHAR) : SaveNum;
+		if (Ar.IsError() || !FitsInArchive(Ar, NumBytes))
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Ar.Seek(Start);
+		Ar << String;
+	}
+
+	// Used for saved player state. Names are written as indices into a table that's saved separately, objects are written
+	// as paths.
+	class FSupertalkStateArchive : public FArchiveProxy
+	{
+	public:
+		FSupertalkStateArchive(FArchive& InInnerArchive, TArray<FName>& InNames)
+			: FArchiveProxy(InInnerArchive)
+			, Names(InNames)
+		{
+			// Strings in values (like the ones in texts) can't be longer than the saved state.
+			if (IsLoading())
+			{
+				ArMaxSerializeSize = InInnerArchive.TotalSize();
+			}
+
+			for (int32 Idx = 0; Idx < Names.Num(); ++Idx)
+			{
+				NameIndices.Add(Names[Idx], Idx);
+			}
+		}
+
+		virtual FArchive& operator<<(FName& Name) override
+		{
+			uint32 Index = 0;
+			if (IsLoading())
+			{
+				InnerArchive.SerializeIntPacked(Index);
+				if (Names.IsValidIndex(Index))
+				{
+					Name = Names[Index];
+				}
+				else
+				{
+					Name = NAME_None;
+					SetError();
+				}
+			}
+			else
+			{
+				const int32* Existing = NameIndices.Find(Name);
+				Index = Existing ? *Existing : NameIndices.Add(Name, Names.Add(Name));
+				InnerArchive.SerializeIntPacked(Index);
+			}
+
+			return *this;
+		}
+
+		virtual FArchive& operator<<(UObject*& Object) override
+		{
+			FString Path;
+			if (IsLoading())
+			{
+				SerializeStateString(InnerArchive, Path);
+
+				Object = nullptr;
+				if (!Path.IsEmpty())
+				{
+					const FSoftObjectPath SoftPath(Path);
+					Object = SoftPath.ResolveObject();
+					if (Object == nullptr)
+					{
+						Object = SoftPath.TryLoad();
+					}
+				}
+			}
+			else
+			{
+				if (Object)
+				{
+					Path = FSoftObjectPath(Object).ToString();
+				}
+
+				InnerArchive << Path;
+			}
+
+			return *this;
+		}
+
+	private:
+		TArray<FName>& Names;
+		TMap<FName, int32> NameIndices;
+	};
+
+	struct FSupertalkSavedStack
+	{
+		uint32 Index = 0;
+		uint32 Source = 0; // Index + 1, zero if the stack has no source.
+		uint32 NumWaitingOn = 0;
+		uint32 Script = 0;
+		FName Section;
+		uint32 Offset = 0;
+	};
+
+	FStreamableManager& GetStreamableManager()
+	{
+		if (UAssetManager::IsValid())
+		{
+			return UAssetManager::GetStreamableManager();
+		}
+
+		static FStreamableManager StreamableManager;
+		return StreamableManager;
+	}
+
+	FArchive& operator<<(FArchive& Ar, FSupertalkSavedStack& Stack)
+	{
+		Ar.SerializeIntPacked(Stack.Index);
+		Ar.SerializeIntPacked(Stack.Source);
+		Ar.SerializeIntPacked(Stack.NumWaitingOn);
+		Ar.SerializeIntPacked(Stack.Script);
+		Ar << Stack.Section;
+		Ar.SerializeIntPacked(Stack.Offset);
+		return Ar;
+	}
+}
+
+void USupertalkCallParams::CompileArguments(USupertalkScript* Script)
+{
+	SplitCommand(Arguments, FunctionName, FunctionArguments);
+	if (FunctionName.ToString().Contains(TEXT("{")))
+	{
+		// The function name is a placeholder, the whole command has to be formatted before the function is known.
+		FunctionName = NAME_None;
+		FunctionArguments = Arguments;
+	}
+
+	FormatArguments.Reset();
+	FSupertalkUtilities::GetFormatArguments(FText::FromString(FunctionArguments), FormatArguments, Script);
+	CachedArgumentsFormat.Reset();
+}
+
+const FTextFormat& USupertalkCallParams::GetArgumentsFormat() const
+{
+	if (!CachedArgumentsFormat.IsSet())
+	{
+		CachedArgumentsFormat.Emplace(FText::FromString(FunctionArguments));
+	}
+
+	return CachedArgumentsFormat.GetValue();
+}
+
+void USupertalkCallParams::PostLoad()
+{
+	Super::PostLoad();
+
+	// Older assets only have the raw command. Commands with a placeholder for a name also end up here, compiling them again is harmless.
+	if (FunctionName == NAME_None && !bIsFunctionCall)
+	{
+		CompileArguments(GetTypedOuter<USupertalkScript>());
+	}
+}
+
+FSupertalkFunctionParameters::FSupertalkFunctionParameters(UFunction* InFunction)
+{
+	check(InFunction);
+
+	Function = InFunction;
+	Memory = static_cast<uint8*>(FMemory::Malloc(FMath::Max(InFunction->ParmsSize, 1), InFunction->GetMinAlignment()));
+	InitializeFunctionParameters(InFunction, Memory);
+}
+
+FSupertalkFunctionParameters::~FSupertalkFunctionParameters()
+{
+	// If the function is gone then there's nothing left that knows how to destroy the parameters.
+	if (UFunction* FunctionPtr = Function.Get())
+	{
+		DestroyFunctionParameters(FunctionPtr, Memory);
+	}
+
+	FMemory::Free(Memory);
+}
+
 USupertalkPlayer::USupertalkPlayer()
 {
 	NextActionId = 1;
-	NextStackId = 1;
+	NumActiveStacks = 0;
+	NumExecutedActions = 0;
 }
 
-void USupertalkPlayer::SetVariable(FName Name, const USupertalkValue* Value)
+void USupertalkPlayer::BeginDestroy()
 {
-	if (!IsValid(Value))
+	// Players can be collected in the middle of a script, don't leave their stacks counted.
+	if (NumActiveStacks > 0)
 	{
-		Variables.Remove(Name);
+		SUPERTALK_GAUGE_ADD(LiveStacks, -NumActiveStacks);
+		SUPERTALK_GAUGE_ADD(ActivePlayers, -1);
+	}
+
+	Super::BeginDestroy();
+}
+
+void USupertalkPlayer::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	SIZE_T Size = Stacks.GetAllocatedSize() + FreeStacks.GetAllocatedSize() + PendingStacks.GetAllocatedSize()
+		+ VariableValues.GetAllocatedSize() + VariableNames.GetAllocatedSize() + VariableSlots.GetAllocatedSize()
+		+ ScriptBindings.GetAllocatedSize() + CommandTargets.GetAllocatedSize() + ConstantCallParameters.GetAllocatedSize()
+		+ LoadHandles.GetAllocatedSize() + ResolvedAssets.GetAllocatedSize();
+
+	for (const FSupertalkScriptBinding& Binding : ScriptBindings)
+	{
+		Size += Binding.Slots.GetAllocatedSize();
+	}
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Size);
+}
+
+void USupertalkPlayer::SetVariable(FName Name, const FSupertalkValue& Value)
+{
+	if (Value.IsNone())
+	{
+		// Don't bother creating a slot just to leave it empty.
+		if (const int32* Slot = VariableSlots.Find(Name))
+		{
+			VariableValues[*Slot] = FSupertalkValue();
+		}
 	}
 	else
 	{
-		// We don't allow aliasing (pointers/references), so always resolve values.
-		// TODO: can we store const TObjectPtrs? Is that a thing?
-		Variables.Add(Name, const_cast<USupertalkValue*>(Value->GetResolvedValue(this)));
+		VariableValues[FindOrAddVariableSlot(Name)] = Value;
 	}
 }
 
+void USupertalkPlayer::SetVariable(FName Name, const USupertalkValue* Value)
+{
+	// We don't allow aliasing (pointers/references), so always resolve values.
+	SetVariable(Name, IsValid(Value) ? Value->Resolve(this, INDEX_NONE) : FSupertalkValue());
+}
+
 void USupertalkPlayer::SetVariable(FName Name, bool Value)
 {
-	USupertalkBooleanValue* BoolValue = NewObject<USupertalkBooleanValue>(this);
-	BoolValue->bValue = Value;
-	SetVariable(Name, BoolValue);
+	SetVariable(Name, FSupertalkValue::MakeBoolean(Value));
 }
 
 void USupertalkPlayer::SetVariable(FName Name, FText Value)
 {
-	USupertalkTextValue* TextValue = NewObject<USupertalkTextValue>(this);
-	TextValue->Text = Value;
-	SetVariable(Name, TextValue);
+	SetVariable(Name, FSupertalkValue::MakeText(Value));
 }
 
-const USupertalkValue* USupertalkPlayer::GetVariable(FName Name) const
+FSupertalkValue USupertalkPlayer::GetVariable(FName Name) const
 {
-	const TObjectPtr<USupertalkValue>* VarValue = Variables.Find(Name);
-	if (VarValue != nullptr)
+	const int32* Slot = VariableSlots.Find(Name);
+	if (Slot != nullptr && !VariableValues[*Slot].IsNone())
 	{
-		return *VarValue;
+		return VariableValues[*Slot];
 	}
 
+	return GetProvidedVariable(Name);
+}
+
+FSupertalkValue USupertalkPlayer::GetVariable(FName Name, int32 Binding, int32 ScriptSlot) const
+{
+	if (ScriptBindings.IsValidIndex(Binding))
+	{
+		const TArray<int32>& Slots = ScriptBindings[Binding].Slots;
+		if (Slots.IsValidIndex(ScriptSlot))
+		{
+			const FSupertalkValue& Value = VariableValues[Slots[ScriptSlot]];
+			return Value.IsNone() ? GetProvidedVariable(Name) : Value;
+		}
+	}
+
+	return GetVariable(Name);
+}
+
+FSupertalkValue USupertalkPlayer::GetProvidedVariable(FName Name) const
+{
+	SUPERTALK_TRACE_SCOPE(Supertalk_GetProvidedVariable);
+
 	for (const FSupertalkVariableProviderObject& Provider : VariableProviderObjects)
 	{
 		if (!Provider.Object)
 		{
 			continue;
 		}
-
-		UClass* Class = Provider.Object->GetClass();
-		if (FProperty* Property = Class->FindPropertyByName(Name))
-		{
-			UClass* OwnerClass = Property->GetOwnerClass();
-			if (Provider.ClassFilter && (!OwnerClass || OwnerClass == Provider.ClassFilter || !OwnerClass->IsChildOf(Provider.ClassFilter)))
-			{
-				continue;
-			}
-
-			USupertalkValue* Value = nullptr;
-			if (USupertalkValue::PropertyToValue(const_cast<USupertalkPlayer*>(this), Provider.Object, Provider.Object, Property, true, Value))
-			{
-				return Value;
-			}
+
+		if (FProperty* Property = FSupertalkUtilities::FindCachedProperty(Provider.Object->GetClass(), Name, Provider.ClassFilter))
+		{
+			SUPERTALK_TRACE_EVENT(ProviderLookup, this, Name, true);
+			SUPERTALK_STAT_INC(ProviderHits);
+			return FSupertalkValue::FromProperty(Provider.Object, Provider.Object, Property, true);
 		}
 	}
 
@@ -211,26 +1036,53 @@ const USupertalkValue* USupertalkPlayer::GetVariable(FName Name) const
 	{
 		if (Provider.IsBound())
 		{
-			const USupertalkValue* Result = Provider.Execute(this, Name);
-			if (Result != nullptr)
+			FSupertalkValue Result = Provider.Execute(this, Name);
+			if (!Result.IsNone())
 			{
+				SUPERTALK_TRACE_EVENT(ProviderLookup, this, Name, true);
+				SUPERTALK_STAT_INC(ProviderHits);
 				return Result;
 			}
 		}
 	}
 
-	return nullptr;
+	SUPERTALK_TRACE_EVENT(ProviderLookup, this, Name, false);
+	SUPERTALK_STAT_INC(ProviderMisses);
+	return FSupertalkValue();
 }
 
 void USupertalkPlayer::ClearVariables()
 {
-	Variables.Empty();
+	// Keep the slots around, script bindings still refer to them.
+	for (FSupertalkValue& Value : VariableValues)
+	{
+		Value = FSupertalkValue();
+	}
 }
 
 void USupertalkPlayer::AddFunctionCallReceiver(UObject* Obj)
 {
 	check(Obj);
 	FunctionCallReceivers.AddUnique(Obj);
+
+	// A new receiver may change which object a command resolves to.
+	CommandTargets.Reset();
+	ConstantCallParameters.Reset();
+}
+
+void USupertalkPlayer::AddCommandRegistry(TSharedRef<FSupertalkCommandRegistry> Registry)
+{
+	SharedCommandRegistries.AddUnique(Registry);
+}
+
+FSupertalkCommandRegistry& USupertalkPlayer::GetCommandRegistry()
+{
+	if (!CommandRegistry.IsValid())
+	{
+		CommandRegistry = MakeShared<FSupertalkCommandRegistry>();
+	}
+
+	return *CommandRegistry;
 }
 
 void USupertalkPlayer::AddVariableProvider(FSupertalkProvideVariableDelegate Provider)
@@ -248,8 +1100,11 @@ void USupertalkPlayer::AddVariableProvider(UObject* Object, UClass* ClassFilter)
 	}
 }
 
-void USupertalkPlayer::RunScript(const USupertalkScript* Script, FName InitialSection)
+bool USupertalkPlayer::RunScript(const USupertalkScript* Script, FName InitialSection)
 {
+	LLM_SCOPE_BYTAG(Supertalk);
+	SUPERTALK_TRACE_SCOPE(Supertalk_RunScript);
+
 	FMessageLog MessageLog(SupertalkMessageLogName);
 	
 	if (ensureAlwaysMsgf(!IsRunningScript(), TEXT("Cannot run a script on a USupertalkPlayer when a script is already running")))
@@ -257,7 +1112,7 @@ void USupertalkPlayer::RunScript(const USupertalkScript* Script, FName InitialSe
 		if (!IsValid(Script))
 		{
 			UE_LOG(LogSupertalk, Error, TEXT("Cannot run invalid script"));
-			return;
+			return false;
 		}
 	
 		if (InitialSection == NAME_None)
@@ -265,33 +1120,452 @@ void USupertalkPlayer::RunScript(const USupertalkScript* Script, FName InitialSe
 			InitialSection = Script->DefaultSection;
 		}
 
-		const FSupertalkSection* Section = Script->Sections.Find(InitialSection);
-		if (Section == nullptr)
+		const int32* Entry = Script->Program.SectionEntries.Find(InitialSection);
+		if (Entry == nullptr)
 		{
 			MessageLog.Error(FText::Format(LOCTEXT("UnknownSectionError", "Unable to find section '{0}' in script '{1}"), FText::FromName(InitialSection), FText::FromString(Script->GetName())));
-			return;
+			return false;
 		}
 	
-		if (Section->Actions.Num() == 0)
+		if (Script->Program.Instructions[*Entry].OpCode == ESupertalkOpCode::End)
 		{
-			MessageLog.Warning(FText::Format(LOCTEXT("NoActionsWarning", "Section '{0}' in script '{1}' has no actions"), FText::FromName(Section->Name), FText::FromString(Script->GetName())));
-			return;
+			MessageLog.Warning(FText::Format(LOCTEXT("NoActionsWarning", "Section '{0}' in script '{1}' has no actions"), FText::FromName(InitialSection), FText::FromString(Script->GetName())));
+			return false;
 		}
-		
-		FSupertalkStack& Stack = CreateNewStack();
-		
-		PushActions(Stack.StackId, Script, Section->Actions);
-		TickStack(Stack.StackId);
+
+		SUPERTALK_TRACE_EVENT(RunScript, this, Script, InitialSection);
+		TickOrScheduleStack(CreateNewStack(BindScript(Script), *Entry));
+		return true;
 	}
 	else
 	{
 		MessageLog.Error(LOCTEXT("ScriptAlreadyRunningError", "Cannot run a script on a USupertalkPlayer when a script is already running"));
+		return false;
+	}
+}
+
+void USupertalkPlayer::RunScriptAsync(TSoftObjectPtr<USupertalkScript> Script, FName InitialSection, FSupertalkScriptReadyDelegate OnReady)
+{
+	// Only the latest request gets to run. Handles that finished loading hold the running script's assets, keep those.
+	LoadHandles.RemoveAll([](const TSharedPtr<FStreamableHandle>& Handle)
+	{
+		if (Handle->IsLoadingInProgress())
+		{
+			Handle->CancelHandle();
+			return true;
+		}
+
+		return false;
+	});
+
+	if (Script.IsNull())
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Cannot run invalid script"));
+		OnReady.ExecuteIfBound(false);
+		return;
+	}
+
+	const FSoftObjectPath ScriptPath = Script.ToSoftObjectPath();
+	TSharedPtr<FStreamableHandle> ScriptHandle = GetStreamableManager().RequestAsyncLoad(ScriptPath, FStreamableDelegate::CreateWeakLambda(this, [this, Script, ScriptPath, InitialSection, OnReady]()
+	{
+		const USupertalkScript* LoadedScript = Script.Get();
+		if (LoadedScript == nullptr)
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Failed to load script '%s'"), *ScriptPath.ToString());
+			OnReady.ExecuteIfBound(false);
+			return;
+		}
+
+		TArray<FSoftObjectPath> Assets;
+		LoadedScript->Dependencies.GetAssets(InitialSection == NAME_None ? LoadedScript->DefaultSection : InitialSection, Assets);
+
+		FStreamableDelegate Start = FStreamableDelegate::CreateWeakLambda(this, [this, LoadedScript, InitialSection, OnReady]()
+		{
+			const bool bStarted = RunScript(LoadedScript, InitialSection);
+			OnReady.ExecuteIfBound(bStarted);
+		});
+
+		if (Assets.Num() == 0)
+		{
+			Start.Execute();
+			return;
+		}
+
+		// Missing assets are reported by the streamable manager, the script still runs without them.
+		Assets.Add(ScriptPath);
+		TSharedPtr<FStreamableHandle> AssetsHandle = GetStreamableManager().RequestAsyncLoad(MoveTemp(Assets), MoveTemp(Start));
+		if (AssetsHandle.IsValid() && (AssetsHandle->IsLoadingInProgress() || IsRunningScript()))
+		{
+			LoadHandles.Add(AssetsHandle);
+		}
+	}));
+
+	// The handle may have completed already, in which case there's nothing left to keep alive.
+	if (ScriptHandle.IsValid() && ScriptHandle->IsLoadingInProgress())
+	{
+		LoadHandles.Add(ScriptHandle);
 	}
 }
 
 void USupertalkPlayer::Stop()
 {
-	Stacks.Empty();
+	// Release rather than empty the pool so that handles held by pending delegates stay invalid.
+	for (int32 Idx = 0; Idx < Stacks.Num(); ++Idx)
+	{
+		if (Stacks[Idx].bIsActive)
+		{
+			ReleaseStack(FSupertalkStackHandle(Idx, Stacks[Idx].Generation));
+		}
+	}
+
+	PendingStacks.Reset();
+
+	for (const TSharedPtr<FStreamableHandle>& Handle : LoadHandles)
+	{
+		Handle->CancelHandle();
+	}
+
+	LoadHandles.Reset();
+	ResolvedAssets.Reset();
+}
+
+void USupertalkPlayer::RetainResolvedAsset(UObject* Asset) const
+{
+	if (Asset)
+	{
+		ResolvedAssets.Add(Asset);
+	}
+}
+
+void USupertalkPlayer::SaveState(FArchive& Ar)
+{
+	check(Ar.IsSaving());
+
+	TArray<FName> Names;
+	TArray<uint8> Payload;
+	{
+		FMemoryWriter Writer(Payload);
+		FSupertalkStateArchive StateAr(Writer, Names);
+
+		TArray<const USupertalkScript*, TInlineAllocator<4>> Scripts;
+		TArray<FSupertalkSavedStack, TInlineAllocator<8>> SavedStacks;
+		for (int32 Idx = 0; Idx < Stacks.Num(); ++Idx)
+		{
+			const FSupertalkStack& Stack = Stacks[Idx];
+			if (!Stack.bIsActive)
+			{
+				continue;
+			}
+
+			// An action in progress is saved as the instruction that started it so that it runs again on restore.
+			const int32 Instruction = Stack.ActiveKey.IsValid() ? Stack.ActiveInstruction : Stack.ProgramCounter;
+
+			FSupertalkSavedStack& Saved = SavedStacks.AddDefaulted_GetRef();
+			Saved.Index = Idx;
+			Saved.Source = Stack.Source.IsValid() ? Stack.Source.Index + 1 : 0;
+			Saved.NumWaitingOn = Stack.NumWaitingOn;
+			const USupertalkScript* Script = GetStackScript(Stack);
+			Saved.Script = Scripts.AddUnique(Script);
+
+			int32 Offset = 0;
+			Script->Program.FindSection(Instruction, Saved.Section, Offset);
+			Saved.Offset = Offset;
+		}
+
+		int32 NumScripts = Scripts.Num();
+		StateAr << NumScripts;
+		for (const USupertalkScript* Script : Scripts)
+		{
+			UObject* ScriptObject = const_cast<USupertalkScript*>(Script);
+			StateAr << ScriptObject;
+		}
+
+		StateAr << SavedStacks;
+
+		uint32 NumVariables = 0;
+		for (const FSupertalkValue& Value : VariableValues)
+		{
+			NumVariables += Value.IsNone() ? 0 : 1;
+		}
+
+		StateAr.SerializeIntPacked(NumVariables);
+		for (int32 Slot = 0; Slot < VariableValues.Num(); ++Slot)
+		{
+			if (!VariableValues[Slot].IsNone())
+			{
+				FName Name = VariableNames[Slot];
+				FSupertalkValue Value = VariableValues[Slot];
+				StateAr << Name;
+				Value.SerializeState(StateAr);
+			}
+		}
+	}
+
+	uint8 Version = PlayerStateVersion;
+	Ar << Version;
+
+	int32 NumNames = Names.Num();
+	Ar << NumNames;
+	for (FName Name : Names)
+	{
+		FString NameString = Name.ToString();
+		Ar << NameString;
+	}
+
+	Ar << Payload;
+}
+
+bool USupertalkPlayer::RestoreState(FArchive& Ar)
+{
+	check(Ar.IsLoading());
+
+	uint8 Version = 0;
+	Ar << Version;
+	if (Version != PlayerStateVersion)
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state with version %d (expected %d)"), Version, PlayerStateVersion);
+		Ar.SetError();
+		return false;
+	}
+
+	int32 NumNames = 0;
+	Ar << NumNames;
+	if (Ar.IsError() || !FitsInArchive(Ar, NumNames))
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+		Ar.SetError();
+		return false;
+	}
+
+	TArray<FName> Names;
+	Names.Reserve(NumNames);
+	for (int32 Idx = 0; Idx < NumNames && !Ar.IsError(); ++Idx)
+	{
+		FString NameString;
+		SerializeStateString(Ar, NameString);
+		Names.Add(FName(*NameString));
+	}
+
+	// Same layout as serializing the array, but the size is checked first.
+	int32 PayloadSize = 0;
+	Ar << PayloadSize;
+	if (Ar.IsError() || !FitsInArchive(Ar, PayloadSize))
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+		Ar.SetError();
+		return false;
+	}
+
+	TArray<uint8> Payload;
+	Payload.SetNumUninitialized(PayloadSize);
+	Ar.Serialize(Payload.GetData(), PayloadSize);
+	if (Ar.IsError())
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+		return false;
+	}
+
+	FMemoryReader Reader(Payload);
+	FSupertalkStateArchive StateAr(Reader, Names);
+
+	int32 NumScripts = 0;
+	StateAr << NumScripts;
+
+	TArray<const USupertalkScript*, TInlineAllocator<4>> Scripts;
+	if (FitsInArchive(StateAr, NumScripts))
+	{
+		for (int32 Idx = 0; Idx < NumScripts && !StateAr.IsError(); ++Idx)
+		{
+			UObject* ScriptObject = nullptr;
+			StateAr << ScriptObject;
+			Scripts.Add(Cast<USupertalkScript>(ScriptObject));
+		}
+	}
+	else
+	{
+		StateAr.SetError();
+	}
+
+	int32 NumSavedStacks = 0;
+	StateAr << NumSavedStacks;
+
+	TArray<FSupertalkSavedStack, TInlineAllocator<8>> SavedStacks;
+	if (FitsInArchive(StateAr, NumSavedStacks))
+	{
+		for (int32 Idx = 0; Idx < NumSavedStacks && !StateAr.IsError(); ++Idx)
+		{
+			StateAr << SavedStacks.AddDefaulted_GetRef();
+		}
+	}
+	else
+	{
+		StateAr.SetError();
+	}
+
+	uint32 NumVariables = 0;
+	StateAr.SerializeIntPacked(NumVariables);
+
+	TArray<TPair<FName, FSupertalkValue>> Variables;
+	for (uint32 Idx = 0; Idx < NumVariables && !StateAr.IsError(); ++Idx)
+	{
+		TPair<FName, FSupertalkValue>& Variable = Variables.AddDefaulted_GetRef();
+		StateAr << Variable.Key;
+		Variable.Value.SerializeState(StateAr);
+	}
+
+	if (StateAr.IsError())
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+		Ar.SetError();
+		return false;
+	}
+
+	// Resolve all cursors before touching the current state so that a bad save leaves the player alone. Stacks are restored
+	// into the first slots in the order they were saved, so the slot indices in the save are only used to hook sources back
+	// up and are never used to index anything.
+	TMap<uint32, int32> SavedIndices;
+	SavedIndices.Reserve(SavedStacks.Num());
+	for (int32 Idx = 0; Idx < SavedStacks.Num(); ++Idx)
+	{
+		// Sources are stored as Index + 1, the last index can't be told apart from having no source.
+		if (SavedStacks[Idx].Index == MAX_uint32 || SavedIndices.Contains(SavedStacks[Idx].Index))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+			return false;
+		}
+
+		SavedIndices.Add(SavedStacks[Idx].Index, Idx);
+	}
+
+	TArray<int32, TInlineAllocator<8>> Sources;
+	TArray<uint32, TInlineAllocator<8>> NumWaitingOn;
+	NumWaitingOn.SetNumZeroed(SavedStacks.Num());
+	for (const FSupertalkSavedStack& Saved : SavedStacks)
+	{
+		const int32* Source = Saved.Source > 0 ? SavedIndices.Find(Saved.Source - 1) : nullptr;
+		if ((Saved.Source > 0 && Source == nullptr) || Saved.Script >= static_cast<uint32>(Scripts.Num()))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+			return false;
+		}
+
+		Sources.Add(Source ? *Source : INDEX_NONE);
+		if (Source)
+		{
+			++NumWaitingOn[*Source];
+		}
+	}
+
+	TArray<int32, TInlineAllocator<8>> ProgramCounters;
+	for (int32 Idx = 0; Idx < SavedStacks.Num(); ++Idx)
+	{
+		const FSupertalkSavedStack& Saved = SavedStacks[Idx];
+		if (Saved.NumWaitingOn != NumWaitingOn[Idx])
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+			return false;
+		}
+
+		const USupertalkScript* Script = Scripts[Saved.Script];
+		if (Script == nullptr)
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, a script it was running no longer exists"));
+			return false;
+		}
+
+		const int32* Entry = Script->Program.SectionEntries.Find(Saved.Section);
+		const int64 ProgramCounter = Entry ? static_cast<int64>(*Entry) + Saved.Offset : INDEX_NONE;
+		if (ProgramCounter < 0 || ProgramCounter >= Script->Program.Instructions.Num())
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, section '%s' in script '%s' has changed"), *Saved.Section.ToString(), *Script->GetName());
+			return false;
+		}
+
+		ProgramCounters.Add(static_cast<int32>(ProgramCounter));
+	}
+
+	// Sources can't loop back around, those stacks would wait on each other forever.
+	// Every stack is walked once: 1 while it's on the chain being followed, 2 once its chain is known to end.
+	TArray<uint8, TInlineAllocator<8>> Visited;
+	Visited.SetNumZeroed(Sources.Num());
+	for (int32 Idx = 0; Idx < Sources.Num(); ++Idx)
+	{
+		int32 Stack = Idx;
+		while (Stack != INDEX_NONE && Visited[Stack] == 0)
+		{
+			Visited[Stack] = 1;
+			Stack = Sources[Stack];
+		}
+
+		if (Stack != INDEX_NONE && Visited[Stack] == 1)
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Cannot restore player state, the data is corrupt"));
+			return false;
+		}
+
+		for (Stack = Idx; Stack != INDEX_NONE && Visited[Stack] == 1; Stack = Sources[Stack])
+		{
+			Visited[Stack] = 2;
+		}
+	}
+
+	Stop();
+	ClearVariables();
+
+	for (const TPair<FName, FSupertalkValue>& Variable : Variables)
+	{
+		SetVariable(Variable.Key, Variable.Value);
+	}
+
+	if (Stacks.Num() < SavedStacks.Num())
+	{
+		Stacks.SetNum(SavedStacks.Num());
+	}
+
+	// Stop() bumped the generation of anything that was active, stale handles from before the restore stay invalid.
+	for (int32 Idx = 0; Idx < SavedStacks.Num(); ++Idx)
+	{
+		const FSupertalkSavedStack& Saved = SavedStacks[Idx];
+		FSupertalkStack& Stack = Stacks[Idx];
+		Stack.bIsActive = true;
+		Stack.Binding = BindScript(Scripts[Saved.Script]);
+		Stack.ProgramCounter = ProgramCounters[Idx];
+		Stack.NumWaitingOn = Saved.NumWaitingOn;
+		++NumActiveStacks;
+	}
+
+	if (NumActiveStacks > 0)
+	{
+		SUPERTALK_GAUGE_ADD(LiveStacks, NumActiveStacks);
+		SUPERTALK_GAUGE_ADD(ActivePlayers, 1);
+	}
+
+	for (int32 Idx = 0; Idx < Sources.Num(); ++Idx)
+	{
+		if (Sources[Idx] != INDEX_NONE)
+		{
+			Stacks[Idx].Source = FSupertalkStackHandle(Sources[Idx], Stacks[Sources[Idx]].Generation);
+		}
+	}
+
+	FreeStacks.Reset();
+	for (int32 Idx = Stacks.Num() - 1; Idx >= 0; --Idx)
+	{
+		if (!Stacks[Idx].bIsActive)
+		{
+			FreeStacks.Add(Idx);
+		}
+	}
+
+	for (int32 Idx = 0; Idx < SavedStacks.Num(); ++Idx)
+	{
+		if (SavedStacks[Idx].NumWaitingOn == 0)
+		{
+			TickOrScheduleStack(FSupertalkStackHandle(Idx, Stacks[Idx].Generation));
+		}
+	}
+
+	return true;
 }
 
 FSupertalkLatentFunctionFinalizer USupertalkPlayer::MakeLatentFunction()
@@ -325,26 +1599,119 @@ void USupertalkPlayer::OnPlayLine(const FSupertalkLine& Line, FSupertalkEventCom
 	}
 }
 
-void USupertalkPlayer::OnPlayChoice(const FSupertalkLine& Line, const TArray<FText>& Choices, FSupertalkChoiceCompletedDelegate Completed)
+void USupertalkPlayer::OnPrefetchLine(const FSupertalkLine& Line)
+{
+	OnPrefetchLineEvent.ExecuteIfBound(Line);
+}
+
+void USupertalkPlayer::OnPlayChoice(const FSupertalkLine& Line, const TArray<FText>& Choices, FSupertalkChoiceCompletedDelegate Completed)
+{
+	FMessageLog MessageLog(SupertalkMessageLogName);
+	
+	if (OnPlayChoiceEvent.IsBound())
+	{
+		OnPlayChoiceEvent.Execute(Line, Choices, Completed);
+	}
+	else
+	{
+		MessageLog.Warning(LOCTEXT("OnPlayChoiceUnimplemented", "OnPlayChoice has not been implemented"));
+		Completed.ExecuteIfBound(INDEX_NONE);
+	}
+}
+
+int32 USupertalkPlayer::FindOrAddVariableSlot(FName Name)
+{
+	if (const int32* Slot = VariableSlots.Find(Name))
+	{
+		return *Slot;
+	}
+
+	const int32 Slot = VariableValues.AddDefaulted();
+	VariableNames.Add(Name);
+	VariableSlots.Add(Name, Slot);
+	return Slot;
+}
+
+int32 USupertalkPlayer::FindBinding(const USupertalkScript* Script) const
+{
+	return ScriptBindings.IndexOfByPredicate([Script](const FSupertalkScriptBinding& Existing) { return Existing.Script == Script; });
+}
+
+int32 USupertalkPlayer::BindScript(const USupertalkScript* Script)
+{
+	check(Script);
+
+	int32 Binding = FindBinding(Script);
+	if (Binding == INDEX_NONE)
+	{
+		Binding = ScriptBindings.AddDefaulted();
+		ScriptBindings[Binding].Script = Script;
+	}
+
+	// Always rebuild the slot map, the script may have been recompiled since it was last run.
+	TArray<int32>& Slots = ScriptBindings[Binding].Slots;
+	Slots.Reset(Script->Variables.Num());
+	for (FName Name : Script->Variables)
+	{
+		Slots.Add(FindOrAddVariableSlot(Name));
+	}
+
+	return Binding;
+}
+
+FSupertalkStackHandle USupertalkPlayer::CreateNewStack(int32 Binding, int32 ProgramCounter)
+{
+	check(ScriptBindings.IsValidIndex(Binding));
+
+	const USupertalkScript* Script = ScriptBindings[Binding].Script;
+	check(Script);
+	check(Script->Program.Instructions.IsValidIndex(ProgramCounter));
+
+	const int32 Index = FreeStacks.Num() > 0 ? FreeStacks.Pop(false) : Stacks.AddDefaulted();
+
+	FSupertalkStack& Stack = Stacks[Index];
+	check(!Stack.bIsActive);
+	Stack.bIsActive = true;
+	Stack.Binding = Binding;
+	Stack.ProgramCounter = ProgramCounter;
+
+	++NumActiveStacks;
+
+	SUPERTALK_GAUGE_ADD(LiveStacks, 1);
+	if (NumActiveStacks == 1)
+	{
+		SUPERTALK_GAUGE_ADD(ActivePlayers, 1);
+	}
+
+	SUPERTALK_TRACE_EVENT(StackCreate, this, Index, Script);
+
+	return FSupertalkStackHandle(Index, Stack.Generation);
+}
+
+void USupertalkPlayer::ReleaseStack(FSupertalkStackHandle Handle)
 {
-	FMessageLog MessageLog(SupertalkMessageLogName);
-	
-	if (OnPlayChoiceEvent.IsBound())
+	FSupertalkStack* Stack = GetStack(Handle);
+	check(Stack);
+
+	uint32 NextGeneration = Stack->Generation + 1;
+	if (NextGeneration == 0)
 	{
-		OnPlayChoiceEvent.Execute(Line, Choices, Completed);
+		NextGeneration = 1;
 	}
-	else
+
+	*Stack = FSupertalkStack();
+	Stack->Generation = NextGeneration;
+
+	FreeStacks.Add(Handle.Index);
+	--NumActiveStacks;
+
+	SUPERTALK_GAUGE_ADD(LiveStacks, -1);
+	if (NumActiveStacks == 0)
 	{
-		MessageLog.Warning(LOCTEXT("OnPlayChoiceUnimplemented", "OnPlayChoice has not been implemented"));
-		Completed.ExecuteIfBound(INDEX_NONE);
+		SUPERTALK_GAUGE_ADD(ActivePlayers, -1);
 	}
-}
 
-FSupertalkStack& USupertalkPlayer::CreateNewStack()
-{
-	FSupertalkStack Stack;
-	Stack.StackId = GetNewStackId();
-	return Stacks.Add(Stack.StackId, Stack);
+	SUPERTALK_TRACE_EVENT(StackDestroy, this, Handle.Index);
 }
 
 uint32 USupertalkPlayer::GetNewActionId()
@@ -358,81 +1725,93 @@ uint32 USupertalkPlayer::GetNewActionId()
 	return NewId;
 }
 
-uint32 USupertalkPlayer::GetNewStackId()
+void USupertalkPlayer::CompleteActionAndTick(FSupertalkActionKey Key)
 {
-	const uint32 NewId = NextStackId++;
-	if (NextStackId == 0)
-	{
-		NextStackId = 1;
-	}
-
-	return NewId;
+	CompleteAction(Key);
+	TickOrScheduleStack(Key.Stack);
 }
 
-void USupertalkPlayer::PushActions(uint32 StackId, const USupertalkScript* Script, const TArray<FSupertalkAction>& Actions)
+void USupertalkPlayer::CompleteAction(FSupertalkActionKey Key)
 {
-	check(Script);
-	check(Actions.Num() > 0);
+	FSupertalkStack* Stack = GetStack(Key.Stack);
+	if (Stack == nullptr)
+	{
+		UE_LOG(LogSupertalk, Warning, TEXT("CompleteAction called with unknown stack %d (generation %u)"), Key.Stack.Index, Key.Stack.Generation);
+		return;
+	}
 
-	FSupertalkStack& Stack = Stacks.FindChecked(StackId);
-	Stack.QueuedActions.Reserve(Stack.QueuedActions.Num() + Actions.Num());
-	for (int32 Idx = Actions.Num() - 1; Idx >= 0; --Idx)
+	if (!Key.IsValid() || Stack->ActiveKey != Key)
 	{
-		const FSupertalkAction& Action = Actions[Idx]; 
-		PushAction(Stack, Script, Action);
+		UE_LOG(LogSupertalk, Warning, TEXT("CompleteAction called with unknown action id %u (stack %d expects %u)"), Key.ActionId, Key.Stack.Index, Stack->ActiveKey.ActionId);
+		return;
 	}
-}
 
-void USupertalkPlayer::PushAction(FSupertalkStack& Stack, const USupertalkScript* Script, const FSupertalkAction& Action)
-{
-	check(Script);
+	// Actions that complete while their stack is still ticking never went latent.
+	if (!Stack->bIsTicking)
+	{
+		SUPERTALK_TRACE_EVENT(LatentEnd, this, Key.Stack.Index, Key.ActionId);
+	}
 
-	FSupertalkActionWithContext Context;
-	Context.Source = Script;
-	Context.Action = Action;
-	Context.Key.StackId = Stack.StackId;
-	Context.Key.ActionId = GetNewActionId();
-	Stack.QueuedActions.Add(Context);
+	Stack->ActiveKey = FSupertalkActionKey();
+	Stack->ActiveInstruction = INDEX_NONE;
 }
 
-void USupertalkPlayer::PushAction(uint32 StackId, const USupertalkScript* Script, const FSupertalkAction& Action)
+void USupertalkPlayer::TickOrScheduleStack(FSupertalkStackHandle Handle)
 {
-	check(Script);
+	USupertalkSubsystem* Subsystem = Scheduler.Get();
+	if (Subsystem == nullptr)
+	{
+		TickStack(Handle);
+		return;
+	}
 
-	FSupertalkStack& Stack = Stacks.FindChecked(StackId);
-	PushAction(Stack, Script, Action);
-}
+	// A stack that completes an action while it's ticking just keeps going, there's nothing to schedule.
+	const FSupertalkStack* Stack = GetStack(Handle);
+	if (Stack == nullptr || Stack->bIsTicking)
+	{
+		return;
+	}
 
-void USupertalkPlayer::CompleteActionAndTick(FSupertalkActionKey Key)
-{
-	CompleteAction(Key);
-	TickStack(Key.StackId);
+	PendingStacks.AddUnique(Handle);
+	Subsystem->SchedulePlayer(this);
 }
 
-void USupertalkPlayer::CompleteAction(FSupertalkActionKey Key)
+int32 USupertalkPlayer::TickPendingStacks(double Deadline)
 {
-	FSupertalkStack* Stack = Stacks.Find(Key.StackId);
-	if (Stack == nullptr)
-	{
-		UE_LOG(LogSupertalk, Warning, TEXT("CompleteAction called with unknown stack id %u"), Key.StackId);
-		return;
-	}
+	TGuardValue<double> DeadlineGuard(TickDeadline, Deadline);
 
-	if (!Key.IsValid() || Stack->ActiveAction.Key != Key)
+	// Stacks that are rescheduled while ticking end up behind the ones that didn't get to run.
+	TArray<FSupertalkStackHandle, TInlineAllocator<8>> Ticking(MoveTemp(PendingStacks));
+	PendingStacks.Reset();
+
+	int32 NumTicked = 0;
+	for (int32 Idx = 0; Idx < Ticking.Num(); ++Idx)
 	{
-		UE_LOG(LogSupertalk, Warning, TEXT("CompleteAction called with unknown action id %u (stack %u expects %u)"), Key.ActionId, Key.StackId, Stack->ActiveAction.Key.ActionId);
-		return;
+		if (Deadline > 0.0 && NumTicked > 0 && FPlatformTime::Seconds() > Deadline)
+		{
+			PendingStacks.Insert(&Ticking[Idx], Ticking.Num() - Idx, 0);
+			break;
+		}
+
+		// Released stacks have a new generation and are skipped.
+		if (GetStack(Ticking[Idx]) != nullptr)
+		{
+			TickStack(Ticking[Idx]);
+			++NumTicked;
+		}
 	}
 
-	Stack->ActiveAction = FSupertalkActionWithContext();
+	return NumTicked;
 }
 
-void USupertalkPlayer::TickStack(uint32 StackId)
+void USupertalkPlayer::TickStack(FSupertalkStackHandle Handle)
 {
-	FSupertalkStack* Stack = Stacks.Find(StackId);
+	LLM_SCOPE_BYTAG(Supertalk);
+
+	FSupertalkStack* Stack = GetStack(Handle);
 	if (Stack == nullptr)
 	{
-		UE_LOG(LogSupertalk, Error, TEXT("TickStack called with unknown stack id %u"), StackId);
+		UE_LOG(LogSupertalk, Error, TEXT("TickStack called with unknown stack %d (generation %u)"), Handle.Index, Handle.Generation);
 		return;
 	}
 	
@@ -444,33 +1823,63 @@ void USupertalkPlayer::TickStack(uint32 StackId)
 
 	Stack->bIsTicking = true;
 	
-	while (Stack != nullptr && !Stack->ActiveAction.Key.IsValid() && Stack->WaitingOn.Num() == 0)
+	while (Stack != nullptr && !Stack->ActiveKey.IsValid() && Stack->NumWaitingOn == 0)
 	{
-		if (Stack->QueuedActions.Num() > 0)
+		const USupertalkScript* Script = GetStackScript(*Stack);
+		const FSupertalkProgram& Program = Script->Program;
+		if (!Program.Instructions.IsValidIndex(Stack->ProgramCounter))
 		{
-			Stack->ActiveAction = Stack->QueuedActions.Last();
-			Stack->QueuedActions.RemoveAt(Stack->QueuedActions.Num() - 1);
-		
-			ExecuteAction(Stack->ActiveAction);
+			UE_LOG(LogSupertalk, Error, TEXT("Stack %d ran past the end of script '%s'"), Handle.Index, *Script->GetName());
+			ExitStack(Handle);
+			return;
 		}
-		else
+
+		const int32 InstructionIdx = Stack->ProgramCounter++;
+		const FSupertalkInstruction& Instruction = Program.Instructions[InstructionIdx];
+
+		// Control flow is handled inline, everything else gets an action key so that it can complete latently.
+		switch (Instruction.OpCode)
 		{
-			uint32 ExitingId = Stack->StackId;
-			uint32 WaitingId = Stack->SourceId;
-			
-			Stacks.Remove(StackId);
-			Stack = nullptr;
-			
-			if (WaitingId != 0)
-			{
-				FinishWaitingOnStack(ExitingId, WaitingId);
-			}
+		case ESupertalkOpCode::Goto:
+			Stack->ProgramCounter = Instruction.Operand;
+			continue;
 
+		case ESupertalkOpCode::End:
+			ExitStack(Handle);
+			return;
+
+		default:
 			break;
 		}
 
+		FSupertalkInstructionContext Context;
+		Context.Script = Script;
+		Context.Binding = Stack->Binding;
+		Context.Instruction = InstructionIdx;
+		Context.Key.Stack = Handle;
+		Context.Key.ActionId = GetNewActionId();
+
+		Stack->ActiveKey = Context.Key;
+		Stack->ActiveInstruction = InstructionIdx;
+
+		ExecuteInstruction(Context);
+
 		// Need to re-find just in case Stacks was modified during execution.
-		Stack = Stacks.Find(StackId);
+		Stack = GetStack(Handle);
+
+		if (Stack != nullptr && Stack->ActiveKey == Context.Key)
+		{
+			SUPERTALK_TRACE_EVENT(LatentBegin, this, Handle.Index, Context.Key.ActionId);
+		}
+
+		if (TickDeadline > 0.0 && Stack != nullptr && !Stack->ActiveKey.IsValid() && Stack->NumWaitingOn == 0
+			&& Scheduler.IsValid() && FPlatformTime::Seconds() > TickDeadline)
+		{
+			// Out of time for this frame, pick up where we left off on the next one.
+			Stack->bIsTicking = false;
+			TickOrScheduleStack(Handle);
+			return;
+		}
 	}
 
 	if (Stack != nullptr)
@@ -479,69 +1888,148 @@ void USupertalkPlayer::TickStack(uint32 StackId)
 	}
 }
 
-void USupertalkPlayer::ExecuteAction(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::ExitStack(FSupertalkStackHandle Handle)
+{
+	FSupertalkStack* Stack = GetStack(Handle);
+	check(Stack);
+
+	const FSupertalkStackHandle Waiting = Stack->Source;
+	ReleaseStack(Handle);
+
+	if (Waiting.IsValid())
+	{
+		FinishWaitingOnStack(Handle, Waiting);
+	}
+	else if (NumActiveStacks == 0)
+	{
+		// The script is done with anything RunScriptAsync loaded for it, but a newer request may still be loading.
+		LoadHandles.RemoveAll([](const TSharedPtr<FStreamableHandle>& LoadHandle) { return !LoadHandle->IsLoadingInProgress(); });
+		ResolvedAssets.Reset();
+	}
+}
+
+void USupertalkPlayer::ExecuteInstruction(const FSupertalkInstructionContext& Context)
 {
-	check(Context.Source);
-	check(Stacks.Contains(Context.Key.StackId));
-	check(Stacks[Context.Key.StackId].ActiveAction.Key == Context.Key);
+	check(Context.Script);
+	check(GetStack(Context.Key.Stack));
+	check(GetStack(Context.Key.Stack)->ActiveKey == Context.Key);
+
+	SUPERTALK_TRACE_EVENT(Instruction, this, Context);
+	SUPERTALK_STAT_INC(ActionsExecuted);
+	++NumExecutedActions;
+	SUPERTALK_TRACE_DYNAMIC_SCOPE(FSupertalkTrace::GetInstructionScopeName(Context));
 
-	switch (Context.Action.Operation)
+	switch (Context.GetInstruction().OpCode)
 	{
 	default:
 		checkNoEntry();
-		// fall-through on purpose, count this as a no-op if checks are disabled.
-
-	case ESupertalkOperation::Noop:
 		CompleteAction(Context.Key);
 		break;
 
-	case ESupertalkOperation::Line:
+	case ESupertalkOpCode::Line:
 		HandlePlayLine(Context);
 		break;
 
-	case ESupertalkOperation::Choice:
+	case ESupertalkOpCode::Choice:
 		HandlePlayChoice(Context);
 		break;
 
-	case ESupertalkOperation::Assign:
+	case ESupertalkOpCode::Assign:
 		HandleAssign(Context);
 		break;
 
-	case ESupertalkOperation::Call:
+	case ESupertalkOpCode::Call:
 		HandleCall(Context);
 		break;
 
-	case ESupertalkOperation::Jump:
-		HandleJump(Context);
-		break;
-
-	case ESupertalkOperation::Parallel:
+	case ESupertalkOpCode::Parallel:
 		HandleParallel(Context);
 		break;
 
-	case ESupertalkOperation::Queue:
-		HandleQueue(Context);
-		break;
-
-	case ESupertalkOperation::Conditional:
-		HandleConditional(Context);
+	case ESupertalkOpCode::Branch:
+		HandleBranch(Context);
 		break;
 	}
 }
 
-void USupertalkPlayer::HandlePlayLine(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::HandlePlayLine(const FSupertalkInstructionContext& Context)
 {
-	USupertalkPlayLineParams* Params = CastChecked<USupertalkPlayLineParams>(Context.Action.Params);
+	USupertalkPlayLineParams* Params = CastChecked<USupertalkPlayLineParams>(Context.GetInstruction().Params);
 	
 	FSupertalkEventCompletedDelegate Completed;
 	Completed.BindUObject(this, &ThisClass::CompleteActionAndTick, Context.Key);
+
+	// Before playing the line, the line may complete immediately and take the stack somewhere else.
+	PrefetchLines(Context);
 	
 	OnPlayLine(Params->Line, Completed);
 }
 
-void USupertalkPlayer::HandlePlayChoice(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::PrefetchLines(const FSupertalkInstructionContext& Context)
+{
+	if (LookaheadLines <= 0)
+	{
+		return;
+	}
+
+	// Bounded so that a loop made entirely of jumps and assignments can't hang the player.
+	constexpr int32 MaxSteps = 256;
+
+	const FSupertalkProgram& Program = Context.Script->Program;
+	TArray<int32, TInlineAllocator<8>> Lines;
+	int32 ProgramCounter = Context.Instruction + 1;
+	for (int32 Step = 0; Step < MaxSteps && Lines.Num() < LookaheadLines && Program.Instructions.IsValidIndex(ProgramCounter); ++Step)
+	{
+		const FSupertalkInstruction& Instruction = Program.Instructions[ProgramCounter];
+		if (Instruction.OpCode == ESupertalkOpCode::Goto)
+		{
+			ProgramCounter = Instruction.Operand;
+			continue;
+		}
+
+		if (Instruction.OpCode == ESupertalkOpCode::Line || Instruction.OpCode == ESupertalkOpCode::Choice)
+		{
+			Lines.Add(ProgramCounter);
+		}
+
+		if (Instruction.OpCode != ESupertalkOpCode::Line && Instruction.OpCode != ESupertalkOpCode::Assign)
+		{
+			break;
+		}
+
+		++ProgramCounter;
+	}
+
+	// The previous line already prefetched everything up to PrefetchedLine.
+	int32 First = 0;
+	if (FSupertalkStack* Stack = GetStack(Context.Key.Stack))
+	{
+		const int32 Known = Lines.Find(Stack->PrefetchedLine);
+		if (Known != INDEX_NONE)
+		{
+			First = Known + 1;
+		}
+
+		Stack->PrefetchedLine = Lines.Num() > 0 ? Lines.Last() : INDEX_NONE;
+	}
+
+	for (int32 Idx = First; Idx < Lines.Num(); ++Idx)
+	{
+		const FSupertalkInstruction& Instruction = Program.Instructions[Lines[Idx]];
+		if (Instruction.OpCode == ESupertalkOpCode::Line)
+		{
+			OnPrefetchLine(CastChecked<USupertalkPlayLineParams>(Instruction.Params)->Line);
+		}
+		else
+		{
+			OnPrefetchLine(CastChecked<USupertalkPlayChoiceParams>(Instruction.Params)->Line);
+		}
+	}
+}
+
+void USupertalkPlayer::HandlePlayChoice(const FSupertalkInstructionContext& Context)
 {
-	USupertalkPlayChoiceParams* Params = CastChecked<USupertalkPlayChoiceParams>(Context.Action.Params);
+	USupertalkPlayChoiceParams* Params = CastChecked<USupertalkPlayChoiceParams>(Context.GetInstruction().Params);
 	check(Params->Choices.Num() > 0);
 	
 	FSupertalkChoiceCompletedDelegate Completed;
@@ -560,64 +2048,71 @@ void USupertalkPlayer::HandlePlayChoice(const FSupertalkActionWithContext& Conte
 
 void USupertalkPlayer::ReceiveChoice(int32 ChoiceIndex, FSupertalkActionKey Key)
 {
-	FSupertalkStack* Stack = Stacks.Find(Key.StackId);
+	FSupertalkStack* Stack = GetStack(Key.Stack);
 	if (Stack == nullptr)
 	{
-		UE_LOG(LogSupertalk, Warning, TEXT("ReceiveChoice called with unknown stack id %u"), Key.StackId);
+		UE_LOG(LogSupertalk, Warning, TEXT("ReceiveChoice called with unknown stack %d (generation %u)"), Key.Stack.Index, Key.Stack.Generation);
 		return;
 	}
 
-	if (!Key.IsValid() || Stack->ActiveAction.Key != Key)
+	if (!Key.IsValid() || Stack->ActiveKey != Key)
 	{
-		UE_LOG(LogSupertalk, Warning, TEXT("ReceiveChoice called with unknown action id %u (stack %u expects %u)"), Key.ActionId, Key.StackId, Stack->ActiveAction.Key.ActionId);
+		UE_LOG(LogSupertalk, Warning, TEXT("ReceiveChoice called with unknown action id %u (stack %d expects %u)"), Key.ActionId, Key.Stack.Index, Stack->ActiveKey.ActionId);
 		return;
 	}
 
-	USupertalkPlayChoiceParams* Params = CastChecked<USupertalkPlayChoiceParams>(Stack->ActiveAction.Action.Params);
-	if (ChoiceIndex < 0)
-	{
-		CompleteActionAndTick(Key);
-		return;
-	}
-	
-	if (ChoiceIndex >= Params->Choices.Num())
+	const FSupertalkProgram& Program = GetStackScript(*Stack)->Program;
+	const FSupertalkInstruction& Instruction = Program.Instructions[Stack->ActiveInstruction];
+	check(Instruction.OpCode == ESupertalkOpCode::Choice);
+
+	// The last target is the continuation after all choices.
+	const int32 NumChoices = Instruction.NumTargets - 1;
+	if (ChoiceIndex >= NumChoices)
 	{
-		UE_LOG(LogSupertalk, Error, TEXT("ReceiveChoice called with invalid choice index %d (expected < %d)"), ChoiceIndex, Params->Choices.Num());
+		UE_LOG(LogSupertalk, Error, TEXT("ReceiveChoice called with invalid choice index %d (expected < %d)"), ChoiceIndex, NumChoices);
+		ChoiceIndex = INDEX_NONE;
 	}
 
-	const FSupertalkChoice& Choice = Params->Choices[ChoiceIndex];
-	PushAction(*Stack, Stack->ActiveAction.Source, Choice.SubAction);
+	Stack->ProgramCounter = Program.Targets[Instruction.Operand + (ChoiceIndex < 0 ? NumChoices : ChoiceIndex)];
 	
 	CompleteActionAndTick(Key);
 }
 
-void USupertalkPlayer::HandleAssign(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::HandleAssign(const FSupertalkInstructionContext& Context)
 {
-	USupertalkAssignParams* Params = CastChecked<USupertalkAssignParams>(Context.Action.Params);
+	USupertalkAssignParams* Params = CastChecked<USupertalkAssignParams>(Context.GetInstruction().Params);
 
-	const USupertalkValue* Value = nullptr;
+	FSupertalkValue Value;
 	if (IsValid(Params->Expression))
 	{
-		Value = Params->Expression->Evaluate(this);
+		Value = Params->Expression->Evaluate(this, Context.Binding);
 	}
-	else
+	else if (IsValid(Params->Value_DEPRECATED))
 	{
-		Value = Params->Value_DEPRECATED;
+		Value = Params->Value_DEPRECATED->Resolve(this, Context.Binding);
 	}
 
-	Value = Value ? Value->GetResolvedValue(this) : nullptr;
-
-	SetVariable(Params->Variable, Value);
+	const TArray<int32>& Slots = ScriptBindings[Context.Binding].Slots;
+	if (Slots.IsValidIndex(Params->VariableSlot))
+	{
+		VariableValues[Slots[Params->VariableSlot]] = Value;
+	}
+	else
+	{
+		SetVariable(Params->Variable, Value);
+	}
 
 	// Not necessary to tick, this can only happen as the result of an ongoing tick.
 	CompleteAction(Context.Key);
 }
 
-void USupertalkPlayer::HandleCall(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::HandleCall(const FSupertalkInstructionContext& Context)
 {
+	SUPERTALK_STAT_SCOPE(FunctionCall);
+
 	FMessageLog MessageLog(SupertalkMessageLogName);
 	
-	USupertalkCallParams* Params = CastChecked<USupertalkCallParams>(Context.Action.Params);
+	USupertalkCallParams* Params = CastChecked<USupertalkCallParams>(Context.GetInstruction().Params);
 	
 	if (!ensure(!CurrentFunctionFinalizer))
 	{
@@ -626,175 +2121,288 @@ void USupertalkPlayer::HandleCall(const FSupertalkActionWithContext& Context)
 		return;
 	}
 
-	FSupertalkLatentFunctionFinalizer Finalizer;
-	Finalizer.Completed.BindUObject(this, &ThisClass::CompleteActionAndTick, Context.Key);
-	CurrentFunctionFinalizer = &Finalizer;
-	bIsFunctionCallLatent = false;
+	FName FunctionName = Params->FunctionName;
+	FString FormattedArgs;
+	TArray<FSupertalkValue, TInlineAllocator<4>> Arguments;
+	const bool bHasConstantArguments = !Params->bIsFunctionCall && FunctionName != NAME_None && Params->FormatArguments.Num() == 0;
+	if (Params->bIsFunctionCall)
+	{
+		for (USupertalkExpression* Expression : Params->ArgumentExpressions)
+		{
+			Arguments.Add(Expression ? Expression->Evaluate(this, Context.Binding) : FSupertalkValue());
+		}
+	}
+	else if (!bHasConstantArguments)
+	{
+		FormattedArgs = FSupertalkUtilities::FormatText(Params->GetArgumentsFormat(), Params->FormatArguments, this, Context.Binding, false).ToString();
+		if (FunctionName == NAME_None)
+		{
+			SplitCommand(FormattedArgs, FunctionName, FormattedArgs);
+		}
+	}
 
-	// TODO: shouldn't be using FText for this. It's slow, it's converting back and forth between FText/FString.
-	// Function calls need to be rewritten to support actual objects at some point and not strings, so this will go away whenever that happens.
-	const FString FormattedArgs = FSupertalkUtilities::FormatText(FText::FromString(Params->Arguments), this, false).ToString();
-	
-	bool bCalledFunction = false;
-	for (UObject* Receiver : FunctionCallReceivers)
+	// Held until the command returns, it may unregister itself.
+	if (TSharedPtr<const FSupertalkCommandFunction> Command = FindNativeCommand(FunctionName))
 	{
-		if (Receiver->CallFunctionByNameWithArguments(*FormattedArgs, *GLog, nullptr, true))
+		if (!Params->bIsFunctionCall)
 		{
-			bCalledFunction = true;
-			break;
+			if (bHasConstantArguments)
+			{
+				FormattedArgs = FSupertalkUtilities::FormatText(Params->GetArgumentsFormat(), {}, this, INDEX_NONE, false).ToString();
+			}
+
+			TokenizeArguments(FormattedArgs, Arguments);
 		}
+
+		InvokeCommand(Context, Params, [this, &Command, &Arguments](FString& OutError)
+		{
+			return (*Command)(*this, Arguments, OutError);
+		});
+
+		return;
 	}
-	
-	CurrentFunctionFinalizer = nullptr;
 
-	if (!bCalledFunction)
+	const FSupertalkCommandTarget* Target = FindCommandTarget(FunctionName);
+	UObject* Receiver = Target ? Target->Receiver.Get() : nullptr;
+	UFunction* Function = Target ? Target->Function.Get() : nullptr;
+	if (Receiver == nullptr || Function == nullptr)
 	{
 		MessageLog.Error(FText::Format(LOCTEXT("FunctionCallFail", "Failed to call function from script: {0}"), FText::FromString(Params->Arguments)));
 		CompleteAction(Context.Key);
 		return;
 	}
 
-	if (!bIsFunctionCallLatent)
+	uint8* Parms = static_cast<uint8*>(FMemory_Alloca_Aligned(Function->ParmsSize, Function->GetMinAlignment()));
+	InitializeFunctionParameters(Function, Parms);
+
+	FString ImportError;
+	bool bImported;
+	if (Params->bIsFunctionCall)
 	{
-		// MakeLatentFunction was not called, complete this event immediately
+		bImported = ExportFunctionParameters(Function, Arguments, Parms, Receiver, ImportError);
+	}
+	else if (bHasConstantArguments && Function->RefLink == nullptr)
+	{
+		// Arguments that can't change are imported once and copied for each call. Parameters that reference objects are
+		// excluded since the prepared copy isn't visible to the garbage collector.
+		TSharedPtr<FSupertalkFunctionParameters>& Prepared = ConstantCallParameters.FindOrAdd(Params);
+		if (!Prepared.IsValid() || Prepared->Function != Function)
+		{
+			Prepared = MakeShared<FSupertalkFunctionParameters>(Function);
+			const FString Args = FSupertalkUtilities::FormatText(Params->GetArgumentsFormat(), {}, this, INDEX_NONE, false).ToString();
+			if (!ImportFunctionParameters(Function, *Args, Prepared->Memory, Receiver, ImportError))
+			{
+				Prepared.Reset();
+			}
+		}
+
+		bImported = Prepared.IsValid();
+		if (bImported)
+		{
+			CopyFunctionParameters(Function, Parms, Prepared->Memory);
+		}
+	}
+	else
+	{
+		if (bHasConstantArguments)
+		{
+			FormattedArgs = FSupertalkUtilities::FormatText(Params->GetArgumentsFormat(), {}, this, INDEX_NONE, false).ToString();
+		}
+
+		bImported = ImportFunctionParameters(Function, *FormattedArgs, Parms, Receiver, ImportError);
+	}
+
+	if (!bImported)
+	{
+		MessageLog.Error(FText::Format(LOCTEXT("FunctionCallBadArguments", "Failed to call function from script: {0} ({1})"), FText::FromString(Params->Arguments), FText::FromString(ImportError)));
+		DestroyFunctionParameters(Function, Parms);
 		CompleteAction(Context.Key);
+		return;
 	}
+
+	InvokeCommand(Context, Params, [Receiver, Function, Parms](FString& OutError)
+	{
+		Receiver->ProcessEvent(Function, Parms);
+		return true;
+	});
+
+	DestroyFunctionParameters(Function, Parms);
 }
 
-void USupertalkPlayer::HandleJump(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::InvokeCommand(const FSupertalkInstructionContext& Context, const USupertalkCallParams* Params, TFunctionRef<bool(FString& OutError)> Invoke)
 {
-	check(Context.Source);
-	
-	FMessageLog MessageLog(SupertalkMessageLogName);
-	
-	USupertalkJumpParams* Params = CastChecked<USupertalkJumpParams>(Context.Action.Params);
+	FSupertalkLatentFunctionFinalizer Finalizer;
+	Finalizer.Completed.BindUObject(this, &ThisClass::CompleteActionAndTick, Context.Key);
+	CurrentFunctionFinalizer = &Finalizer;
+	bIsFunctionCallLatent = false;
 
-	FSupertalkStack* Stack = Stacks.Find(Context.Key.StackId);
-	if (Stack == nullptr)
+	FString Error;
+	const bool bSucceeded = Invoke(Error);
+
+	CurrentFunctionFinalizer = nullptr;
+
+	if (!bSucceeded)
 	{
-		UE_LOG(LogSupertalk, Error, TEXT("Cannot jump using unknown stack %u"), Context.Key.StackId);
-		CompleteAction(Context.Key);
-		return;
+		FMessageLog(SupertalkMessageLogName).Error(FText::Format(LOCTEXT("FunctionCallBadArguments", "Failed to call function from script: {0} ({1})"), FText::FromString(Params->Arguments), FText::FromString(Error)));
 	}
 
-	if (Params->JumpTarget == NAME_None)
+	if (!bSucceeded || !bIsFunctionCallLatent)
 	{
-		// Forcefully end this stack
-		Stack->QueuedActions.Empty();
+		// MakeLatentFunction was not called, complete this event immediately
 		CompleteAction(Context.Key);
-		return;
 	}
-	
-	const FSupertalkSection* NewSection = Context.Source->Sections.Find(Params->JumpTarget);
-	if (NewSection == nullptr)
+}
+
+TSharedPtr<const FSupertalkCommandFunction> USupertalkPlayer::FindNativeCommand(FName FunctionName) const
+{
+	if (CommandRegistry.IsValid())
 	{
-		MessageLog.Error(FText::Format(LOCTEXT("JumpSectionError", "Cannot jump to unknown section '{0}'"), FText::FromName(Params->JumpTarget)));
-		CompleteAction(Context.Key);
-		return;
+		if (TSharedPtr<const FSupertalkCommandFunction> Command = CommandRegistry->FindCommand(FunctionName))
+		{
+			return Command;
+		}
 	}
 
-	Stack->QueuedActions.Empty();
-	PushActions(Stack->StackId, Context.Source, NewSection->Actions);
-	CompleteAction(Context.Key);
+	for (const TSharedRef<FSupertalkCommandRegistry>& Registry : SharedCommandRegistries)
+	{
+		if (TSharedPtr<const FSupertalkCommandFunction> Command = Registry->FindCommand(FunctionName))
+		{
+			return Command;
+		}
+	}
+
+	return nullptr;
 }
 
-void USupertalkPlayer::HandleParallel(const FSupertalkActionWithContext& Context)
+const FSupertalkCommandTarget* USupertalkPlayer::FindCommandTarget(FName FunctionName)
 {
-	USupertalkParallelParams* Params = CastChecked<USupertalkParallelParams>(Context.Action.Params);
-	if (Params->SubActions.Num() == 0)
+	if (const FSupertalkCommandTarget* Existing = CommandTargets.Find(FunctionName))
 	{
-		UE_LOG(LogSupertalk, Warning, TEXT("Parallel action with no subactions, skipped"));
-		CompleteAction(Context.Key);
-		return;
+		if (Existing->Function.IsExplicitlyNull())
+		{
+			// None of the receivers have this function.
+			return nullptr;
+		}
+
+		if (Existing->Receiver.IsValid() && Existing->Function.IsValid())
+		{
+			return Existing;
+		}
+
+		// The receiver was destroyed or its class was reinstanced, look it up again.
+	}
+
+	FSupertalkCommandTarget& Target = CommandTargets.Add(FunctionName);
+	for (UObject* Receiver : FunctionCallReceivers)
+	{
+		if (!IsValid(Receiver))
+		{
+			continue;
+		}
+
+		if (UFunction* Function = Receiver->FindFunction(FunctionName))
+		{
+			Target.Receiver = Receiver;
+			Target.Function = Function;
+			return &Target;
+		}
 	}
 
-	FSupertalkStack* SourceStack = Stacks.Find(Context.Key.StackId);
+	return nullptr;
+}
+
+void USupertalkPlayer::HandleParallel(const FSupertalkInstructionContext& Context)
+{
+	const FSupertalkInstruction& Instruction = Context.GetInstruction();
+	const TArray<int32>& Targets = Context.Script->Program.Targets;
+
+	FSupertalkStack* SourceStack = GetStack(Context.Key.Stack);
 	if (SourceStack == nullptr)
 	{
-		UE_LOG(LogSupertalk, Error, TEXT("Unknown stack %u when setting up parallel execution"), Context.Key.StackId);
+		UE_LOG(LogSupertalk, Error, TEXT("Unknown stack %d when setting up parallel execution"), Context.Key.Stack.Index);
 		CompleteAction(Context.Key);
 		return;
 	}
 
-	for (const FSupertalkAction& Action : Params->SubActions)
+	// The last target is where the source stack resumes once every branch has completed.
+	const int32 NumBranches = Instruction.NumTargets - 1;
+	SourceStack->ProgramCounter = Targets[Instruction.Operand + NumBranches];
+
+	for (int32 Idx = 0; Idx < NumBranches; ++Idx)
 	{
-		FSupertalkStack& Stack = CreateNewStack();
-		Stack.SourceId = SourceStack->StackId;
-		SourceStack->WaitingOn.Add(Stack.StackId);
+		const FSupertalkStackHandle Branch = CreateNewStack(Context.Binding, Targets[Instruction.Operand + Idx]);
+		GetStack(Branch)->Source = Context.Key.Stack;
 
-		PushAction(Stack, Context.Source, Action);
-		TickStack(Stack.StackId);
+		// Creating a stack may have moved the source stack.
+		++GetStack(Context.Key.Stack)->NumWaitingOn;
+
+		TickStack(Branch);
 	}
 
 	CompleteAction(Context.Key);
 }
 
-void USupertalkPlayer::FinishWaitingOnStack(uint32 ExitingId, uint32 WaitingId)
+void USupertalkPlayer::FinishWaitingOnStack(FSupertalkStackHandle Exiting, FSupertalkStackHandle Waiting)
 {
-	FSupertalkStack* Stack = Stacks.Find(WaitingId);
+	FSupertalkStack* Stack = GetStack(Waiting);
 	if (Stack == nullptr)
 	{
-		UE_LOG(LogSupertalk, Error, TEXT("FinishWaitingOnStack was given an invalid WaitingId of %u"), WaitingId);
-		return;
-	}
-
-	if (!Stack->WaitingOn.Remove(ExitingId))
-	{
-		UE_LOG(LogSupertalk, Error, TEXT("FinishWaitingOnStack was given an invalid ExitingId of %u for stack %u"), ExitingId, WaitingId);
+		UE_LOG(LogSupertalk, Error, TEXT("FinishWaitingOnStack was given an invalid waiting stack %d (generation %u)"), Waiting.Index, Waiting.Generation);
 		return;
 	}
 
-	TickStack(WaitingId);
-}
-
-void USupertalkPlayer::HandleQueue(const FSupertalkActionWithContext& Context)
-{
-	USupertalkQueueParams* Params = CastChecked<USupertalkQueueParams>(Context.Action.Params);
-	if (Params->SubActions.Num() == 0)
+	if (Stack->NumWaitingOn <= 0)
 	{
-		CompleteAction(Context.Key);
+		UE_LOG(LogSupertalk, Error, TEXT("FinishWaitingOnStack was given exiting stack %d but stack %d is not waiting on anything"), Exiting.Index, Waiting.Index);
 		return;
 	}
 
-	PushActions(Context.Key.StackId, Context.Source, Params->SubActions);
-	CompleteAction(Context.Key);
+	--Stack->NumWaitingOn;
+	TickStack(Waiting);
 }
 
-void USupertalkPlayer::HandleConditional(const FSupertalkActionWithContext& Context)
+void USupertalkPlayer::HandleBranch(const FSupertalkInstructionContext& Context)
 {
-	USupertalkConditionalParams* Params = CastChecked<USupertalkConditionalParams>(Context.Action.Params);
+	const FSupertalkInstruction& Instruction = Context.GetInstruction();
+	USupertalkConditionalParams* Params = CastChecked<USupertalkConditionalParams>(Instruction.Params);
 
-	const USupertalkValue* Value = nullptr;
+	FSupertalkValue Value;
 	if (IsValid(Params->Expression))
 	{
-		Value = Params->Expression->Evaluate(this);
+		Value = Params->Expression->Evaluate(this, Context.Binding);
 	}
-	else
+	else if (IsValid(Params->Value_DEPRECATED))
 	{
-		Value = Params->Value_DEPRECATED;
+		Value = Params->Value_DEPRECATED->Resolve(this, Context.Binding);
 	}
 
-	Value = Value ? Value->GetResolvedValue(this) : nullptr;
+	// Targets are [false branch, end], the true branch immediately follows this instruction.
+	const TArray<int32>& Targets = Context.Script->Program.Targets;
+	FSupertalkStack& Stack = *GetStack(Context.Key.Stack);
 
 	bool bConditionalValue;
-	if (Value)
+	if (!Value.IsNone())
 	{
-		const USupertalkBooleanValue* BoolValue = Cast<USupertalkBooleanValue>(Value);
-		if (!BoolValue)
+		if (!Value.IsBoolean())
 		{
-			UE_LOG(LogSupertalk, Warning, TEXT("Conditional action received non-boolean value '%s', skipping (non-boolean values are not supported at this time)"), *Value->ToDisplayText().ToString());
+			UE_LOG(LogSupertalk, Warning, TEXT("Conditional action received non-boolean value '%s', skipping (non-boolean values are not supported at this time)"), *Value.ToDisplayText().ToString());
+			Stack.ProgramCounter = Targets[Instruction.Operand + 1];
 			CompleteAction(Context.Key);
 			return;
 		}
 
-		bConditionalValue = BoolValue->bValue;
+		bConditionalValue = Value.GetBoolean();
 	}
 	else
 	{
 		bConditionalValue = false;
 	}
 
-	PushAction(Context.Key.StackId, Context.Source, bConditionalValue ? Params->TrueAction : Params->FalseAction);
+	if (!bConditionalValue)
+	{
+		Stack.ProgramCounter = Targets[Instruction.Operand];
+	}
+
 	CompleteAction(Context.Key);
 }
 
@@ -4,11 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "SupertalkLine.h"
+#include "SupertalkValue.h"
+#include "UObject/ObjectKey.h"
 #include "SupertalkPlayer.generated.h"
 
 class USupertalkValue;
 class USupertalkExpression;
 class USupertalkPlayer;
+class FSupertalkCommandRegistry;
+class USupertalkSubsystem;
+struct FStreamableHandle;
 
 UENUM()
 enum class ESupertalkOperation : uint8
@@ -39,6 +44,7 @@ struct SUPERTALK_API FSupertalkAction
 	{
 		Operation = ESupertalkOperation::Noop;
 		Params = nullptr;
+		SourceLine = INDEX_NONE;
 	}
 
 	UPROPERTY(VisibleAnywhere)
@@ -46,6 +52,10 @@ struct SUPERTALK_API FSupertalkAction
 
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<USupertalkOperationParams> Params;
+
+	// Line in the source file this action was parsed from, for diagnostics.
+	UPROPERTY(VisibleAnywhere)
+	int32 SourceLine;
 };
 
 USTRUCT()
@@ -60,6 +70,111 @@ struct SUPERTALK_API FSupertalkSection
 	TArray<FSupertalkAction> Actions;
 };
 
+UENUM()
+enum class ESupertalkOpCode : uint8
+{
+	// Ends execution of the current stack.
+	End,
+	Line,
+	Choice,
+	Assign,
+	Call,
+	// Continues execution at the instruction index stored in Operand.
+	Goto,
+	// Evaluates a conditional. Targets[Operand] is the false branch and Targets[Operand + 1] is where both branches rejoin.
+	Branch,
+	// Starts a new stack at each of Targets[Operand .. Operand + NumTargets - 2], then continues at the last target
+	// once all of them have completed.
+	Parallel
+};
+
+USTRUCT()
+struct SUPERTALK_API FSupertalkInstruction
+{
+	GENERATED_BODY()
+
+	FSupertalkInstruction()
+	{
+		OpCode = ESupertalkOpCode::End;
+		Params = nullptr;
+		Operand = INDEX_NONE;
+		NumTargets = 0;
+		SourceLine = INDEX_NONE;
+	}
+
+	UPROPERTY(VisibleAnywhere)
+	ESupertalkOpCode OpCode;
+
+	UPROPERTY(VisibleAnywhere)
+	TObjectPtr<USupertalkOperationParams> Params;
+
+	// Meaning depends on OpCode, see ESupertalkOpCode.
+	UPROPERTY(VisibleAnywhere)
+	int32 Operand;
+
+	UPROPERTY(VisibleAnywhere)
+	int32 NumTargets;
+
+	// Copied from the action the instruction was compiled from.
+	UPROPERTY(VisibleAnywhere)
+	int32 SourceLine;
+};
+
+// A script compiled down to a flat list of instructions. Nested actions (queues, choices, conditionals, etc.) are laid out
+// inline and section jumps are resolved to instruction indices, so running a script never has to copy actions around.
+USTRUCT()
+struct SUPERTALK_API FSupertalkProgram
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	TArray<FSupertalkInstruction> Instructions;
+
+	// Jump tables for instructions with more than one destination.
+	UPROPERTY(VisibleAnywhere)
+	TArray<int32> Targets;
+
+	// Index of the first instruction of each section.
+	UPROPERTY(VisibleAnywhere)
+	TMap<FName, int32> SectionEntries;
+
+	FORCEINLINE bool IsEmpty() const { return Instructions.Num() == 0; }
+
+	// The section an instruction belongs to and its offset from the section entry.
+	bool FindSection(int32 Instruction, FName& OutSection, int32& OutOffset) const;
+
+	void Reset();
+};
+
+USTRUCT()
+struct SUPERTALK_API FSupertalkSectionDependencies
+{
+	GENERATED_BODY()
+
+	// Indices into FSupertalkDependencyManifest::Assets. Includes the assets of every section this one can jump to.
+	UPROPERTY(VisibleAnywhere)
+	TArray<int32> Assets;
+};
+
+// Every asset referenced by a script, built when the script is compiled so that they can be loaded ahead of time without
+// having to look through the script.
+USTRUCT()
+struct SUPERTALK_API FSupertalkDependencyManifest
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere)
+	TArray<FSoftObjectPath> Assets;
+
+	UPROPERTY(VisibleAnywhere)
+	TMap<FName, FSupertalkSectionDependencies> Sections;
+
+	// Assets needed to run the given section, or the whole script if Section is none.
+	void GetAssets(FName Section, TArray<FSoftObjectPath>& OutAssets) const;
+
+	void Reset();
+};
+
 struct FSupertalkScriptCustomVersion
 {
 	enum Type
@@ -70,6 +185,12 @@ struct FSupertalkScriptCustomVersion
 		// Added PreSave compilation support
 		PreSaveCompilation,
 
+		// Scripts store a compiled FSupertalkProgram alongside their sections
+		CompiledProgram,
+
+		// Compiling a script also builds its FSupertalkDependencyManifest
+		DependencyManifest,
+
 		VersionPlusOne,
 		LatestVersion = VersionPlusOne - 1
 	};
@@ -98,6 +219,24 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = Script)
 	TMap<FName, FSupertalkSection> Sections;
 
+	// Compiled form of Sections, this is what USupertalkPlayer actually executes.
+	UPROPERTY(VisibleAnywhere, Category = Script)
+	FSupertalkProgram Program;
+
+	// Names of the variables referenced by this script. Compiled variable references refer to these by index (their "slot"),
+	// which the player maps onto its own variable storage when the script is run.
+	UPROPERTY(VisibleAnywhere, Category = Script)
+	TArray<FName> Variables;
+
+	// Assets referenced by this script, see USupertalkPlayer::RunScriptAsync.
+	UPROPERTY(VisibleAnywhere, Category = Script)
+	FSupertalkDependencyManifest Dependencies;
+
+	// Rebuilds Program and Dependencies from Sections. Must be called whenever Sections is modified.
+	void CompileProgram();
+
+	virtual void PostLoad() override;
+
 #if WITH_EDITORONLY_DATA
 	UPROPERTY(VisibleAnywhere, Category = Script)
 	FString SourceData;
@@ -169,6 +308,10 @@ public:
 	UPROPERTY()
 	FName Variable;
 
+	// Index into USupertalkScript::Variables, INDEX_NONE for scripts compiled before variable slots existed.
+	UPROPERTY()
+	int32 VariableSlot = INDEX_NONE;
+
 	UPROPERTY()
 	TObjectPtr<USupertalkValue> Value_DEPRECATED;
 
@@ -184,8 +327,38 @@ class SUPERTALK_API USupertalkCallParams : public USupertalkOperationParams
 	GENERATED_BODY()
 
 public:
+	// The command as written, i.e. "Wait 1" or "Wait(1)".
 	UPROPERTY()
 	FString Arguments;
+
+	// Written as `> Func(arg1, Var.Member, "text")`. The arguments are in ArgumentExpressions instead of FunctionArguments and
+	// are passed as values, without going through text.
+	UPROPERTY()
+	bool bIsFunctionCall = false;
+
+	UPROPERTY()
+	TArray<TObjectPtr<USupertalkExpression>> ArgumentExpressions;
+
+	// Arguments split into the name of the function to call and the arguments to pass to it.
+	UPROPERTY()
+	FName FunctionName;
+
+	UPROPERTY()
+	FString FunctionArguments;
+
+	// Placeholders in FunctionArguments. If there are none then the arguments never change between calls.
+	UPROPERTY()
+	TArray<FSupertalkFormatArgument> FormatArguments;
+
+	// Must be called whenever Arguments is modified. If Script is set, placeholders are given variable slots in it.
+	void CompileArguments(USupertalkScript* Script = nullptr);
+
+	const FTextFormat& GetArgumentsFormat() const;
+
+	virtual void PostLoad() override;
+
+private:
+	mutable TOptional<FTextFormat> CachedArgumentsFormat;
 };
 
 UCLASS()
@@ -239,24 +412,58 @@ public:
 	virtual void PostLoad() override;
 };
 
+// Refers to a stack in USupertalkPlayer's stack pool. Slots are reused, so a handle is only valid as long as its generation
+// matches the generation of the slot it points to.
+struct FSupertalkStackHandle
+{
+	FSupertalkStackHandle()
+	{
+		Index = INDEX_NONE;
+		Generation = 0;
+	}
+
+	FSupertalkStackHandle(int32 InIndex, uint32 InGeneration)
+	{
+		Index = InIndex;
+		Generation = InGeneration;
+	}
+
+	int32 Index;
+	uint32 Generation;
+
+	FORCEINLINE bool IsValid() const
+	{
+		return Index != INDEX_NONE && Generation > 0;
+	}
+
+	friend bool operator==(const FSupertalkStackHandle& Lhs, const FSupertalkStackHandle& Rhs)
+	{
+		return Lhs.Index == Rhs.Index && Lhs.Generation == Rhs.Generation;
+	}
+
+	friend bool operator!=(const FSupertalkStackHandle& Lhs, const FSupertalkStackHandle& Rhs)
+	{
+		return !(Lhs == Rhs);
+	}
+};
+
 struct FSupertalkActionKey
 {
 	friend class USupertalkPlayer;
 	
 	FSupertalkActionKey()
 	{
-		StackId = 0;
 		ActionId = 0;
 	}
 
 	FORCEINLINE bool IsValid() const
 	{
-		return StackId > 0 && ActionId > 0;
+		return Stack.IsValid() && ActionId > 0;
 	}
 
 	friend bool operator==(const FSupertalkActionKey& Lhs, const FSupertalkActionKey& Rhs)
 	{
-		return Lhs.StackId == Rhs.StackId && Lhs.ActionId == Rhs.ActionId;
+		return Lhs.Stack == Rhs.Stack && Lhs.ActionId == Rhs.ActionId;
 	}
 
 	friend bool operator!=(const FSupertalkActionKey& Lhs, const FSupertalkActionKey& Rhs)
@@ -265,66 +472,95 @@ struct FSupertalkActionKey
 	}
 
 private:
-	uint32 StackId;
+	FSupertalkStackHandle Stack;
 	uint32 ActionId;
 };
 
-USTRUCT()
-struct FSupertalkActionWithContext
+// Identifies the instruction being executed by a stack. Passed around while handling a single instruction.
+struct FSupertalkInstructionContext
 {
-	GENERATED_BODY()
-
-	FSupertalkActionWithContext()
+	FSupertalkInstructionContext()
 	{
-		Key = FSupertalkActionKey();
-		Source = nullptr;
-		Action = FSupertalkAction();
+		Script = nullptr;
+		Binding = INDEX_NONE;
+		Instruction = INDEX_NONE;
 	}
 
-	UPROPERTY()
-	TObjectPtr<const class USupertalkScript> Source;
-
-	UPROPERTY()
-	FSupertalkAction Action;
-
+	const class USupertalkScript* Script;
+	int32 Binding;
+	int32 Instruction;
 	FSupertalkActionKey Key;
+
+	FORCEINLINE const FSupertalkInstruction& GetInstruction() const { return Script->Program.Instructions[Instruction]; }
 };
 
-USTRUCT()
+// Per-player execution state for one thread of a script. The program itself is shared through the script, a stack only
+// holds a cursor into it and references no objects, so the garbage collector never has to look at stacks.
 struct FSupertalkStack
 {
-	GENERATED_BODY()
-
 	FSupertalkStack()
 	{
-		StackId = 0;
-		SourceId = 0;
+		Generation = 1;
+		NumWaitingOn = 0;
+		bIsActive = false;
 		bIsTicking = false;
+		Binding = INDEX_NONE;
+		ProgramCounter = INDEX_NONE;
+		ActiveInstruction = INDEX_NONE;
+		PrefetchedLine = INDEX_NONE;
 	}
 
-	uint32 StackId;
+	// Incremented every time this slot is released so that stale handles can be detected.
+	uint32 Generation;
 
-	// Id of the stack that created this one.
-	uint32 SourceId;
+	// The stack that created this one.
+	FSupertalkStackHandle Source;
 
-	// Ids that this stack is waiting on.
-	TSet<uint32> WaitingOn;
+	// Number of stacks that this stack is waiting on.
+	int32 NumWaitingOn;
 
+	uint32 bIsActive : 1;
 	uint32 bIsTicking : 1;
 
-	UPROPERTY()
-	FSupertalkActionWithContext ActiveAction;
+	// Index into USupertalkPlayer's script bindings, which hold the script being executed.
+	int32 Binding;
+
+	// Index of the next instruction to execute in the script's program.
+	int32 ProgramCounter;
+
+	// Index of the instruction that is currently executing, only valid while ActiveKey is valid.
+	int32 ActiveInstruction;
+
+	// The furthest line that has been passed to OnPrefetchLine, so that lines aren't prefetched more than once.
+	int32 PrefetchedLine;
+
+	FSupertalkActionKey ActiveKey;
+};
+
+// Maps a script's variable slots onto a player's variable slots.
+USTRUCT()
+struct FSupertalkScriptBinding
+{
+	GENERATED_BODY()
 
 	UPROPERTY()
-	TArray<FSupertalkActionWithContext> QueuedActions;
+	TObjectPtr<const class USupertalkScript> Script = nullptr;
+
+	// Player variable slot for each entry in USupertalkScript::Variables.
+	TArray<int32> Slots;
 };
 
 DECLARE_DELEGATE(FSupertalkEventCompletedDelegate);
+DECLARE_DELEGATE_OneParam(FSupertalkScriptReadyDelegate, bool /* bStarted */);
 
 DECLARE_DELEGATE_OneParam(FSupertalkChoiceCompletedDelegate, int32);
 DECLARE_DELEGATE_TwoParams(FSupertalkPlayLineDelegate, const FSupertalkLine&, FSupertalkEventCompletedDelegate Completed);
 DECLARE_DELEGATE_ThreeParams(FSupertalkPlayChoiceDelegate, const FSupertalkLine&, const TArray<FText>& Choices, FSupertalkChoiceCompletedDelegate Completed);
-DECLARE_DELEGATE_RetVal_TwoParams(const USupertalkValue*, FSupertalkProvideVariableDelegate, const USupertalkPlayer* Player, FName Name);
+DECLARE_DELEGATE_OneParam(FSupertalkPrefetchLineDelegate, const FSupertalkLine&);
+DECLARE_DELEGATE_RetVal_TwoParams(FSupertalkValue, FSupertalkProvideVariableDelegate, const USupertalkPlayer* Player, FName Name);
+
+// A native command, see FSupertalkCommandRegistry. Returning false fails the command, OutError explains why.
+using FSupertalkCommandFunction = TFunction<bool(USupertalkPlayer& Player, TConstArrayView<FSupertalkValue> Arguments, FString& OutError)>;
 
 // Used to let a script know that a latent function has completed.
 USTRUCT(BlueprintType)
@@ -340,6 +576,23 @@ private:
 	FSupertalkEventCompletedDelegate Completed;
 };
 
+// A function that a command resolved to, see USupertalkPlayer::FindCommandTarget.
+struct FSupertalkCommandTarget
+{
+	TWeakObjectPtr<UObject> Receiver;
+	TWeakObjectPtr<UFunction> Function;
+};
+
+// Parameters for a function call that have been imported from a command's arguments ahead of time.
+struct FSupertalkFunctionParameters : public FNoncopyable
+{
+	explicit FSupertalkFunctionParameters(UFunction* InFunction);
+	~FSupertalkFunctionParameters();
+
+	TWeakObjectPtr<UFunction> Function;
+	uint8* Memory;
+};
+
 USTRUCT()
 struct FSupertalkVariableProviderObject
 {
@@ -359,26 +612,85 @@ class SUPERTALK_API USupertalkPlayer : public UObject
 
 public:
 	USupertalkPlayer();
+
+	virtual void BeginDestroy() override;
+
+	// Only counts the player's own execution state, scripts are shared between players and report their own size.
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 	
+	// Setting a variable to none removes it.
+	void SetVariable(FName Name, const FSupertalkValue& Value);
 	void SetVariable(FName Name, const USupertalkValue* Value);
 	void SetVariable(FName Name, bool Value);
 	void SetVariable(FName Name, FText Value);
 	
-	const USupertalkValue* GetVariable(FName Name) const;
+	FSupertalkValue GetVariable(FName Name) const;
+
+	// Used by compiled scripts. Binding is this player's binding for the script that ScriptSlot (an index into the script's
+	// variables) belongs to. Falls back to looking up Name if either is INDEX_NONE.
+	FSupertalkValue GetVariable(FName Name, int32 Binding, int32 ScriptSlot) const;
+
+	// The binding to pass to GetVariable and USupertalkValue::Resolve for Script, INDEX_NONE if this player hasn't run it.
+	int32 FindBinding(const USupertalkScript* Script) const;
 	void ClearVariables();
 
 	void AddFunctionCallReceiver(UObject* Obj);
+
+	// Native commands are checked before function call receivers. Registries can be shared between players.
+	void AddCommandRegistry(TSharedRef<FSupertalkCommandRegistry> Registry);
+
+	// Registers a native command with this player's own registry, see FSupertalkCommandRegistry.
+	// Defined in SupertalkCommandRegistry.h, include that to use this.
+	template<auto Func, typename... ObjectTypes>
+	void RegisterCommand(FName Name, ObjectTypes*... Objects);
+
+	FSupertalkCommandRegistry& GetCommandRegistry();
 	void AddVariableProvider(FSupertalkProvideVariableDelegate Provider);
 	void AddVariableProvider(UObject* Object, UClass* ClassFilter = nullptr);
 
-	void RunScript(const class USupertalkScript* Script, FName InitialSection = NAME_None);
+	// Returns false if the script couldn't be started (a script is already running, the section doesn't exist, etc).
+	bool RunScript(const class USupertalkScript* Script, FName InitialSection = NAME_None);
+
+	// Streams in the script and the assets that InitialSection (and any section it can jump to) needs, then runs it.
+	// OnReady is called right after RunScript with what it returned, or with false if the script couldn't be loaded. The
+	// assets are kept loaded until the script finishes.
+	void RunScriptAsync(TSoftObjectPtr<USupertalkScript> Script, FName InitialSection = NAME_None, FSupertalkScriptReadyDelegate OnReady = FSupertalkScriptReadyDelegate());
 	void Stop();
 
-	FORCEINLINE bool IsRunningScript() const { return Stacks.Num() > 0; }
+	// Keeps an asset that a script resolved loaded until the script finishes, see USupertalkSoftObjectValue.
+	void RetainResolvedAsset(UObject* Asset) const;
+
+	// Writes the running script's position and the player's variables. Stacks are stored as a section and an offset into
+	// it, names are stored once in a table, and objects are stored as paths. Function call receivers, variable providers,
+	// and command registries are not saved.
+	void SaveState(FArchive& Ar);
+
+	// Replaces the player's state with one written by SaveState. Actions that were in progress when the state was saved are
+	// executed again (lines are played again, latent functions are called again, etc). Returns false and leaves the player
+	// alone if the data is corrupt or a script it was running has changed.
+	bool RestoreState(FArchive& Ar);
+
+	FORCEINLINE bool IsRunningScript() const { return NumActiveStacks > 0; }
+
+	// Total number of actions (lines, choices, assignments, commands, conditionals, and parallel blocks) this player has
+	// executed. Jumps aren't counted.
+	FORCEINLINE uint64 GetNumExecutedActions() const { return NumExecutedActions; }
+
+	// Players owned by a USupertalkSubsystem don't tick when an action completes, the subsystem ticks them once per frame.
+	FORCEINLINE bool IsScheduled() const { return Scheduler.IsValid(); }
 
 	FSupertalkPlayLineDelegate OnPlayLineEvent;
 	FSupertalkPlayChoiceDelegate OnPlayChoiceEvent;
 
+	// Number of upcoming lines passed to OnPrefetchLineEvent whenever a line is played, zero (the default) disables it.
+	// Lookahead only continues past lines and assignments - it stops at the next choice (after prefetching its line),
+	// conditional, function call, or parallel block, since where the script goes after those isn't known yet.
+	FORCEINLINE void SetLookahead(int32 NumLines) { LookaheadLines = FMath::Max(NumLines, 0); }
+
+	// Lines that are likely to play soon, i.e. to start streaming voice-over or portraits. This is only a hint, a
+	// prefetched line may never be played.
+	FSupertalkPrefetchLineDelegate OnPrefetchLineEvent;
+
 	// When called from a function that was executed by a running script, this will let the function
 	// become latent. Use the returned finalizer
 	UFUNCTION(BlueprintCallable)
@@ -391,20 +703,46 @@ protected:
 
 	virtual void OnPlayLine(const FSupertalkLine& Line, FSupertalkEventCompletedDelegate Completed);
 	virtual void OnPlayChoice(const FSupertalkLine& Line, const TArray<FText>& Choices, FSupertalkChoiceCompletedDelegate Completed);
+	virtual void OnPrefetchLine(const FSupertalkLine& Line);
 
 private:
+	friend class USupertalkSubsystem;
+
 	uint32 NextActionId;
-	uint32 NextStackId;
 
+	// Pool of stacks, indexed by FSupertalkStackHandle::Index. Inactive slots are kept around and reused.
+	// Scripts are kept alive by ScriptBindings, which are never removed.
+	TArray<FSupertalkStack> Stacks;
+
+	TArray<int32> FreeStacks;
+	int32 NumActiveStacks;
+
+	uint64 NumExecutedActions;
+
+	// Variables are stored densely, VariableSlots maps names onto indices in VariableValues and VariableNames.
+	// Slots are never removed, unset variables hold a none value.
 	UPROPERTY()
-	TMap<uint32, FSupertalkStack> Stacks;
+	TArray<FSupertalkValue> VariableValues;
+
+	TArray<FName> VariableNames;
+	TMap<FName, int32> VariableSlots;
 
 	UPROPERTY()
-	TMap<FName, TObjectPtr<class USupertalkValue>> Variables;
+	TArray<FSupertalkScriptBinding> ScriptBindings;
 
 	UPROPERTY()
 	TArray<TObjectPtr<UObject>> FunctionCallReceivers;
 
+	// Created on demand by GetCommandRegistry.
+	TSharedPtr<FSupertalkCommandRegistry> CommandRegistry;
+	TArray<TSharedRef<FSupertalkCommandRegistry>> SharedCommandRegistries;
+
+	// Built lazily and cleared whenever the receivers change. Null functions are cached misses.
+	TMap<FName, FSupertalkCommandTarget> CommandTargets;
+
+	// Imported parameters for commands with constant arguments, keyed by the command's params.
+	TMap<TObjectKey<USupertalkCallParams>, TSharedPtr<FSupertalkFunctionParameters>> ConstantCallParameters;
+
 	UPROPERTY()
 	TArray<FSupertalkVariableProviderObject> VariableProviderObjects;
 	TArray<FSupertalkProvideVariableDelegate> VariableProviderDelegates;
@@ -412,39 +750,86 @@ private:
 	bool bIsFunctionCallLatent;
 	FSupertalkLatentFunctionFinalizer* CurrentFunctionFinalizer = nullptr;
 
-	FSupertalkStack& CreateNewStack();
+	TWeakObjectPtr<USupertalkSubsystem> Scheduler;
 
-	uint32 GetNewActionId();
-	uint32 GetNewStackId();
+	int32 LookaheadLines = 0;
+
+	// Keeps the script and assets loaded by RunScriptAsync alive.
+	TArray<TSharedPtr<FStreamableHandle>> LoadHandles;
+
+	// Assets resolved from soft references while running, released along with LoadHandles.
+	UPROPERTY(Transient)
+	mutable TSet<TObjectPtr<UObject>> ResolvedAssets;
+
+	// Stacks that can run but are waiting for the scheduler.
+	TArray<FSupertalkStackHandle> PendingStacks;
+	bool bIsPendingTick = false;
+
+	// Stacks stop running instructions past this time and are rescheduled (FPlatformTime::Seconds, zero for no limit).
+	double TickDeadline = 0.0;
+
+	int32 FindOrAddVariableSlot(FName Name);
+	FSupertalkValue GetProvidedVariable(FName Name) const;
+
+	int32 BindScript(const USupertalkScript* Script);
+
+	// Note that creating a stack may reallocate the pool, invalidating any stack pointers.
+	FSupertalkStackHandle CreateNewStack(int32 Binding, int32 ProgramCounter);
+	void ReleaseStack(FSupertalkStackHandle Handle);
 
-	// Pushes actions onto the top of the stack. They will execute next, in the order given in the array.
-	void PushActions(uint32 StackId, const USupertalkScript* Script, const TArray<FSupertalkAction>& Actions);
+	FORCEINLINE FSupertalkStack* GetStack(FSupertalkStackHandle Handle)
+	{
+		if (Stacks.IsValidIndex(Handle.Index))
+		{
+			FSupertalkStack& Stack = Stacks[Handle.Index];
+			if (Stack.Generation == Handle.Generation && Stack.bIsActive)
+			{
+				return &Stack;
+			}
+		}
+
+		return nullptr;
+	}
+
+	FORCEINLINE const USupertalkScript* GetStackScript(const FSupertalkStack& Stack) const
+	{
+		return ScriptBindings[Stack.Binding].Script;
+	}
 
-	// Pushes a single action onto the top of the stack. It will execute next.
-	void PushAction(FSupertalkStack& Stack, const USupertalkScript* Script, const FSupertalkAction& Action);
-	void PushAction(uint32 StackId, const USupertalkScript* Script, const FSupertalkAction& Action);
+	uint32 GetNewActionId();
 
 	void CompleteActionAndTick(FSupertalkActionKey Key);
 	void CompleteAction(FSupertalkActionKey Key);
-	void TickStack(uint32 StackId);
+	void TickStack(FSupertalkStackHandle Handle);
 
-	void ExecuteAction(const FSupertalkActionWithContext& Context);
+	// Ticks the stack right away, or queues it up if the player is scheduled.
+	void TickOrScheduleStack(FSupertalkStackHandle Handle);
 
-	void HandlePlayLine(const FSupertalkActionWithContext& Context);
+	// Called by the scheduler. Returns the number of stacks that were ticked, stacks that didn't get to run before the
+	// deadline stay pending.
+	int32 TickPendingStacks(double Deadline);
+
+	// Removes a stack that has run out of instructions and notifies any stack that was waiting on it.
+	void ExitStack(FSupertalkStackHandle Handle);
+
+	void ExecuteInstruction(const FSupertalkInstructionContext& Context);
+
+	void HandlePlayLine(const FSupertalkInstructionContext& Context);
+	void PrefetchLines(const FSupertalkInstructionContext& Context);
 	
-	void HandlePlayChoice(const FSupertalkActionWithContext& Context);
+	void HandlePlayChoice(const FSupertalkInstructionContext& Context);
 	void ReceiveChoice(int32 ChoiceIndex, FSupertalkActionKey Key);
 	
-	void HandleAssign(const FSupertalkActionWithContext& Context);
+	void HandleAssign(const FSupertalkInstructionContext& Context);
 	
-	void HandleCall(const FSupertalkActionWithContext& Context);
+	void HandleCall(const FSupertalkInstructionContext& Context);
+	const FSupertalkCommandTarget* FindCommandTarget(FName FunctionName);
+	TSharedPtr<const FSupertalkCommandFunction> FindNativeCommand(FName FunctionName) const;
+	// Runs a command with a finalizer set and completes the action unless the command went latent.
+	void InvokeCommand(const FSupertalkInstructionContext& Context, const USupertalkCallParams* Params, TFunctionRef<bool(FString& OutError)> Invoke);
 	
-	void HandleJump(const FSupertalkActionWithContext& Context);
-	
-	void HandleParallel(const FSupertalkActionWithContext& Context);
-	void FinishWaitingOnStack(uint32 ExitingId, uint32 WaitingId);
-
-	void HandleQueue(const FSupertalkActionWithContext& Context);
+	void HandleParallel(const FSupertalkInstructionContext& Context);
+	void FinishWaitingOnStack(FSupertalkStackHandle Exiting, FSupertalkStackHandle Waiting);
 
-	void HandleConditional(const FSupertalkActionWithContext& Context);
+	void HandleBranch(const FSupertalkInstructionContext& Context);
 };
@@ -0,0 +1,32 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkStats.h"
+
+DEFINE_STAT(STAT_SupertalkActivePlayers);
+DEFINE_STAT(STAT_SupertalkLiveStacks);
+DEFINE_STAT(STAT_SupertalkActionsExecuted);
+DEFINE_STAT(STAT_SupertalkExpressionsEvaluated);
+DEFINE_STAT(STAT_SupertalkValuesResolved);
+DEFINE_STAT(STAT_SupertalkFormatTextCalls);
+DEFINE_STAT(STAT_SupertalkFormatText);
+DEFINE_STAT(STAT_SupertalkProviderHits);
+DEFINE_STAT(STAT_SupertalkProviderMisses);
+DEFINE_STAT(STAT_SupertalkFunctionCall);
+
+CSV_DEFINE_CATEGORY_MODULE(SUPERTALK_API, Supertalk, true);
+
+#if SUPERTALK_STATS_ENABLED
+
+namespace FSupertalkStats
+{
+	int32 ActivePlayers = 0;
+	int32 LiveStacks = 0;
+
+	void RecordFrame()
+	{
+		CSV_CUSTOM_STAT(Supertalk, ActivePlayers, ActivePlayers, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Supertalk, LiveStacks, LiveStacks, ECsvCustomStatOp::Set);
+	}
+}
+
+#endif
@@ -0,0 +1,74 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+
+#define SUPERTALK_STATS_ENABLED ((STATS || CSV_PROFILER) && !UE_BUILD_SHIPPING)
+
+DECLARE_STATS_GROUP(TEXT("Supertalk"), STATGROUP_Supertalk, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Players"), STAT_SupertalkActivePlayers, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Stacks"), STAT_SupertalkLiveStacks, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actions Executed"), STAT_SupertalkActionsExecuted, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Expressions Evaluated"), STAT_SupertalkExpressionsEvaluated, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Values Resolved"), STAT_SupertalkValuesResolved, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("FormatText Calls"), STAT_SupertalkFormatTextCalls, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FormatText"), STAT_SupertalkFormatText, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Provider Hits"), STAT_SupertalkProviderHits, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Provider Misses"), STAT_SupertalkProviderMisses, STATGROUP_Supertalk, SUPERTALK_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Function Call Dispatch"), STAT_SupertalkFunctionCall, STATGROUP_Supertalk, SUPERTALK_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(SUPERTALK_API, Supertalk);
+
+#if SUPERTALK_STATS_ENABLED
+
+namespace FSupertalkStats
+{
+	// Gauges, the stats system keeps its own copy but CSV stats are written out once per frame from these.
+	extern SUPERTALK_API int32 ActivePlayers;
+	extern SUPERTALK_API int32 LiveStacks;
+
+	// Called at the end of every frame by the module.
+	void RecordFrame();
+}
+
+// Counts something that happened this frame, i.e. SUPERTALK_STAT_INC(ActionsExecuted).
+#define SUPERTALK_STAT_INC(Stat) \
+	do \
+	{ \
+		INC_DWORD_STAT(STAT_Supertalk##Stat); \
+		CSV_CUSTOM_STAT(Supertalk, Stat, 1, ECsvCustomStatOp::Accumulate); \
+	} while (0)
+
+// Times the rest of the scope.
+#define SUPERTALK_STAT_SCOPE(Stat) \
+	SCOPE_CYCLE_COUNTER(STAT_Supertalk##Stat); \
+	CSV_SCOPED_TIMING_STAT(Supertalk, Stat)
+
+// Adjusts a value that carries over between frames, i.e. SUPERTALK_GAUGE_ADD(LiveStacks, -1). DWORD stats are unsigned,
+// so negative amounts are subtracted instead.
+#define SUPERTALK_GAUGE_ADD(Stat, Amount) \
+	do \
+	{ \
+		const int32 SupertalkGaugeAmount = (Amount); \
+		FSupertalkStats::Stat += SupertalkGaugeAmount; \
+		if (SupertalkGaugeAmount >= 0) \
+		{ \
+			INC_DWORD_STAT_BY(STAT_Supertalk##Stat, SupertalkGaugeAmount); \
+		} \
+		else \
+		{ \
+			DEC_DWORD_STAT_BY(STAT_Supertalk##Stat, -SupertalkGaugeAmount); \
+		} \
+	} while (0)
+
+#else
+
+#define SUPERTALK_STAT_INC(Stat)
+#define SUPERTALK_STAT_SCOPE(Stat)
+#define SUPERTALK_GAUGE_ADD(Stat, Amount)
+
+#endif
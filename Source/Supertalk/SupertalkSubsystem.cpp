@@ -0,0 +1,157 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkSubsystem.h"
+#include "Supertalk.h"
+#include "SupertalkPlayer.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarSupertalkFrameBudgetMs(
+	TEXT("Supertalk.FrameBudgetMs"),
+	1.0f,
+	TEXT("Time in milliseconds that scheduled Supertalk players can spend running scripts each frame. 0 for no limit."));
+
+USupertalkPlayer* USupertalkSubsystem::CreatePlayer(TSubclassOf<USupertalkPlayer> PlayerClass)
+{
+	USupertalkPlayer* Player = NewObject<USupertalkPlayer>(this, PlayerClass ? *PlayerClass : USupertalkPlayer::StaticClass());
+	AddPlayer(Player);
+	return Player;
+}
+
+void USupertalkSubsystem::AddPlayer(USupertalkPlayer* Player)
+{
+	check(Player);
+
+	if (Player->Scheduler == this)
+	{
+		return;
+	}
+
+	if (USupertalkSubsystem* Existing = Player->Scheduler.Get())
+	{
+		UE_LOG(LogSupertalk, Warning, TEXT("Player %s moved from subsystem %s to %s"), *Player->GetName(), *Existing->GetName(), *GetName());
+		Existing->RemovePlayer(Player);
+	}
+
+	Players.Add(Player);
+	Player->Scheduler = this;
+}
+
+void USupertalkSubsystem::RemovePlayer(USupertalkPlayer* Player)
+{
+	check(Player);
+
+	if (Player->Scheduler != this)
+	{
+		return;
+	}
+
+	Players.RemoveSingleSwap(Player);
+	Player->Scheduler.Reset();
+	Player->bIsPendingTick = false;
+
+	// Nothing is going to tick these anymore, don't leave the scripts hanging.
+	TArray<FSupertalkStackHandle> Pending = MoveTemp(Player->PendingStacks);
+	Player->PendingStacks.Reset();
+	for (const FSupertalkStackHandle& Handle : Pending)
+	{
+		if (Player->GetStack(Handle) != nullptr)
+		{
+			Player->TickStack(Handle);
+		}
+	}
+}
+
+FSupertalkSubsystemStats USupertalkSubsystem::GetStats() const
+{
+	FSupertalkSubsystemStats Result = Stats;
+	Result.NumPlayers = Players.Num();
+	Result.NumRunningPlayers = 0;
+	for (const USupertalkPlayer* Player : Players)
+	{
+		if (Player && Player->IsRunningScript())
+		{
+			++Result.NumRunningPlayers;
+		}
+	}
+
+	return Result;
+}
+
+void USupertalkSubsystem::Deinitialize()
+{
+	// The world is going away, there's nothing left for these scripts to talk to.
+	for (USupertalkPlayer* Player : Players)
+	{
+		if (Player)
+		{
+			Player->Scheduler.Reset();
+			Player->bIsPendingTick = false;
+			Player->Stop();
+		}
+	}
+
+	Players.Empty();
+	ScheduledPlayers.Empty();
+
+	Super::Deinitialize();
+}
+
+void USupertalkSubsystem::SchedulePlayer(USupertalkPlayer* Player)
+{
+	if (!Player->bIsPendingTick)
+	{
+		Player->bIsPendingTick = true;
+		ScheduledPlayers.Add(Player);
+	}
+}
+
+void USupertalkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = FMath::Max(CVarSupertalkFrameBudgetMs.GetValueOnGameThread(), 0.0f) / 1000.0;
+	const double Deadline = Budget > 0.0 ? StartTime + Budget : 0.0;
+
+	Stats.NumTickedPlayers = 0;
+	Stats.NumTickedStacks = 0;
+	Stats.NumDeferredPlayers = 0;
+
+	// Players scheduled while ticking (i.e. by a parallel branch finishing on another player) wait for the next frame.
+	TArray<TWeakObjectPtr<USupertalkPlayer>> Ticking = MoveTemp(ScheduledPlayers);
+	ScheduledPlayers.Reset();
+
+	for (int32 Idx = 0; Idx < Ticking.Num(); ++Idx)
+	{
+		if (Deadline > 0.0 && Stats.NumTickedPlayers > 0 && FPlatformTime::Seconds() > Deadline)
+		{
+			Stats.NumDeferredPlayers = Ticking.Num() - Idx;
+			ScheduledPlayers.Insert(&Ticking[Idx], Stats.NumDeferredPlayers, 0);
+			break;
+		}
+
+		USupertalkPlayer* Player = Ticking[Idx].Get();
+		if (Player == nullptr || Player->Scheduler != this)
+		{
+			continue;
+		}
+
+		Player->bIsPendingTick = false;
+		Stats.NumTickedStacks += Player->TickPendingStacks(Deadline);
+		++Stats.NumTickedPlayers;
+
+		if (Player->PendingStacks.Num() > 0)
+		{
+			++Stats.NumDeferredPlayers;
+			SchedulePlayer(Player);
+		}
+	}
+
+	Stats.TickSeconds = FPlatformTime::Seconds() - StartTime;
+	Stats.PeakTickSeconds = FMath::Max(Stats.PeakTickSeconds, Stats.TickSeconds);
+}
+
+TStatId USupertalkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USupertalkSubsystem, STATGROUP_Tickables);
+}
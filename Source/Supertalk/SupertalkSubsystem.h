@@ -0,0 +1,82 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/SubclassOf.h"
+#include "SupertalkSubsystem.generated.h"
+
+class USupertalkPlayer;
+
+USTRUCT(BlueprintType)
+struct SUPERTALK_API FSupertalkSubsystemStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	int32 NumPlayers = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	int32 NumRunningPlayers = 0;
+
+	// Players that were ticked during the last frame.
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	int32 NumTickedPlayers = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	int32 NumTickedStacks = 0;
+
+	// Players that still had stacks waiting to run when the frame budget ran out.
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	int32 NumDeferredPlayers = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	double TickSeconds = 0.0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Supertalk")
+	double PeakTickSeconds = 0.0;
+};
+
+// Owns any number of players and ticks them together once per frame. Actions that complete on a player owned by the
+// subsystem don't run the script from inside whatever callback completed them, the stack is queued up and continues on
+// the next tick of the subsystem instead. All players share a per-frame time budget (Supertalk.FrameBudgetMs), players
+// that don't get to run are first in line on the next frame.
+UCLASS()
+class SUPERTALK_API USupertalkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Creates a player that is owned and scheduled by this subsystem.
+	USupertalkPlayer* CreatePlayer(TSubclassOf<USupertalkPlayer> PlayerClass = nullptr);
+
+	// Takes ownership of an existing player. Players can't be scheduled by more than one subsystem.
+	void AddPlayer(USupertalkPlayer* Player);
+
+	// Stops scheduling the player, anything it had pending is ticked right away.
+	void RemovePlayer(USupertalkPlayer* Player);
+
+	FORCEINLINE const TArray<TObjectPtr<USupertalkPlayer>>& GetPlayers() const { return Players; }
+
+	// Includes a live count of players and running players, the rest is from the last tick.
+	FSupertalkSubsystemStats GetStats() const;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	friend class USupertalkPlayer;
+
+	void SchedulePlayer(USupertalkPlayer* Player);
+
+	UPROPERTY()
+	TArray<TObjectPtr<USupertalkPlayer>> Players;
+
+	// Players with pending stacks, in the order they'll be ticked.
+	TArray<TWeakObjectPtr<USupertalkPlayer>> ScheduledPlayers;
+
+	FSupertalkSubsystemStats Stats;
+};
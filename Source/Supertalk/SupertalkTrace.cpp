@@ -0,0 +1,189 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkTrace.h"
+#include "SupertalkPlayer.h"
+
+LLM_DEFINE_TAG(Supertalk);
+
+#if SUPERTALK_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_DEFINE(SupertalkChannel);
+
+UE_TRACE_EVENT_BEGIN(Supertalk, RunScript)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Script)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Section)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Supertalk, StackCreate)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(int32, Stack)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Script)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Supertalk, StackDestroy)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(int32, Stack)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Supertalk, Instruction)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(int32, Stack)
+	UE_TRACE_EVENT_FIELD(uint32, ActionId)
+	UE_TRACE_EVENT_FIELD(uint8, OpCode)
+	UE_TRACE_EVENT_FIELD(int32, SourceLine)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Script)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Section)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Supertalk, LatentBegin)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(int32, Stack)
+	UE_TRACE_EVENT_FIELD(uint32, ActionId)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Supertalk, LatentEnd)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(int32, Stack)
+	UE_TRACE_EVENT_FIELD(uint32, ActionId)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Supertalk, ProviderLookup)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, Player)
+	UE_TRACE_EVENT_FIELD(bool, bFound)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Name)
+UE_TRACE_EVENT_END()
+
+namespace
+{
+	FORCEINLINE uint64 GetPlayerId(const USupertalkPlayer* Player)
+	{
+		return static_cast<uint64>(reinterpret_cast<UPTRINT>(Player));
+	}
+
+	const TCHAR* GetOpCodeName(ESupertalkOpCode OpCode)
+	{
+		switch (OpCode)
+		{
+		case ESupertalkOpCode::End: return TEXT("End");
+		case ESupertalkOpCode::Line: return TEXT("Line");
+		case ESupertalkOpCode::Choice: return TEXT("Choice");
+		case ESupertalkOpCode::Assign: return TEXT("Assign");
+		case ESupertalkOpCode::Call: return TEXT("Call");
+		case ESupertalkOpCode::Goto: return TEXT("Goto");
+		case ESupertalkOpCode::Branch: return TEXT("Branch");
+		case ESupertalkOpCode::Parallel: return TEXT("Parallel");
+		}
+
+		return TEXT("Unknown");
+	}
+}
+
+void FSupertalkTrace::OutputRunScript(const USupertalkPlayer* Player, const USupertalkScript* Script, FName Section)
+{
+	const FString ScriptName = GetNameSafe(Script);
+	const FString SectionName = Section.ToString();
+
+	UE_TRACE_LOG(Supertalk, RunScript, SupertalkChannel)
+		<< RunScript.Cycle(FPlatformTime::Cycles64())
+		<< RunScript.Player(GetPlayerId(Player))
+		<< RunScript.Script(*ScriptName, ScriptName.Len())
+		<< RunScript.Section(*SectionName, SectionName.Len());
+}
+
+void FSupertalkTrace::OutputStackCreate(const USupertalkPlayer* Player, int32 Stack, const USupertalkScript* Script)
+{
+	const FString ScriptName = GetNameSafe(Script);
+
+	UE_TRACE_LOG(Supertalk, StackCreate, SupertalkChannel)
+		<< StackCreate.Cycle(FPlatformTime::Cycles64())
+		<< StackCreate.Player(GetPlayerId(Player))
+		<< StackCreate.Stack(Stack)
+		<< StackCreate.Script(*ScriptName, ScriptName.Len());
+}
+
+void FSupertalkTrace::OutputStackDestroy(const USupertalkPlayer* Player, int32 Stack)
+{
+	UE_TRACE_LOG(Supertalk, StackDestroy, SupertalkChannel)
+		<< StackDestroy.Cycle(FPlatformTime::Cycles64())
+		<< StackDestroy.Player(GetPlayerId(Player))
+		<< StackDestroy.Stack(Stack);
+}
+
+void FSupertalkTrace::OutputInstruction(const USupertalkPlayer* Player, const FSupertalkInstructionContext& Context)
+{
+	// Named differently from the event, UE_TRACE_LOG declares a local with the event's name.
+	const FSupertalkInstruction& Executing = Context.GetInstruction();
+	const FString ScriptName = GetNameSafe(Context.Script);
+
+	FName Section;
+	int32 Offset = 0;
+	Context.Script->Program.FindSection(Context.Instruction, Section, Offset);
+	const FString SectionName = Section.ToString();
+
+	UE_TRACE_LOG(Supertalk, Instruction, SupertalkChannel)
+		<< Instruction.Cycle(FPlatformTime::Cycles64())
+		<< Instruction.Player(GetPlayerId(Player))
+		<< Instruction.Stack(Context.Key.Stack.Index)
+		<< Instruction.ActionId(Context.Key.ActionId)
+		<< Instruction.OpCode(static_cast<uint8>(Executing.OpCode))
+		<< Instruction.SourceLine(Executing.SourceLine)
+		<< Instruction.Script(*ScriptName, ScriptName.Len())
+		<< Instruction.Section(*SectionName, SectionName.Len());
+}
+
+void FSupertalkTrace::OutputLatentBegin(const USupertalkPlayer* Player, int32 Stack, uint32 ActionId)
+{
+	UE_TRACE_LOG(Supertalk, LatentBegin, SupertalkChannel)
+		<< LatentBegin.Cycle(FPlatformTime::Cycles64())
+		<< LatentBegin.Player(GetPlayerId(Player))
+		<< LatentBegin.Stack(Stack)
+		<< LatentBegin.ActionId(ActionId);
+}
+
+void FSupertalkTrace::OutputLatentEnd(const USupertalkPlayer* Player, int32 Stack, uint32 ActionId)
+{
+	UE_TRACE_LOG(Supertalk, LatentEnd, SupertalkChannel)
+		<< LatentEnd.Cycle(FPlatformTime::Cycles64())
+		<< LatentEnd.Player(GetPlayerId(Player))
+		<< LatentEnd.Stack(Stack)
+		<< LatentEnd.ActionId(ActionId);
+}
+
+void FSupertalkTrace::OutputProviderLookup(const USupertalkPlayer* Player, FName Name, bool bFound)
+{
+	const FString NameString = Name.ToString();
+
+	UE_TRACE_LOG(Supertalk, ProviderLookup, SupertalkChannel)
+		<< ProviderLookup.Cycle(FPlatformTime::Cycles64())
+		<< ProviderLookup.Player(GetPlayerId(Player))
+		<< ProviderLookup.bFound(bFound)
+		<< ProviderLookup.Name(*NameString, NameString.Len());
+}
+
+FString FSupertalkTrace::GetInstructionScopeName(const FSupertalkInstructionContext& Context)
+{
+	const FSupertalkInstruction& Instruction = Context.GetInstruction();
+
+	FString Name = GetOpCodeName(Instruction.OpCode);
+	if (const USupertalkCallParams* CallParams = Cast<USupertalkCallParams>(Instruction.Params))
+	{
+		if (CallParams->FunctionName != NAME_None)
+		{
+			Name += TEXT(" ");
+			Name += CallParams->FunctionName.ToString();
+		}
+	}
+
+	Name += FString::Printf(TEXT(" (%s:%d)"), *GetNameSafe(Context.Script), Instruction.SourceLine);
+	return Name;
+}
+
+#endif
@@ -0,0 +1,65 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Misc/Optional.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+class USupertalkPlayer;
+class USupertalkScript;
+struct FSupertalkInstructionContext;
+
+#define SUPERTALK_TRACE_ENABLED (UE_TRACE_ENABLED && !UE_BUILD_SHIPPING)
+
+LLM_DECLARE_TAG_API(Supertalk, SUPERTALK_API);
+
+#if SUPERTALK_TRACE_ENABLED
+
+// Enable with -trace=default,supertalk or Trace.Enable Supertalk.
+UE_TRACE_CHANNEL_EXTERN(SupertalkChannel, SUPERTALK_API);
+
+// Outputs the events of the Supertalk trace channel. Only called through the macros below so that none of this is
+// compiled into shipping builds.
+struct SUPERTALK_API FSupertalkTrace
+{
+	static void OutputRunScript(const USupertalkPlayer* Player, const USupertalkScript* Script, FName Section);
+	static void OutputStackCreate(const USupertalkPlayer* Player, int32 Stack, const USupertalkScript* Script);
+	static void OutputStackDestroy(const USupertalkPlayer* Player, int32 Stack);
+	static void OutputInstruction(const USupertalkPlayer* Player, const FSupertalkInstructionContext& Context);
+	static void OutputLatentBegin(const USupertalkPlayer* Player, int32 Stack, uint32 ActionId);
+	static void OutputLatentEnd(const USupertalkPlayer* Player, int32 Stack, uint32 ActionId);
+	static void OutputProviderLookup(const USupertalkPlayer* Player, FName Name, bool bFound);
+
+	// Used as the name of instruction timing scopes, i.e. "Call Wait (MyScript:12)".
+	static FString GetInstructionScopeName(const FSupertalkInstructionContext& Context);
+};
+
+#define SUPERTALK_TRACE_EVENT(Event, ...) \
+	do \
+	{ \
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(SupertalkChannel)) \
+		{ \
+			FSupertalkTrace::Output##Event(__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define SUPERTALK_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, SupertalkChannel)
+
+// The name is only built when the channel is enabled.
+#define SUPERTALK_TRACE_DYNAMIC_SCOPE(NameExpr) \
+	TOptional<FCpuProfilerTrace::FDynamicEventScope> PREPROCESSOR_JOIN(SupertalkTraceScope, __LINE__); \
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(SupertalkChannel)) \
+	{ \
+		PREPROCESSOR_JOIN(SupertalkTraceScope, __LINE__).Emplace(*(NameExpr), SupertalkChannel); \
+	}
+
+#else
+
+#define SUPERTALK_TRACE_EVENT(Event, ...)
+#define SUPERTALK_TRACE_SCOPE(Name)
+#define SUPERTALK_TRACE_DYNAMIC_SCOPE(NameExpr)
+
+#endif
@@ -1,11 +1,35 @@
 ﻿// Copyright (c) MissiveArts LLC
 
 #include "SupertalkUtilities.h"
+#include "SupertalkLine.h"
 #include "SupertalkPlayer.h"
+#include "SupertalkStats.h"
+#include "SupertalkTrace.h"
 #include "SupertalkValue.h"
+#include "UObject/ObjectKey.h"
 
 namespace FSupertalkUtilities
 {
+	struct FPropertyCacheKey
+	{
+		TObjectKey<UClass> Class;
+		TObjectKey<UClass> ClassFilter;
+		FName Name;
+
+		friend bool operator==(const FPropertyCacheKey& Lhs, const FPropertyCacheKey& Rhs)
+		{
+			return Lhs.Class == Rhs.Class && Lhs.ClassFilter == Rhs.ClassFilter && Lhs.Name == Rhs.Name;
+		}
+
+		friend uint32 GetTypeHash(const FPropertyCacheKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Class), GetTypeHash(Key.ClassFilter)), GetTypeHash(Key.Name));
+		}
+	};
+
+	// Null values are cached misses.
+	static TMap<FPropertyCacheKey, FProperty*> PropertyCache;
+
 	bool IsMemberExpression(const FString& Input)
 	{
 		return Input.Contains(TEXT("."));
@@ -13,61 +37,107 @@ namespace FSupertalkUtilities
 
 	FText FormatText(const FText& Format, const USupertalkPlayer* Player, bool bIsDisplayText)
 	{
-		check(Player);
+		TArray<FSupertalkFormatArgument> Arguments;
+		GetFormatArguments(Format, Arguments);
 
-		TArray<FString> ParameterNames;
-		FText::GetFormatPatternParameters(Format, ParameterNames);
+		return FormatText(FTextFormat(Format), Arguments, Player, INDEX_NONE, bIsDisplayText);
+	}
+
+	FText FormatText(const FTextFormat& Format, TConstArrayView<FSupertalkFormatArgument> Arguments, const USupertalkPlayer* Player, int32 Binding, bool bIsDisplayText)
+	{
+		SUPERTALK_TRACE_SCOPE(Supertalk_FormatText);
+		SUPERTALK_STAT_INC(FormatTextCalls);
+		SUPERTALK_STAT_SCOPE(FormatText);
+
+		check(Player);
 
 		FFormatNamedArguments FormatArgs;
-		for (const FString& Param : ParameterNames)
+		FormatArgs.Reserve(Arguments.Num());
+		for (const FSupertalkFormatArgument& Argument : Arguments)
 		{
-			if (IsMemberExpression(Param))
+			FSupertalkValue Value = Player->GetVariable(Argument.Variable, Binding, Argument.VariableSlot);
+			if (Argument.Members.Num() > 0)
 			{
-				TArray<FString> MemberStrings;
-				Param.ParseIntoArrayWS(MemberStrings, TEXT("."));
-				check(MemberStrings.Num() > 0);
+				Value = USupertalkMemberValue::ResolveMembers(Value, Argument.Members);
+			}
 
-				FName VarName = FName(MemberStrings[0]);
-				MemberStrings.RemoveAt(0);
+			if (Value.IsNone())
+			{
+				// Unresolved parameters are displayed as written.
+				FormatArgs.Add(Argument.Placeholder, FText::FromString(Argument.Placeholder));
+			}
+			else if (bIsDisplayText)
+			{
+				FormatArgs.Add(Argument.Placeholder, Value.ToDisplayText());
+			}
+			else
+			{
+				FormatArgs.Add(Argument.Placeholder, FText::FromString(Value.ToInternalString()));
+			}
+		}
+	
+		return FText::Format(Format, FormatArgs);
+	}
 
-				USupertalkMemberValue* MemberValue = NewObject<USupertalkMemberValue>();
-				MemberValue->Variable = VarName;
-				for (const FString& Member : MemberStrings)
-				{
-					MemberValue->Members.Add(FName(Member));
-				}
+	void GetFormatArguments(const FText& Format, TArray<FSupertalkFormatArgument>& OutArguments, USupertalkScript* Script)
+	{
+		TArray<FString> ParameterNames;
+		FText::GetFormatPatternParameters(Format, ParameterNames);
 
-				if (bIsDisplayText)
-				{
-					FormatArgs.Add(Param, MemberValue->ToResolvedDisplayText(Player));
-				}
-				else
+		OutArguments.Reserve(OutArguments.Num() + ParameterNames.Num());
+		for (const FString& Param : ParameterNames)
+		{
+			FSupertalkFormatArgument& Argument = OutArguments.AddDefaulted_GetRef();
+			Argument.Placeholder = Param;
+
+			TArray<FString> MemberStrings;
+			if (IsMemberExpression(Param) && Param.ParseIntoArrayWS(MemberStrings, TEXT(".")) > 0)
+			{
+				Argument.Variable = FName(MemberStrings[0]);
+				for (int32 Idx = 1; Idx < MemberStrings.Num(); ++Idx)
 				{
-					FormatArgs.Add(Param, FText::FromString(MemberValue->ToResolvedInternalString(Player)));
+					Argument.Members.Add(FName(MemberStrings[Idx]));
 				}
 			}
 			else
 			{
-				FName VarName(Param);
-				const USupertalkValue* Value = Player->GetVariable(VarName);
-				if (Value)
-				{
-					if (bIsDisplayText)
-					{
-						FormatArgs.Add(Param, Value->ToResolvedDisplayText(Player));
-					}
-					else
-					{
-						FormatArgs.Add(Param, FText::FromString(Value->ToResolvedInternalString(Player)));
-					}
-				}
-				else
-				{
-					FormatArgs.Add(Param, FText::FromName(VarName));
-				}
+				Argument.Variable = FName(Param);
+			}
+
+			if (Script)
+			{
+				Argument.VariableSlot = Script->Variables.AddUnique(Argument.Variable);
 			}
 		}
-	
-		return FText::Format(Format, FormatArgs);
+	}
+
+	FProperty* FindCachedProperty(UClass* Class, FName Name, UClass* ClassFilter)
+	{
+		check(IsInGameThread());
+		check(Class);
+
+		const FPropertyCacheKey Key{ Class, ClassFilter, Name };
+		if (FProperty** Cached = PropertyCache.Find(Key))
+		{
+			return *Cached;
+		}
+
+		FProperty* Property = Class->FindPropertyByName(Name);
+		if (Property && ClassFilter)
+		{
+			UClass* OwnerClass = Property->GetOwnerClass();
+			if (!OwnerClass || OwnerClass == ClassFilter || !OwnerClass->IsChildOf(ClassFilter))
+			{
+				Property = nullptr;
+			}
+		}
+
+		PropertyCache.Add(Key, Property);
+		return Property;
+	}
+
+	void ResetPropertyCache()
+	{
+		PropertyCache.Reset();
 	}
 }
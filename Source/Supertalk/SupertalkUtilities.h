@@ -5,9 +5,25 @@
 #include "CoreMinimal.h"
 
 class USupertalkPlayer;
+class USupertalkScript;
+struct FSupertalkFormatArgument;
 
 namespace FSupertalkUtilities
 {
 	SUPERTALK_API bool IsMemberExpression(const FString& Input);
 	SUPERTALK_API FText FormatText(const FText& Format, const USupertalkPlayer* Player, bool bIsDisplayText = true);
+
+	// Binding is Player's binding for the script that the arguments' variable slots belong to, arguments are looked up by
+	// name if it's INDEX_NONE.
+	SUPERTALK_API FText FormatText(const FTextFormat& Format, TConstArrayView<FSupertalkFormatArgument> Arguments, const USupertalkPlayer* Player, int32 Binding, bool bIsDisplayText = true);
+
+	// Parses the placeholders in Format so that they don't need to be parsed every time the text is formatted.
+	// If Script is set, each placeholder's variable is given a slot in it.
+	SUPERTALK_API void GetFormatArguments(const FText& Format, TArray<FSupertalkFormatArgument>& OutArguments, USupertalkScript* Script = nullptr);
+
+	// Finds a property by name on Class. If ClassFilter is set then the property must have been declared on a child class of
+	// the filter (not including the filter itself), as is the case with variable provider objects.
+	// Results, including missing properties, are cached until classes are reinstanced or reloaded.
+	SUPERTALK_API FProperty* FindCachedProperty(UClass* Class, FName Name, UClass* ClassFilter = nullptr);
+	SUPERTALK_API void ResetPropertyCache();
 }
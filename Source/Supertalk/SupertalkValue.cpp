@@ -4,106 +4,499 @@
 
 #include "Supertalk.h"
 #include "SupertalkPlayer.h"
+#include "SupertalkUtilities.h"
 
 #define LOCTEXT_NAMESPACE "SupertalkValue"
 
-const USupertalkValue* USupertalkValue::GetResolvedValue(const USupertalkPlayer* Player) const
+FSupertalkValue FSupertalkValue::MakeBoolean(bool bInValue)
 {
-	check(Player);
+	FSupertalkValue Result;
+	Result.Type = ESupertalkValueType::Boolean;
+	Result.bValue = bInValue;
+	return Result;
+}
+
+FSupertalkValue FSupertalkValue::MakeNumber(double InNumber)
+{
+	FSupertalkValue Result;
+	Result.Type = ESupertalkValueType::Number;
+	Result.Number = InNumber;
+	return Result;
+}
+
+FSupertalkValue FSupertalkValue::MakeText(const FText& InText)
+{
+	FSupertalkValue Result;
+	Result.Type = ESupertalkValueType::Text;
+	Result.Text = InText;
+	return Result;
+}
+
+FSupertalkValue FSupertalkValue::MakeName(FName InName)
+{
+	FSupertalkValue Result;
+	Result.Type = ESupertalkValueType::Name;
+	Result.Name = InName;
+	return Result;
+}
+
+FSupertalkValue FSupertalkValue::MakeObject(UObject* InObject)
+{
+	FSupertalkValue Result;
+	Result.Type = ESupertalkValueType::Object;
+	Result.Object = InObject;
+	return Result;
+}
+
+FSupertalkValue FSupertalkValue::MakeMapProperty(UObject* InOwner, FMapProperty* InProperty)
+{
+	FSupertalkValue Result;
+	Result.Type = ESupertalkValueType::MapProperty;
+	Result.Object = InOwner;
+	Result.MapProperty = InProperty;
+	return Result;
+}
+
+FSupertalkValue FSupertalkValue::FromProperty(const void* ValuePtr, UObject* Owner, FProperty* Property, bool bValueIsContainer)
+{
+	check(ValuePtr);
+	check(Property);
+
+	if (FObjectPropertyBase* ObjProp = CastField<FObjectPropertyBase>(Property))
+	{
+		return MakeObject(bValueIsContainer ? ObjProp->GetObjectPropertyValue_InContainer(ValuePtr) : ObjProp->GetObjectPropertyValue(ValuePtr));
+	}
+	else if (FBoolProperty* BoolProp = CastField<FBoolProperty>(Property))
+	{
+		return MakeBoolean(bValueIsContainer ? BoolProp->GetPropertyValue_InContainer(ValuePtr) : BoolProp->GetPropertyValue(ValuePtr));
+	}
+	else if (FTextProperty* TextProp = CastField<FTextProperty>(Property))
+	{
+		return MakeText(bValueIsContainer ? TextProp->GetPropertyValue_InContainer(ValuePtr) : TextProp->GetPropertyValue(ValuePtr));
+	}
+	else if (FNameProperty* NameProp = CastField<FNameProperty>(Property))
+	{
+		return MakeName(bValueIsContainer ? NameProp->GetPropertyValue_InContainer(ValuePtr) : NameProp->GetPropertyValue(ValuePtr));
+	}
+	else if (FMapProperty* MapProp = CastField<FMapProperty>(Property))
+	{
+		return MakeMapProperty(Owner, MapProp);
+	}
+
+	// Enums keep going through the text export below so that they display as their names.
+	FNumericProperty* NumericProp = CastField<FNumericProperty>(Property);
+	if (NumericProp && !NumericProp->IsEnum())
+	{
+		const void* Data = bValueIsContainer ? NumericProp->ContainerPtrToValuePtr<void>(ValuePtr) : ValuePtr;
+		return MakeNumber(NumericProp->IsFloatingPoint() ? NumericProp->GetFloatingPointPropertyValue(Data) : static_cast<double>(NumericProp->GetSignedIntPropertyValue(Data)));
+	}
 
-	const USupertalkValue* GoodValue = this;
-	const USupertalkValue* Value = this;
-	while (IsValid(Value))
+	FString Str;
+	if (bValueIsContainer)
+	{
+		Property->ExportText_InContainer(0, Str, ValuePtr, ValuePtr, nullptr, PPF_None);
+	}
+	else
 	{
-		GoodValue = Value;
-		Value = Value->ResolveValue(Player);
+		Property->ExportText_Direct(Str, ValuePtr, ValuePtr, nullptr, PPF_None);
 	}
 
-	return GoodValue;
+	return MakeText(FText::FromString(Str));
 }
 
-FText USupertalkValue::ToResolvedDisplayText(const USupertalkPlayer* Player) const
+void FSupertalkValue::SerializeState(FArchive& Ar)
 {
-	const USupertalkValue* Value = GetResolvedValue(Player);
-	if (IsValid(Value))
+	uint8 TypeValue = static_cast<uint8>(Type);
+	Ar << TypeValue;
+
+	if (Ar.IsLoading())
 	{
-		return Value->ToDisplayText();
+		*this = FSupertalkValue();
+		Type = static_cast<ESupertalkValueType>(TypeValue);
 	}
 
-	return ToDisplayText();
+	switch (Type)
+	{
+	default:
+		Ar.SetError();
+		*this = FSupertalkValue();
+		break;
+
+	case ESupertalkValueType::None:
+		break;
+
+	case ESupertalkValueType::Boolean:
+		{
+			uint8 Value = bValue ? 1 : 0;
+			Ar << Value;
+			bValue = Value != 0;
+		}
+		break;
+
+	case ESupertalkValueType::Number:
+		Ar << Number;
+		break;
+
+	case ESupertalkValueType::Text:
+		Ar << Text;
+		break;
+
+	case ESupertalkValueType::Name:
+		Ar << Name;
+		break;
+
+	case ESupertalkValueType::Object:
+		{
+			UObject* Value = Object;
+			Ar << Value;
+			Object = Value;
+		}
+		break;
+
+	case ESupertalkValueType::MapProperty:
+		{
+			UObject* Owner = Object;
+			FName PropertyName = MapProperty ? MapProperty->GetFName() : NAME_None;
+			Ar << Owner;
+			Ar << PropertyName;
+
+			if (Ar.IsLoading())
+			{
+				FMapProperty* Property = Owner ? FindFProperty<FMapProperty>(Owner->GetClass(), PropertyName) : nullptr;
+				*this = Property ? MakeMapProperty(Owner, Property) : FSupertalkValue();
+			}
+		}
+		break;
+	}
 }
 
-FString USupertalkValue::ToResolvedInternalString(const USupertalkPlayer* Player) const
+namespace
 {
-	const USupertalkValue* Value = GetResolvedValue(Player);
-	if (IsValid(Value))
+	// Same checks as the native command argument decoder: converting NaN or a number that doesn't fit is undefined, integers
+	// have to be strictly below Max + 1 since Max itself may not be representable as a double.
+	template<typename T>
+	bool FitsInNumber(double Number)
 	{
-		return Value->ToInternalString();
+		if constexpr (std::is_integral_v<T>)
+		{
+			return !FMath::IsNaN(Number) && Number >= static_cast<double>(TNumericLimits<T>::Lowest()) && Number < static_cast<double>(TNumericLimits<T>::Max()) + 1.0;
+		}
+		else
+		{
+			return !(Number < static_cast<double>(TNumericLimits<T>::Lowest()) || Number > static_cast<double>(TNumericLimits<T>::Max()));
+		}
 	}
 
-	return ToInternalString();
+	bool FitsInNumericProperty(const FNumericProperty* Property, double Number)
+	{
+		if (Property->IsA<FByteProperty>())
+		{
+			return FitsInNumber<uint8>(Number);
+		}
+		else if (Property->IsA<FInt8Property>())
+		{
+			return FitsInNumber<int8>(Number);
+		}
+		else if (Property->IsA<FInt16Property>())
+		{
+			return FitsInNumber<int16>(Number);
+		}
+		else if (Property->IsA<FUInt16Property>())
+		{
+			return FitsInNumber<uint16>(Number);
+		}
+		else if (Property->IsA<FIntProperty>())
+		{
+			return FitsInNumber<int32>(Number);
+		}
+		else if (Property->IsA<FUInt32Property>())
+		{
+			return FitsInNumber<uint32>(Number);
+		}
+		else if (Property->IsA<FUInt64Property>())
+		{
+			return FitsInNumber<uint64>(Number);
+		}
+		else if (Property->IsA<FFloatProperty>())
+		{
+			return FitsInNumber<float>(Number);
+		}
+		else if (Property->IsA<FDoubleProperty>())
+		{
+			return true;
+		}
+
+		return FitsInNumber<int64>(Number);
+	}
 }
 
-bool USupertalkValue::PropertyToValue(USupertalkPlayer* Player, void* ValuePtr, UObject* Owner, FProperty* Property, bool bValueIsContainer, USupertalkValue*& OutResult)
+bool FSupertalkValue::ExportToProperty(void* ValuePtr, UObject* Owner, FProperty* Property) const
 {
 	check(ValuePtr);
 	check(Property);
 
-	UObject* Outer = IsValid(Player) ? static_cast<UObject*>(Player) : static_cast<UObject*>(GetTransientPackage());
+	FStructProperty* StructProp = CastField<FStructProperty>(Property);
+	if (StructProp && StructProp->Struct == StaticStruct())
+	{
+		*static_cast<FSupertalkValue*>(ValuePtr) = *this;
+		return true;
+	}
 
 	if (FObjectPropertyBase* ObjProp = CastField<FObjectPropertyBase>(Property))
 	{
-		USupertalkObjectValue* Value = NewObject<USupertalkObjectValue>(Outer);
-		Value->Object = bValueIsContainer ? ObjProp->GetObjectPropertyValue_InContainer(ValuePtr) : ObjProp->GetObjectPropertyValue(ValuePtr);
-		OutResult = Value;
-		return true;
+		if (Type == ESupertalkValueType::Object || Type == ESupertalkValueType::None)
+		{
+			if (Object && !Object->IsA(ObjProp->PropertyClass))
+			{
+				return false;
+			}
+
+			ObjProp->SetObjectPropertyValue(ValuePtr, Object);
+			return true;
+		}
 	}
 	else if (FBoolProperty* BoolProp = CastField<FBoolProperty>(Property))
 	{
-		USupertalkBooleanValue* Value = NewObject<USupertalkBooleanValue>(Outer);
-		Value->bValue = bValueIsContainer ? BoolProp->GetPropertyValue_InContainer(ValuePtr) : BoolProp->GetPropertyValue(ValuePtr);
-		OutResult = Value;
-		return true;
+		if (Type == ESupertalkValueType::Boolean || Type == ESupertalkValueType::Number)
+		{
+			BoolProp->SetPropertyValue(ValuePtr, Type == ESupertalkValueType::Boolean ? bValue : Number != 0.0);
+			return true;
+		}
 	}
 	else if (FTextProperty* TextProp = CastField<FTextProperty>(Property))
 	{
-		USupertalkTextValue* Value = NewObject<USupertalkTextValue>(Outer);
-		Value->Text = bValueIsContainer ? TextProp->GetPropertyValue_InContainer(ValuePtr) : TextProp->GetPropertyValue(ValuePtr);
-		OutResult = Value;
+		TextProp->SetPropertyValue(ValuePtr, ToDisplayText());
 		return true;
 	}
-	else if (FMapProperty* MapProp = CastField<FMapProperty>(Property))
+	else if (FStrProperty* StrProp = CastField<FStrProperty>(Property))
 	{
-		USupertalkMapPropertyValue* Value = NewObject<USupertalkMapPropertyValue>(Outer);
-		Value->Owner = Owner;
-		Value->TargetProperty = MapProp;
-		OutResult = Value;
+		StrProp->SetPropertyValue(ValuePtr, Type == ESupertalkValueType::Text ? Text.ToString() : ToInternalString());
 		return true;
 	}
-	else
+	else if (FNameProperty* NameProp = CastField<FNameProperty>(Property))
+	{
+		NameProp->SetPropertyValue(ValuePtr, Type == ESupertalkValueType::Name ? Name : FName(Type == ESupertalkValueType::Text ? Text.ToString() : ToInternalString()));
+		return true;
+	}
+	else if (FNumericProperty* NumericProp = CastField<FNumericProperty>(Property); NumericProp && !NumericProp->IsEnum())
+	{
+		if (Type == ESupertalkValueType::Number || Type == ESupertalkValueType::Boolean)
+		{
+			const double Value = Type == ESupertalkValueType::Number ? Number : (bValue ? 1.0 : 0.0);
+			if (!FitsInNumericProperty(NumericProp, Value))
+			{
+				return false;
+			}
+
+			if (NumericProp->IsFloatingPoint())
+			{
+				NumericProp->SetFloatingPointPropertyValue(ValuePtr, Value);
+			}
+			else
+			{
+				NumericProp->SetIntPropertyValue(ValuePtr, static_cast<int64>(Value));
+			}
+
+			return true;
+		}
+	}
+
+	// Anything else (enums, structs, text that holds a number, ...) goes through the same text import a command would use.
+	const FString Str = Type == ESupertalkValueType::Text ? Text.ToString() : ToInternalString();
+	return Property->ImportText_Direct(*Str, ValuePtr, Owner, PPF_Localized) != nullptr;
+}
+
+FText FSupertalkValue::ToDisplayText() const
+{
+	switch (Type)
+	{
+	case ESupertalkValueType::Boolean:
+		return bValue ? LOCTEXT("True", "true") : LOCTEXT("False", "false");
+	case ESupertalkValueType::Number:
+		return FText::AsNumber(Number, &FNumberFormattingOptions::DefaultNoGrouping());
+	case ESupertalkValueType::Text:
+		return Text;
+	case ESupertalkValueType::Name:
+		return FText::FromName(Name);
+	case ESupertalkValueType::Object:
+		if (IsValid(Object))
+		{
+			if (ISupertalkDisplayInterface* DisplayInterface = Cast<ISupertalkDisplayInterface>(Object))
+			{
+				return DisplayInterface->GetSupertalkDisplayText();
+			}
+
+			return FText::FromString(Object->GetName());
+		}
+		return FText();
+	case ESupertalkValueType::MapProperty:
+		return FText::FromString(ToInternalString());
+	default:
+		return FText();
+	}
+}
+
+FString FSupertalkValue::ToInternalString() const
+{
+	switch (Type)
+	{
+	case ESupertalkValueType::Boolean:
+		return bValue ? TEXT("1") : TEXT("0");
+	case ESupertalkValueType::Number:
+		// Integers are written without a fractional part so that they can be imported into integer parameters.
+		if (FMath::IsNearlyEqual(FMath::RoundToDouble(Number), Number) && FMath::Abs(Number) < static_cast<double>(MAX_int64))
+		{
+			return FString::Printf(TEXT("%lld"), static_cast<int64>(FMath::RoundToDouble(Number)));
+		}
+		return FString::SanitizeFloat(Number);
+	case ESupertalkValueType::Text:
+	{
+		FString Result = Text.ToString();
+		Result.ReplaceCharWithEscapedCharInline();
+		return Result;
+	}
+	case ESupertalkValueType::Name:
+		return Name.ToString();
+	case ESupertalkValueType::Object:
+		return IsValid(Object) ? Object.GetPath() : TEXT("None");
+	case ESupertalkValueType::MapProperty:
+		// Is there a string representation for maps?
+		return IsValid(Object) ?
+			FString::Printf(TEXT("%s.%s"), *Object->GetName(), MapProperty ? *MapProperty->GetName() : TEXT("None"))
+		:   TEXT("None");
+	default:
+		return TEXT("None");
+	}
+}
+
+FSupertalkValue FSupertalkValue::GetMember(FName MemberName) const
+{
+	if (!IsValid(Object))
+	{
+		return FSupertalkValue();
+	}
+
+	if (Type == ESupertalkValueType::Object)
+	{
+		if (ISupertalkDisplayInterface* DisplayInterface = Cast<ISupertalkDisplayInterface>(Object))
+		{
+			return DisplayInterface->GetSupertalkMember(MemberName);
+		}
+		else if (UDataTable* DataTable = Cast<UDataTable>(Object))
+		{
+			// TODO: Can't subclass UDataTable for now, so we have to handle it separately :(
+			FSupertalkTableRow* Row = DataTable->FindRow<FSupertalkTableRow>(MemberName, TEXT("SupertalkValue::GetMember"));
+			if (Row != nullptr)
+			{
+				return MakeText(Row->Value);
+			}
+		}
+		else if (FProperty* Prop = FSupertalkUtilities::FindCachedProperty(Object->GetClass(), MemberName))
+		{
+			return FromProperty(Object, Object, Prop, true);
+		}
+	}
+	else if (Type == ESupertalkValueType::MapProperty && MapProperty)
 	{
-		FString Str;
-		if (bValueIsContainer)
+		FScriptMapHelper Helper(MapProperty, MapProperty->ContainerPtrToValuePtr<uint8>(Object));
+		if (CastField<FNameProperty>(MapProperty->KeyProp))
+		{
+			if (uint8* ValuePtr = Helper.FindValueFromHash(&MemberName))
+			{
+				return FromProperty(ValuePtr, Object, MapProperty->ValueProp, false);
+			}
+		}
+		else if (CastField<FStrProperty>(MapProperty->KeyProp))
+		{
+			FString Key = MemberName.ToString();
+			if (uint8* ValuePtr = Helper.FindValueFromHash(&Key))
+			{
+				return FromProperty(ValuePtr, Object, MapProperty->ValueProp, false);
+			}
+		}
+		else if (CastField<FTextProperty>(MapProperty->KeyProp))
 		{
-			Property->ExportText_InContainer(0, Str, ValuePtr, ValuePtr, nullptr, PPF_None);
+			FText Key = FText::FromString(MemberName.ToString());
+			if (uint8* ValuePtr = Helper.FindValueFromHash(&Key))
+			{
+				return FromProperty(ValuePtr, Object, MapProperty->ValueProp, false);
+			}
 		}
 		else
 		{
-			Property->ExportText_Direct(Str, ValuePtr, ValuePtr, nullptr, PPF_None);
+			UE_LOG(LogSupertalk, Warning, TEXT("Unable to access member '%s' of '%s.%s': key type of map is not a name, string, or text."), *MemberName.ToString(), *Object->GetName(), *MapProperty->GetName());
 		}
+	}
+
+	return FSupertalkValue();
+}
+
+bool FSupertalkValue::IsValueEqualTo(const FSupertalkValue& Other) const
+{
+	if (Type != Other.Type)
+	{
+		const FSupertalkValue& TextValue = Type == ESupertalkValueType::Text ? *this : Other;
+		const FSupertalkValue& OtherValue = Type == ESupertalkValueType::Text ? Other : *this;
+		if (TextValue.Type != ESupertalkValueType::Text)
+		{
+			return false;
+		}
+
+		if (OtherValue.Type == ESupertalkValueType::Number)
+		{
+			const FString String = TextValue.Text.ToString().TrimStartAndEnd();
+			double Number = 0.0;
+			return String.IsNumeric() && LexTryParseString(Number, *String) && Number == OtherValue.Number;
+		}
+
+		if (OtherValue.Type == ESupertalkValueType::Name)
+		{
+			return TextValue.Text.EqualTo(FText::FromName(OtherValue.Name));
+		}
+
+		return false;
+	}
 
-		USupertalkTextValue* Value = NewObject<USupertalkTextValue>(Outer);
-		Value->Text = FText::FromString(Str);
-		OutResult = Value;
+	switch (Type)
+	{
+	case ESupertalkValueType::None:
 		return true;
+	case ESupertalkValueType::Boolean:
+		return bValue == Other.bValue;
+	case ESupertalkValueType::Number:
+		return Number == Other.Number;
+	case ESupertalkValueType::Text:
+		return Text.EqualTo(Other.Text);
+	case ESupertalkValueType::Name:
+		return Name == Other.Name;
+	case ESupertalkValueType::Object:
+		return Object == Other.Object;
+	case ESupertalkValueType::MapProperty:
+		return Object == Other.Object && MapProperty == Other.MapProperty;
+	default:
+		return false;
 	}
+}
+
+FText USupertalkValue::ToResolvedDisplayText(const USupertalkPlayer* Player, int32 Binding) const
+{
+	check(Player);
 
-	return false;
+	FSupertalkValue Value = Resolve(Player, Binding);
+	return Value.IsNone() ? ToDisplayText() : Value.ToDisplayText();
 }
 
-const USupertalkValue* USupertalkValue::ResolveValue(const USupertalkPlayer* Player) const
+FString USupertalkValue::ToResolvedInternalString(const USupertalkPlayer* Player, int32 Binding) const
 {
-	return nullptr;
+	check(Player);
+
+	FSupertalkValue Value = Resolve(Player, Binding);
+	return Value.IsNone() ? ToInternalString() : Value.ToInternalString();
+}
+
+FSupertalkValue USupertalkBooleanValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
+{
+	return FSupertalkValue::MakeBoolean(bValue);
 }
 
 FText USupertalkBooleanValue::ToDisplayText() const
@@ -116,24 +509,24 @@ FString USupertalkBooleanValue::ToInternalString() const
 	return bValue ? TEXT("1") : TEXT("0");
 }
 
-const USupertalkValue* USupertalkBooleanValue::GetMember(FName MemberName) const
+FSupertalkValue USupertalkNumberValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
 {
-	return nullptr;
+	return FSupertalkValue::MakeNumber(Number);
 }
 
-bool USupertalkBooleanValue::IsValueEqualTo(const USupertalkValue* Other) const
+FText USupertalkNumberValue::ToDisplayText() const
 {
-	if (!IsValid(Other))
-	{
-		return false;
-	}
+	return FSupertalkValue::MakeNumber(Number).ToDisplayText();
+}
 
-	if (const USupertalkBooleanValue* OtherBool = Cast<USupertalkBooleanValue>(Other))
-	{
-		return bValue == OtherBool->bValue;
-	}
+FString USupertalkNumberValue::ToInternalString() const
+{
+	return FSupertalkValue::MakeNumber(Number).ToInternalString();
+}
 
-	return true;
+FSupertalkValue USupertalkTextValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
+{
+	return FSupertalkValue::MakeText(Text);
 }
 
 FText USupertalkTextValue::ToDisplayText() const
@@ -148,24 +541,9 @@ FString USupertalkTextValue::ToInternalString() const
 	return Result;
 }
 
-const USupertalkValue* USupertalkTextValue::GetMember(FName MemberName) const
+FSupertalkValue USupertalkVariableValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
 {
-	return nullptr;
-}
-
-bool USupertalkTextValue::IsValueEqualTo(const USupertalkValue* Other) const
-{
-	if (!IsValid(Other))
-	{
-		return false;
-	}
-
-	if (const USupertalkTextValue* OtherText = Cast<USupertalkTextValue>(Other))
-	{
-		return Text.EqualTo(OtherText->Text);
-	}
-
-	return true;
+	return Player->GetVariable(Variable, Binding, VariableSlot);
 }
 
 FText USupertalkVariableValue::ToDisplayText() const
@@ -175,65 +553,41 @@ FText USupertalkVariableValue::ToDisplayText() const
 
 FString USupertalkVariableValue::ToInternalString() const
 {
-	checkNoEntry();
-	return ToDisplayText().ToString();
+	return Variable.ToString();
 }
 
-const USupertalkValue* USupertalkVariableValue::GetMember(FName MemberName) const
+FSupertalkValue USupertalkMemberValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
 {
-	return nullptr;
+	return ResolveMembers(Super::Resolve(Player, Binding), Members);
 }
 
-const USupertalkValue* USupertalkVariableValue::ResolveValue(const USupertalkPlayer* Player) const
+FText USupertalkMemberValue::ToDisplayText() const
 {
-	return Player->GetVariable(Variable);
+	return FText::FromString(ToInternalString());
 }
 
-FText USupertalkMemberValue::ToDisplayText() const
+FString USupertalkMemberValue::ToInternalString() const
 {
-	FString Str = Super::ToDisplayText().ToString();
+	FString Str = Super::ToInternalString();
 	for (FName Member : Members)
 	{
 		Str += TEXT(".") + Member.ToString();
 	}
 
-	return FText::FromString(Str);
+	return Str;
 }
 
-FString USupertalkMemberValue::ToInternalString() const
+FSupertalkValue USupertalkMemberValue::ResolveMembers(const FSupertalkValue& Value, TArrayView<const FName> Members)
 {
-	checkNoEntry();
-	return ToDisplayText().ToString();
-}
-
-const USupertalkValue* USupertalkMemberValue::GetMember(FName MemberName) const
-{
-	USupertalkMemberValue* NewMember = DuplicateObject<USupertalkMemberValue>(this, GetOuter());
-	NewMember->Members.Add(MemberName);
-	return NewMember;
-}
-
-const USupertalkValue* USupertalkMemberValue::ResolveValue(const USupertalkPlayer* Player) const
-{
-	const USupertalkValue* CurrentValue = Super::ResolveValue(Player);
-	if (!IsValid(CurrentValue))
-	{
-		return nullptr;
-	}
-
+	FSupertalkValue CurrentValue = Value;
 	for (FName Member : Members)
 	{
-		CurrentValue = CurrentValue->GetMember(Member);
-		if (!IsValid(CurrentValue))
+		if (CurrentValue.IsNone())
 		{
-			return nullptr;
+			break;
 		}
 
-		CurrentValue = CurrentValue->GetResolvedValue(Player);
-		if (!IsValid(CurrentValue))
-		{
-			return nullptr;
-		}
+		CurrentValue = CurrentValue.GetMember(Member);
 	}
 
 	return CurrentValue;
@@ -244,154 +598,56 @@ FText ISupertalkDisplayInterface::GetSupertalkDisplayText() const
 	return FText();
 }
 
-const USupertalkValue* ISupertalkDisplayInterface::GetSupertalkMember(FName MemberName) const
+FSupertalkValue ISupertalkDisplayInterface::GetSupertalkMember(FName MemberName) const
 {
-	return nullptr;
+	return FSupertalkValue();
 }
 
-FText USupertalkObjectValue::ToDisplayText() const
+FSupertalkValue USupertalkObjectValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
 {
-	if (IsValid(Object))
-	{
-		if (ISupertalkDisplayInterface* DisplayInterface = Cast<ISupertalkDisplayInterface>(Object))
-		{
-			return DisplayInterface->GetSupertalkDisplayText();
-		}
-		
-		return FText::FromString(Object->GetName());
-	}
-
-	return FText();
+	return FSupertalkValue::MakeObject(Object);
 }
 
-FString USupertalkObjectValue::ToInternalString() const
+FText USupertalkObjectValue::ToDisplayText() const
 {
-	return IsValid(Object) ? Object.GetPath() : TEXT("None");
+	return FSupertalkValue::MakeObject(Object).ToDisplayText();
 }
 
-const USupertalkValue* USupertalkObjectValue::GetMember(FName MemberName) const
+FString USupertalkObjectValue::ToInternalString() const
 {
-	if (IsValid(Object))
-	{
-		if (ISupertalkDisplayInterface* DisplayInterface = Cast<ISupertalkDisplayInterface>(Object))
-		{
-			return DisplayInterface->GetSupertalkMember(MemberName);
-		}
-		else if (UDataTable* DataTable = Cast<UDataTable>(Object))
-		{
-			// TODO: Can't subclass UDataTable for now, so we have to handle it separately :(
-			FSupertalkTableRow* Row = DataTable->FindRow<FSupertalkTableRow>(MemberName, TEXT("SupertalkObjectValue::GetMember"));
-			if (Row != nullptr)
-			{
-				USupertalkTextValue* TextValue = NewObject<USupertalkTextValue>();
-				TextValue->Text = Row->Value;
-				return TextValue;
-			}
-		}
-		else if (FProperty* Prop = Object->GetClass()->FindPropertyByName(MemberName))
-		{
-			USupertalkValue* Value;
-			if (PropertyToValue(Cast<USupertalkPlayer>(GetOuter()), Object, Object, Prop, true, Value))
-			{
-				return Value;
-			}
-		}
-	}
-
-	return nullptr;
+	return IsValid(Object) ? Object.GetPath() : TEXT("None");
 }
 
-bool USupertalkObjectValue::IsValueEqualTo(const USupertalkValue* Other) const
+FSupertalkValue USupertalkSoftObjectValue::Resolve(const USupertalkPlayer* Player, int32 Binding) const
 {
-	if (!IsValid(Other))
+	UObject* Asset = Object.Get();
+	if (Asset == nullptr && !Object.IsNull())
 	{
-		return false;
+		UE_LOG(LogSupertalk, Warning, TEXT("Loading '%s' synchronously, run the script with USupertalkPlayer::RunScriptAsync to stream it in ahead of time"), *Object.ToString());
+		Asset = Object.LoadSynchronous();
 	}
 
-	if (const USupertalkObjectValue* OtherObj = Cast<USupertalkObjectValue>(Other))
+	if (Player)
 	{
-		return Object == OtherObj->Object;
+		Player->RetainResolvedAsset(Asset);
 	}
 
-	return true;
-}
-
-FText USupertalkMapPropertyValue::ToDisplayText() const
-{
-	return FText::FromString(ToInternalString());
-}
-
-FString USupertalkMapPropertyValue::ToInternalString() const
-{
-	// Is there a string representation for maps?
-	return IsValid(Owner) ?
-		FString::Printf(TEXT("%s.%s"), *Owner->GetName(), TargetProperty ? *TargetProperty->GetName() : TEXT("None"))
-	:   TEXT("None");
+	return FSupertalkValue::MakeObject(Asset);
 }
 
-const USupertalkValue* USupertalkMapPropertyValue::GetMember(FName MemberName) const
+FText USupertalkSoftObjectValue::ToDisplayText() const
 {
-	if (!IsValid(Owner) || !TargetProperty)
+	if (UObject* Asset = Object.Get())
 	{
-		return nullptr;
+		return FSupertalkValue::MakeObject(Asset).ToDisplayText();
 	}
 
-	FScriptMapHelper Helper(TargetProperty, TargetProperty->ContainerPtrToValuePtr<uint8>(Owner));
-	if (FNameProperty* NameProp = CastField<FNameProperty>(TargetProperty->KeyProp))
-	{
-		if (uint8* ValuePtr = Helper.FindValueFromHash(&MemberName))
-		{
-			USupertalkValue* Result = nullptr;
-			if (PropertyToValue(Cast<USupertalkPlayer>(GetOuter()), ValuePtr, Owner, TargetProperty->ValueProp, false, Result))
-			{
-				return Result;
-			}
-		}
-
-		return nullptr;
-	}
-	else if (FStrProperty* StrProp = CastField<FStrProperty>(TargetProperty->KeyProp))
-	{
-		FString Key = MemberName.ToString();
-		if (uint8* ValuePtr = Helper.FindValueFromHash(&Key))
-		{
-			USupertalkValue* Result = nullptr;
-			if (PropertyToValue(Cast<USupertalkPlayer>(GetOuter()), ValuePtr, Owner, TargetProperty->ValueProp, false, Result))
-			{
-				return Result;
-			}
-		}
-	}
-	else if (FTextProperty* TextProp = CastField<FTextProperty>(TargetProperty->KeyProp))
-	{
-		FText Key = FText::FromString(MemberName.ToString());
-		if (uint8* ValuePtr = Helper.FindValueFromHash(&Key))
-		{
-			USupertalkValue* Result = nullptr;
-			if (PropertyToValue(Cast<USupertalkPlayer>(GetOuter()), ValuePtr, Owner, TargetProperty->ValueProp, false, Result))
-			{
-				return Result;
-			}
-		}
-	}
-
-	UE_LOG(LogSupertalk, Warning, TEXT("Unable to access member '%s' of '%s.%s': key type of map is not a name, string, or text."), *MemberName.ToString(), *Owner->GetName(), *TargetProperty->GetName());
-	return nullptr;
+	return Object.IsNull() ? FText() : FText::FromString(Object.GetAssetName());
 }
 
-bool USupertalkMapPropertyValue::IsValueEqualTo(const USupertalkValue* Other) const
+FString USupertalkSoftObjectValue::ToInternalString() const
 {
-	if (!IsValid(Other))
-	{
-		return false;
-	}
-
-	if (const USupertalkMapPropertyValue* OtherObj = Cast<USupertalkMapPropertyValue>(Other))
-	{
-		return Owner == OtherObj->Owner && TargetProperty == OtherObj->TargetProperty;
-	}
-
-	return false;
+	return Object.IsNull() ? TEXT("None") : Object.ToString();
 }
 
 #undef LOCTEXT_NAMESPACE
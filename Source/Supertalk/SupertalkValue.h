@@ -3,21 +3,120 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "SupertalkPlayer.h"
 #include "Engine/DataTable.h"
+#include "UObject/SoftObjectPtr.h"
 #include "SupertalkValue.generated.h"
 
 class USupertalkPlayer;
 
+UENUM()
+enum class ESupertalkValueType : uint8
+{
+	None,
+	Boolean,
+	Number,
+	Text,
+	Name,
+	Object,
+	// A map property on an object (stored in Object), members are looked up by key.
+	MapProperty
+};
+
+// A value as seen by a running script. This is passed around by value so that evaluating expressions, reading variables,
+// and accessing members doesn't need to allocate anything.
+USTRUCT(BlueprintType)
+struct SUPERTALK_API FSupertalkValue
+{
+	GENERATED_BODY()
+
+	FSupertalkValue()
+	{
+		Type = ESupertalkValueType::None;
+		bValue = false;
+		Number = 0.0;
+		Object = nullptr;
+		MapProperty = nullptr;
+	}
+
+	static FSupertalkValue MakeBoolean(bool bInValue);
+	static FSupertalkValue MakeNumber(double InNumber);
+	static FSupertalkValue MakeText(const FText& InText);
+	static FSupertalkValue MakeName(FName InName);
+	static FSupertalkValue MakeObject(UObject* InObject);
+	static FSupertalkValue MakeMapProperty(UObject* InOwner, FMapProperty* InProperty);
+
+	static FSupertalkValue FromProperty(const void* ValuePtr, UObject* Owner, FProperty* Property, bool bValueIsContainer);
+
+	// Writes this value into a property (not its container), converting it when the types don't match. Returns false if the
+	// value can't be converted, i.e. an object of the wrong class or a number that doesn't fit in a numeric property.
+	bool ExportToProperty(void* ValuePtr, UObject* Owner, FProperty* Property) const;
+
+	FORCEINLINE ESupertalkValueType GetType() const { return Type; }
+	FORCEINLINE bool IsNone() const { return Type == ESupertalkValueType::None; }
+	FORCEINLINE bool IsBoolean() const { return Type == ESupertalkValueType::Boolean; }
+
+	FORCEINLINE bool GetBoolean() const { check(Type == ESupertalkValueType::Boolean); return bValue; }
+	FORCEINLINE double GetNumber() const { check(Type == ESupertalkValueType::Number); return Number; }
+	FORCEINLINE const FText& GetText() const { check(Type == ESupertalkValueType::Text); return Text; }
+	FORCEINLINE FName GetName() const { check(Type == ESupertalkValueType::Name); return Name; }
+
+	// Valid for both object and map property values.
+	FORCEINLINE UObject* GetObject() const { return Object; }
+
+	// Text meant for display to the user.
+	FText ToDisplayText() const;
+
+	// Text meant for passing data around - i.e. object paths. This will eventually be removed
+	// once we don't require string handling to call functions.
+	FString ToInternalString() const;
+
+	FSupertalkValue GetMember(FName MemberName) const;
+
+	// Numbers and names are equal to text that reads the same, since providers used to hand them out as text. Other values
+	// of different types are never equal. Two "none" values are equal.
+	bool IsValueEqualTo(const FSupertalkValue& Other) const;
+
+	// Compact serialization for saved player state. Objects go through the archive's UObject* serialization so it needs
+	// an archive that supports them, see USupertalkPlayer::SaveState.
+	void SerializeState(FArchive& Ar);
+
+private:
+	UPROPERTY()
+	ESupertalkValueType Type;
+
+	UPROPERTY()
+	bool bValue;
+
+	UPROPERTY()
+	double Number;
+
+	UPROPERTY()
+	FText Text;
+
+	UPROPERTY()
+	FName Name;
+
+	UPROPERTY()
+	TObjectPtr<UObject> Object;
+
+	FMapProperty* MapProperty;
+};
+
+// A value stored in a compiled script. These are created by the compiler and resolved into an FSupertalkValue when a
+// script runs.
 UCLASS(Abstract)
 class SUPERTALK_API USupertalkValue : public UObject
 {
 	GENERATED_BODY()
 
 public:
-	const USupertalkValue* GetResolvedValue(const USupertalkPlayer* Player) const;
-	FText ToResolvedDisplayText(const USupertalkPlayer* Player) const;
-	FString ToResolvedInternalString(const USupertalkPlayer* Player) const;
+	// Binding is Player's binding for the script this value is in (see FSupertalkInstructionContext and
+	// USupertalkPlayer::FindBinding), or INDEX_NONE to look variables up by name.
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const PURE_VIRTUAL(USupertalkValue::Resolve,return FSupertalkValue();)
+
+	// Resolves this value and returns its display text, or this value's own display text if it doesn't resolve to anything.
+	FText ToResolvedDisplayText(const USupertalkPlayer* Player, int32 Binding) const;
+	FString ToResolvedInternalString(const USupertalkPlayer* Player, int32 Binding) const;
 
 	// Text meant for display to the user.
 	virtual FText ToDisplayText() const PURE_VIRTUAL(USupertalkValue::ToDisplayText,return FText();)
@@ -25,15 +124,6 @@ public:
 	// Text meant for passing data around - i.e. object paths. This will eventually be removed
 	// once we don't require string handling to call functions.
 	virtual FString ToInternalString() const PURE_VIRTUAL(USupertalkValue::ToInternalText,return FString();)
-	
-	virtual const USupertalkValue* GetMember(FName MemberName) const PURE_VIRTUAL(USupertalkValue::GetMember,return nullptr;)
-
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const { return this == Other; }
-
-	static bool PropertyToValue(USupertalkPlayer* Player, void* ValuePtr, UObject* Owner, FProperty* Property, bool bValueIsContainer, USupertalkValue*& OutResult);
-
-protected:
-	virtual const USupertalkValue* ResolveValue(const USupertalkPlayer* Player) const;
 };
 
 UCLASS()
@@ -45,11 +135,23 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	uint8 bValue : 1;
 
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
 	virtual FText ToDisplayText() const override;
 	virtual FString ToInternalString() const override;
-	virtual const USupertalkValue* GetMember(FName MemberName) const override;
+};
 
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const override;
+UCLASS()
+class SUPERTALK_API USupertalkNumberValue : public USupertalkValue
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere)
+	double Number = 0.0;
+
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
+	virtual FText ToDisplayText() const override;
+	virtual FString ToInternalString() const override;
 };
 
 UCLASS()
@@ -61,11 +163,9 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	FText Text;
 
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
 	virtual FText ToDisplayText() const override;
 	virtual FString ToInternalString() const override;
-	virtual const USupertalkValue* GetMember(FName MemberName) const override;
-
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const override;
 };
 
 UCLASS()
@@ -77,14 +177,13 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	FName Variable;
 
+	// Index into the owning script's variables, INDEX_NONE for scripts compiled before variable slots existed.
+	UPROPERTY(VisibleAnywhere)
+	int32 VariableSlot = INDEX_NONE;
+
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
 	virtual FText ToDisplayText() const override;
 	virtual FString ToInternalString() const override;
-	virtual const USupertalkValue* GetMember(FName MemberName) const override;
-
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const override { checkNoEntry(); return false; }
-
-protected:
-	virtual const USupertalkValue* ResolveValue(const USupertalkPlayer* Player) const override;
 };
 
 // This should be replaced with an expression at some point.
@@ -97,14 +196,12 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	TArray<FName> Members;
 
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
 	virtual FText ToDisplayText() const override;
 	virtual FString ToInternalString() const override;
-	virtual const USupertalkValue* GetMember(FName MemberName) const override;
-
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const override { checkNoEntry(); return false; }
 
-protected:
-	virtual const USupertalkValue* ResolveValue(const USupertalkPlayer* Player) const override;
+	// Looks up each member of Value in turn, returning none if any step fails.
+	static FSupertalkValue ResolveMembers(const FSupertalkValue& Value, TArrayView<const FName> Members);
 };
 
 UINTERFACE()
@@ -122,7 +219,7 @@ public:
 	virtual FText GetSupertalkDisplayText() const;
 
 	// Get a sub-member of this object.
-	virtual const USupertalkValue* GetSupertalkMember(FName MemberName) const;
+	virtual FSupertalkValue GetSupertalkMember(FName MemberName) const;
 };
 
 UCLASS()
@@ -134,29 +231,27 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<UObject> Object;
 
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
 	virtual FText ToDisplayText() const override;
 	virtual FString ToInternalString() const override;
-	virtual const USupertalkValue* GetMember(FName MemberName) const override;
-
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const override;
 };
 
+// An asset referenced by a script. Only the path is stored, so loading a script doesn't load every asset it mentions. The
+// asset is loaded (with a warning, since that hitches) the first time the value is resolved, unless it was loaded ahead of
+// time (see USupertalkPlayer::RunScriptAsync and FSupertalkDependencyManifest). Either way the player keeps it loaded until
+// its script finishes. Display text is built from the path when the asset isn't loaded, it's never loaded just to be shown.
 UCLASS()
-class SUPERTALK_API USupertalkMapPropertyValue : public USupertalkValue
+class SUPERTALK_API USupertalkSoftObjectValue : public USupertalkValue
 {
 	GENERATED_BODY()
 
 public:
 	UPROPERTY(VisibleAnywhere)
-	TObjectPtr<UObject> Owner;
-
-	FMapProperty* TargetProperty;
+	TSoftObjectPtr<UObject> Object;
 
+	virtual FSupertalkValue Resolve(const USupertalkPlayer* Player, int32 Binding) const override;
 	virtual FText ToDisplayText() const override;
 	virtual FString ToInternalString() const override;
-	virtual const USupertalkValue* GetMember(FName MemberName) const override;
-
-	virtual bool IsValueEqualTo(const USupertalkValue* Other) const override;
 };
 
 USTRUCT(BlueprintType)
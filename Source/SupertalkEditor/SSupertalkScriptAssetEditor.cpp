@@ -4,6 +4,7 @@
 #include "SSupertalkScriptAssetEditor.h"
 #include "SupertalkEditorStyle.h"
 #include "SupertalkParser.h"
+#include "SupertalkEditorSettings.h"
 #include "SupertalkRichTextSyntaxHighlighterTextLayoutMarshaller.h"
 #include "Supertalk/SupertalkPlayer.h"
 #include "Widgets/Layout/SGridPanel.h"
@@ -39,6 +40,7 @@ void SSupertalkScriptAssetEditor::Construct(const FArguments& InArgs, class USup
 	TSharedRef<FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller> RichTextMarshaller = FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::Create(
 		Parser,
 		FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::FSyntaxTextStyle());
+	Marshaller = RichTextMarshaller;
 
 	TSharedRef<SScrollBar> HorizontalScrollBar =
 		SNew(SScrollBar)
@@ -107,6 +109,8 @@ void SSupertalkScriptAssetEditor::Tick(const FGeometry& AllottedGeometry, const
 {
 	LineNumbersScroll->SetScrollOffset(EditableText->GetVerticalScroll());
 
+	TickValidation();
+
 	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
 }
 
@@ -116,6 +120,9 @@ void SSupertalkScriptAssetEditor::HandleScriptAssetPropertyChanged(UObject* Obje
 	{
 		EditableText->SetText(FText::FromString(ScriptAsset->SourceData));
 		RefreshLineNumbers();
+
+		++TextRevision;
+		LastTextChangeTime = FPlatformTime::Seconds();
 	}
 }
 
@@ -126,6 +133,41 @@ void SSupertalkScriptAssetEditor::OnTextChanged(const FText& NewText)
 		ScriptAsset->SourceData = NewText.ToString();
 		ScriptAsset->MarkPackageDirty();
 		RefreshLineNumbers();
+
+		++TextRevision;
+		LastTextChangeTime = FPlatformTime::Seconds();
+	}
+}
+
+void SSupertalkScriptAssetEditor::TickValidation()
+{
+	if (!IsValid(ScriptAsset))
+	{
+		return;
+	}
+
+	if (PendingValidation.IsValid())
+	{
+		if (!PendingValidation.IsReady())
+		{
+			return;
+		}
+
+		const FSupertalkScriptValidation Validation = PendingValidation.Get();
+		PendingValidation.Reset();
+
+		if (PendingValidationRevision == TextRevision)
+		{
+			ValidatedRevision = PendingValidationRevision;
+			Marshaller->SetDiagnosticLines(Validation.DiagnosticLines);
+			FSupertalkScriptCompiler::OnScriptValidated.Broadcast(ScriptAsset, Validation.bSuccess, Validation.CompilerOutput);
+		}
+	}
+
+	if (ValidatedRevision != TextRevision && FPlatformTime::Seconds() - LastTextChangeTime >= GetDefault<USupertalkEditorSettings>()->ValidationDelay)
+	{
+		PendingValidationRevision = TextRevision;
+		PendingValidation = FSupertalkScriptCompiler::ValidateScriptAsync(ScriptAsset->GetName(), ScriptAsset->SourceData);
 	}
 }
 
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SupertalkScriptCompiler.h"
 #include "Widgets/SCompoundWidget.h"
 #include "Widgets/Input/SMultiLineEditableTextBox.h"
 #include "Widgets/Layout/SScrollBox.h"
@@ -30,8 +31,20 @@ private:
 
 	void RefreshLineNumbers();
 
+	void TickValidation();
+
 	USupertalkScript* ScriptAsset = nullptr;
 
+	TSharedPtr<class FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller> Marshaller;
+
+	// The text is checked for errors in the background once it hasn't changed for a moment. Results for text that has
+	// changed since are thrown away.
+	TFuture<FSupertalkScriptValidation> PendingValidation;
+	int32 TextRevision = 0;
+	int32 PendingValidationRevision = INDEX_NONE;
+	int32 ValidatedRevision = INDEX_NONE;
+	double LastTextChangeTime = 0.0;
+
 
 	FMessageLog MessageLog;
 	TSharedPtr<class SMultiLineEditableTextWithScrollExposed> EditableText;
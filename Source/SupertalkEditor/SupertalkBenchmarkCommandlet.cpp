@@ -0,0 +1,1116 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkBenchmarkCommandlet.h"
+#include "SupertalkCharScan.h"
+#include "SupertalkParser.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "Interfaces/IPluginManager.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/OutputDeviceNull.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Supertalk/Supertalk.h"
+#include "Supertalk/SupertalkLine.h"
+#include "Supertalk/SupertalkTrace.h"
+#include "UObject/UObjectArray.h"
+
+namespace
+{
+	bool IsMemoryTracked()
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		return FLowLevelMemTracker::IsEnabled();
+#else
+		return false;
+#endif
+	}
+
+	// Bytes held under the Supertalk LLM tag. The benchmarks run under that tag, and LLM tag scopes only apply to the thread
+	// they're on, so only the benchmarked code is counted. Zero unless LLM is enabled (-llm).
+	int64 GetTrackedBytes()
+	{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		if (FLowLevelMemTracker::IsEnabled())
+		{
+			// Threads keep their own counts until they're gathered.
+			FLowLevelMemTracker& Tracker = FLowLevelMemTracker::Get();
+			Tracker.UpdateStatsPerFrame();
+			return Tracker.GetTagAmountForTracker(ELLMTracker::Default, FName(TEXT("Supertalk")), ELLMTagSet::None);
+		}
+#endif
+		return 0;
+	}
+
+	// Forwards everything to the allocator it wraps, and counts the allocations a thread makes while it has a counter set (see
+	// FScopedAllocationCounter), so allocations made on other threads are never counted. It's installed once and never
+	// removed, since other threads may be in the middle of a call through it.
+	class FSupertalkCountingMalloc final : public FMalloc
+	{
+	public:
+		static void Install()
+		{
+			check(IsInGameThread());
+
+			static bool bInstalled = false;
+			if (!bInstalled)
+			{
+				bInstalled = true;
+				GMalloc = new FSupertalkCountingMalloc(GMalloc);
+			}
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		// The calling thread's counter, if it's counting.
+		static thread_local int64* ThreadCounter;
+
+	private:
+		explicit FSupertalkCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+
+		static FORCEINLINE void CountAllocation()
+		{
+			if (int64* Counter = ThreadCounter)
+			{
+				++*Counter;
+			}
+		}
+
+		FMalloc* Inner;
+	};
+
+	thread_local int64* FSupertalkCountingMalloc::ThreadCounter = nullptr;
+
+	// Counts allocations made on this thread for the lifetime of the scope.
+	class FScopedAllocationCounter
+	{
+	public:
+		FScopedAllocationCounter()
+		{
+			FSupertalkCountingMalloc::Install();
+			Previous = FSupertalkCountingMalloc::ThreadCounter;
+			FSupertalkCountingMalloc::ThreadCounter = &NumAllocations;
+		}
+
+		~FScopedAllocationCounter()
+		{
+			FSupertalkCountingMalloc::ThreadCounter = Previous;
+		}
+
+		FScopedAllocationCounter(const FScopedAllocationCounter&) = delete;
+		FScopedAllocationCounter& operator=(const FScopedAllocationCounter&) = delete;
+
+		int64 NumAllocations = 0;
+
+	private:
+		int64* Previous = nullptr;
+	};
+
+	class FScopedObjectCreateCounter final : public FUObjectArray::FUObjectCreateListener
+	{
+	public:
+		FScopedObjectCreateCounter()
+		{
+			GUObjectArray.AddUObjectCreateListener(this);
+		}
+
+		virtual ~FScopedObjectCreateCounter() override
+		{
+			GUObjectArray.RemoveUObjectCreateListener(this);
+		}
+
+		virtual void NotifyUObjectCreated(const UObjectBase* Object, int32 Index) override
+		{
+			++NumCreated;
+		}
+
+		virtual void OnUObjectArrayShutdown() override
+		{
+		}
+
+		int32 NumCreated = 0;
+	};
+
+	bool TokensMatch(const TArray<FSupertalkParser::FToken>& Expected, const TArray<FSupertalkParser::FToken>& Actual, const FString& Name)
+	{
+		const int32 NumTokens = FMath::Min(Expected.Num(), Actual.Num());
+		for (int32 Idx = 0; Idx < NumTokens; ++Idx)
+		{
+			const FSupertalkParser::FToken& Lhs = Expected[Idx];
+			const FSupertalkParser::FToken& Rhs = Actual[Idx];
+			if (Lhs.Type != Rhs.Type
+				|| Lhs.Context.Line != Rhs.Context.Line
+				|| Lhs.Context.Col != Rhs.Context.Col
+				|| Lhs.Indentation != Rhs.Indentation
+				|| !Lhs.GetContent().Equals(Rhs.GetContent(), ESearchCase::CaseSensitive)
+				|| !Lhs.Namespace.Equals(Rhs.Namespace, ESearchCase::CaseSensitive)
+				|| !Lhs.Source.Equals(Rhs.Source, ESearchCase::CaseSensitive))
+			{
+				UE_LOG(LogSupertalk, Error, TEXT("'%s': token %d differs, %s '%s' at %d:%d against %s '%s' at %d:%d"), *Name, Idx,
+					*Lhs.GetDisplayName(), *FString(Lhs.GetContent()), Lhs.Context.Line, Lhs.Context.Col,
+					*Rhs.GetDisplayName(), *FString(Rhs.GetContent()), Rhs.Context.Line, Rhs.Context.Col);
+				return false;
+			}
+		}
+
+		if (Expected.Num() != Actual.Num())
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("'%s': %d tokens against %d"), *Name, Expected.Num(), Actual.Num());
+			return false;
+		}
+
+		return true;
+	}
+
+	// Every line has a placeholder or two so that formatting is part of the cost, same as in a real script.
+	void AppendLine(FString& Out, const TCHAR* Indent, const TCHAR* Speaker, int32 Index)
+	{
+		Out += FString::Printf(TEXT("%s%s: Line %d, hello {PlayerName}. This is about as long as a line usually is.\n"), Indent, Speaker, Index);
+	}
+}
+
+USupertalkBenchmarkCommandlet::USupertalkBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+
+	MaxChoicesPerRun = 0;
+	NumChoicesThisRun = 0;
+	NumLines = 0;
+	NumChoices = 0;
+}
+
+int32 USupertalkBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Iterations = 20;
+	int32 Scale = 1000;
+	FString ScenarioFilter;
+	FString OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Supertalk"), TEXT("RuntimeBenchmark.json"));
+
+	FParse::Value(*Params, TEXT("iterations="), Iterations);
+	FParse::Value(*Params, TEXT("scale="), Scale);
+	FParse::Value(*Params, TEXT("scenarios="), ScenarioFilter);
+	FParse::Value(*Params, TEXT("output="), OutputPath);
+
+	Iterations = FMath::Max(Iterations, 1);
+	Scale = FMath::Max(Scale, 16);
+
+	TArray<FString> EnabledScenarios;
+	ScenarioFilter.ParseIntoArray(EnabledScenarios, TEXT(","));
+
+	if (!CheckStateRestore())
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Restoring player state accepted bad data"));
+		return 1;
+	}
+
+	if (!CheckPlayerFootprint())
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Player memory grows with the length of the script it runs"));
+		return 1;
+	}
+
+	TArray<FScenario> Scenarios;
+	GenerateScenarios(Scale, Scenarios);
+
+	TArray<FScenarioResult> Results;
+	for (const FScenario& Scenario : Scenarios)
+	{
+		if (EnabledScenarios.Num() > 0 && !EnabledScenarios.Contains(Scenario.Name))
+		{
+			continue;
+		}
+
+		FScenarioResult& Result = Results.AddDefaulted_GetRef();
+		if (!RunScenario(Scenario, Iterations, Result))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Benchmark scenario '%s' failed"), *Scenario.Name);
+			return 1;
+		}
+
+		UE_LOG(LogSupertalk, Display, TEXT("%-12s %8d instructions, %10.0f actions/sec, %8.1f allocations/run, %8.1f KiB retained, %8.1f KiB player, %6.1f objects/run"),
+			*Result.Name, Result.NumInstructions, Result.RunSeconds > 0.0 ? Result.NumActions / Result.RunSeconds : 0.0,
+			static_cast<double>(Result.NumAllocations) / Result.NumRuns, Result.RetainedBytes / 1024.0, Result.PlayerBytes / 1024.0, static_cast<double>(Result.NumObjectsCreated) / Result.NumRuns);
+	}
+
+	if (!WriteResults(OutputPath, Scale, Iterations, Results))
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Unable to write benchmark results to '%s'"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogSupertalk, Display, TEXT("Wrote benchmark results to '%s'"), *OutputPath);
+	return 0;
+}
+
+void USupertalkBenchmarkCommandlet::GenerateScenarios(int32 Scale, TArray<FScenario>& OutScenarios)
+{
+	// One long section of lines.
+	{
+		FScenario& Scenario = OutScenarios.AddDefaulted_GetRef();
+		Scenario.Name = TEXT("Linear");
+		Scenario.Source = TEXT("# Linear\nPlayerName = \"Traveler\"\n");
+		for (int32 Idx = 0; Idx < Scale; ++Idx)
+		{
+			AppendLine(Scenario.Source, TEXT(""), Idx % 2 ? TEXT("Person1") : TEXT("Person2"), Idx);
+		}
+	}
+
+	// A binary tree of sections, each one a few lines and a choice between two children. One path from the root to a leaf
+	// is played per run.
+	{
+		FScenario& Scenario = OutScenarios.AddDefaulted_GetRef();
+		Scenario.Name = TEXT("ChoiceTree");
+
+		const int32 NumNodes = FMath::RoundUpToPowerOfTwo(Scale) - 1;
+		for (int32 Node = 1; Node <= NumNodes; ++Node)
+		{
+			Scenario.Source += FString::Printf(TEXT("\n# Node_%d\n"), Node);
+			if (Node == 1)
+			{
+				Scenario.Source += TEXT("PlayerName = \"Traveler\"\n");
+			}
+
+			for (int32 Idx = 0; Idx < 3; ++Idx)
+			{
+				AppendLine(Scenario.Source, TEXT(""), TEXT("Guide"), Idx);
+			}
+
+			if (Node * 2 + 1 <= NumNodes)
+			{
+				Scenario.Source += TEXT("Guide: Left or right?\n");
+				Scenario.Source += FString::Printf(TEXT("* Left\n  -> Node_%d\n* Right\n  -> Node_%d\n"), Node * 2, Node * 2 + 1);
+			}
+		}
+	}
+
+	// A hub with a handful of rooms that all jump back to it. The last choice leaves, it's picked once Scale rooms have
+	// been visited.
+	{
+		constexpr int32 NumRooms = 8;
+
+		FScenario& Scenario = OutScenarios.AddDefaulted_GetRef();
+		Scenario.Name = TEXT("HubLoop");
+		Scenario.MaxChoicesPerRun = Scale;
+		Scenario.Source = TEXT("# Start\nPlayerName = \"Traveler\"\n-> Hub\n\n# Hub\nGuide: Where to, {PlayerName}?\n");
+		for (int32 Room = 0; Room < NumRooms; ++Room)
+		{
+			Scenario.Source += FString::Printf(TEXT("* Room %d\n  -> Room_%d\n"), Room, Room);
+		}
+
+		Scenario.Source += TEXT("* Leave\n  -> None\n");
+
+		for (int32 Room = 0; Room < NumRooms; ++Room)
+		{
+			Scenario.Source += FString::Printf(TEXT("\n# Room_%d\nVisited%d = true\n"), Room, Room);
+			AppendLine(Scenario.Source, TEXT(""), TEXT("Guide"), Room);
+			Scenario.Source += TEXT("-> Hub\n");
+		}
+	}
+
+	// Wide parallel blocks, every line in a block starts its own stack.
+	{
+		constexpr int32 Width = 16;
+
+		FScenario& Scenario = OutScenarios.AddDefaulted_GetRef();
+		Scenario.Name = TEXT("Parallel");
+		Scenario.Source = TEXT("# Parallel\nPlayerName = \"Traveler\"\n");
+		for (int32 Block = 0; Block < FMath::Max(Scale / Width, 1); ++Block)
+		{
+			Scenario.Source += TEXT("[\n");
+			for (int32 Idx = 0; Idx < Width; ++Idx)
+			{
+				AppendLine(Scenario.Source, TEXT("  "), TEXT("Person1"), Block * Width + Idx);
+			}
+
+			Scenario.Source += TEXT("]\n");
+		}
+	}
+
+	// Parallel blocks inside parallel blocks, so that stacks are created, waited on, and released in bulk. Every line and
+	// nested block starts its own stack, and each block waits on all of them before the next one starts.
+	{
+		constexpr int32 NumNested = 4;
+		constexpr int32 NestedWidth = 4;
+		constexpr int32 NumLines = 8;
+		constexpr int32 LinesPerBlock = NumLines + NumNested * NestedWidth;
+
+		FScenario& Scenario = OutScenarios.AddDefaulted_GetRef();
+		Scenario.Name = TEXT("ParallelHeavy");
+		Scenario.Source = TEXT("# ParallelHeavy\nPlayerName = \"Traveler\"\n");
+		for (int32 Block = 0; Block < FMath::Max(Scale / LinesPerBlock, 1); ++Block)
+		{
+			int32 Line = Block * LinesPerBlock;
+			Scenario.Source += TEXT("[\n");
+			for (int32 Idx = 0; Idx < NumLines; ++Idx)
+			{
+				AppendLine(Scenario.Source, TEXT("  "), Idx % 2 ? TEXT("Person1") : TEXT("Person2"), Line++);
+			}
+
+			for (int32 Nested = 0; Nested < NumNested; ++Nested)
+			{
+				Scenario.Source += TEXT("  [\n");
+				for (int32 Idx = 0; Idx < NestedWidth; ++Idx)
+				{
+					AppendLine(Scenario.Source, TEXT("    "), TEXT("Guide"), Line++);
+				}
+
+				Scenario.Source += TEXT("  ]\n");
+			}
+
+			Scenario.Source += TEXT("]\n");
+		}
+	}
+
+	// Chains of conditionals over a few flags.
+	{
+		constexpr int32 NumFlags = 8;
+
+		FScenario& Scenario = OutScenarios.AddDefaulted_GetRef();
+		Scenario.Name = TEXT("Conditions");
+		Scenario.Source = TEXT("# Conditions\nPlayerName = \"Traveler\"\n");
+		for (int32 Flag = 0; Flag < NumFlags; ++Flag)
+		{
+			Scenario.Source += FString::Printf(TEXT("Flag%d = %s\n"), Flag, Flag % 3 ? TEXT("true") : TEXT("false"));
+		}
+
+		for (int32 Idx = 0; Idx < Scale; ++Idx)
+		{
+			const int32 A = Idx % NumFlags;
+			const int32 B = (Idx * 3 + 1) % NumFlags;
+			const int32 C = (Idx * 5 + 2) % NumFlags;
+			Scenario.Source += FString::Printf(TEXT("if Flag%d == Flag%d then Guide: Same %d.\n"), A, B, Idx);
+			Scenario.Source += FString::Printf(TEXT("else if ~Flag%d then Guide: Not %d.\n"), C, Idx);
+			Scenario.Source += FString::Printf(TEXT("else if Flag%d ~= Flag%d then Guide: Different %d.\n"), B, C, Idx);
+			Scenario.Source += FString::Printf(TEXT("else Guide: Otherwise %d.\n"), Idx);
+		}
+	}
+}
+
+bool USupertalkBenchmarkCommandlet::CheckStateRestore()
+{
+	// A parallel block inside a parallel block, so that the saved state has stacks waiting on other stacks. Lines are never
+	// completed, the script stays where it is.
+	const FString Source = TEXT("# Start\nPlayerName = \"Traveler\"\n[\n  Person1: One.\n  [\n    Person2: Two.\n    Person1: Three.\n  ]\n]\nGuide: Done.\n");
+
+	USupertalkScript* Script = NewObject<USupertalkScript>(GetTransientPackage(), TEXT("Benchmark_State"));
+	if (!FSupertalkParser::ParseIntoScript(TEXT("State"), Source, Script, GLog))
+	{
+		return false;
+	}
+
+	USupertalkPlayer* Player = NewObject<USupertalkPlayer>(GetTransientPackage());
+	Player->OnPlayLineEvent.BindLambda([](const FSupertalkLine& Line, FSupertalkEventCompletedDelegate Completed) {});
+	Player->RunScript(Script);
+
+	TArray<uint8> State;
+	FMemoryWriter Writer(State);
+	Player->SaveState(Writer);
+
+	// The player logs an error for every state it rejects, which is most of them here.
+	auto Restore = [Player](const TArray<uint8>& Data)
+	{
+		const ELogVerbosity::Type Verbosity = LogSupertalk.GetVerbosity();
+		LogSupertalk.SetVerbosity(ELogVerbosity::NoLogging);
+
+		FMemoryReader Reader(Data);
+		const bool bRestored = Player->RestoreState(Reader);
+
+		LogSupertalk.SetVerbosity(Verbosity);
+		return bRestored;
+	};
+
+	// Same layout as USupertalkPlayer::SaveState, with one stack at the start of the default section.
+	auto MakeState = [Script, Version = State[0]](uint32 Index, uint32 StackSource, uint32 NumWaitingOn, uint32 ScriptIndex)
+	{
+		TArray<uint8> Payload;
+		FMemoryWriter PayloadWriter(Payload);
+
+		int32 NumScripts = 1;
+		FString ScriptPath = FSoftObjectPath(Script).ToString();
+		int32 NumStacks = 1;
+		uint32 SectionName = 0;
+		uint32 Offset = 0;
+		uint32 NumVariables = 0;
+		PayloadWriter << NumScripts << ScriptPath << NumStacks;
+		PayloadWriter.SerializeIntPacked(Index);
+		PayloadWriter.SerializeIntPacked(StackSource);
+		PayloadWriter.SerializeIntPacked(NumWaitingOn);
+		PayloadWriter.SerializeIntPacked(ScriptIndex);
+		PayloadWriter.SerializeIntPacked(SectionName);
+		PayloadWriter.SerializeIntPacked(Offset);
+		PayloadWriter.SerializeIntPacked(NumVariables);
+
+		TArray<uint8> Result;
+		FMemoryWriter ResultWriter(Result);
+
+		uint8 StateVersion = Version;
+		int32 NumNames = 1;
+		FString SectionString = Script->DefaultSection.ToString();
+		ResultWriter << StateVersion << NumNames << SectionString << Payload;
+		return Result;
+	};
+
+	// Header with a count that's far larger than the data behind it.
+	auto MakeHeader = [Version = State[0]](int32 NumNames, int32 PayloadSize)
+	{
+		TArray<uint8> Result;
+		FMemoryWriter ResultWriter(Result);
+
+		uint8 StateVersion = Version;
+		ResultWriter << StateVersion << NumNames;
+		if (NumNames == 0)
+		{
+			ResultWriter << PayloadSize;
+		}
+
+		return Result;
+	};
+
+	bool bSuccess = true;
+	if (!Restore(State) || !Restore(MakeState(0, 0, 0, 0)) || !Restore(MakeState(MAX_int32, 0, 0, 0)))
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Restoring valid player state failed"));
+		bSuccess = false;
+	}
+
+	// Anything cut off is missing some of the payload, which always has its size written in front of it.
+	for (int32 Size = 0; Size < State.Num(); ++Size)
+	{
+		if (Restore(TArray<uint8>(State.GetData(), Size)))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Restored player state that was cut off after %d of %d bytes"), Size, State.Num());
+			bSuccess = false;
+		}
+	}
+
+	struct FBadState
+	{
+		const TCHAR* Description;
+		TArray<uint8> Data;
+	};
+
+	const FBadState BadStates[] = {
+		{ TEXT("a name table larger than the data"), MakeHeader(MAX_int32, 0) },
+		{ TEXT("a payload larger than the data"), MakeHeader(0, MAX_int32) },
+		{ TEXT("a negative payload size"), MakeHeader(0, -1) },
+		{ TEXT("a stack in the last slot"), MakeState(MAX_uint32, 0, 0, 0) },
+		{ TEXT("a stack that's its own source"), MakeState(0, 1, 1, 0) },
+		{ TEXT("a stack with a missing source"), MakeState(0, 2, 0, 0) },
+		{ TEXT("a stack waiting on stacks that don't exist"), MakeState(0, 0, 3, 0) },
+		{ TEXT("a stack in a script that doesn't exist"), MakeState(0, 0, 0, 1) },
+	};
+
+	for (const FBadState& BadState : BadStates)
+	{
+		if (Restore(BadState.Data))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Restored player state with %s"), BadState.Description);
+			bSuccess = false;
+		}
+	}
+
+	// Flipped bytes can land on a value that's still valid, so these only have to restore without crashing or running out
+	// of memory.
+	for (int32 Idx = 0; Idx < State.Num(); ++Idx)
+	{
+		TArray<uint8> Corrupted = State;
+		Corrupted[Idx] ^= 0xff;
+		Restore(Corrupted);
+	}
+
+	Player->Stop();
+	Player->OnPlayLineEvent.Unbind();
+	Player->MarkAsGarbage();
+	Script->MarkAsGarbage();
+
+	return bSuccess;
+}
+
+bool USupertalkBenchmarkCommandlet::CheckPlayerFootprint()
+{
+	// Lines are completed until the last one, so that each player is measured at the far end of its script.
+	auto Measure = [](int32 NumLines, int64& OutBytes)
+	{
+		FString Source = TEXT("# Footprint\nPlayerName = \"Traveler\"\n");
+		for (int32 Idx = 0; Idx < NumLines; ++Idx)
+		{
+			AppendLine(Source, TEXT(""), Idx % 2 ? TEXT("Person1") : TEXT("Person2"), Idx);
+		}
+
+		USupertalkScript* Script = NewObject<USupertalkScript>(GetTransientPackage(), *FString::Printf(TEXT("Benchmark_Footprint%d"), NumLines));
+		if (!FSupertalkParser::ParseIntoScript(TEXT("Footprint"), Source, Script, GLog))
+		{
+			return false;
+		}
+
+		int32 NumPlayed = 0;
+		USupertalkPlayer* Player = NewObject<USupertalkPlayer>(GetTransientPackage());
+		Player->OnPlayLineEvent.BindLambda([&NumPlayed, NumLines](const FSupertalkLine& Line, FSupertalkEventCompletedDelegate Completed)
+		{
+			if (++NumPlayed < NumLines)
+			{
+				Completed.ExecuteIfBound();
+			}
+		});
+
+		Player->RunScript(Script);
+		const bool bReachedEnd = NumPlayed == NumLines && Player->IsRunningScript();
+		OutBytes = Player->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+		Player->Stop();
+		Player->OnPlayLineEvent.Unbind();
+		Player->MarkAsGarbage();
+		Script->MarkAsGarbage();
+		return bReachedEnd;
+	};
+
+	constexpr int32 ShortLines = 16;
+	constexpr int32 LongLines = 16384;
+
+	int64 ShortBytes = 0;
+	int64 LongBytes = 0;
+	if (!Measure(ShortLines, ShortBytes) || !Measure(LongLines, LongBytes))
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Footprint scripts didn't run to their last line"));
+		return false;
+	}
+
+	UE_LOG(LogSupertalk, Display, TEXT("Player footprint: %lld bytes running %d lines, %lld bytes running %d lines"), ShortBytes, ShortLines, LongBytes, LongLines);
+	return ShortBytes == LongBytes;
+}
+
+bool USupertalkBenchmarkCommandlet::RunScenario(const FScenario& Scenario, int32 Iterations, FScenarioResult& OutResult)
+{
+	OutResult.Name = Scenario.Name;
+
+	USupertalkScript* Script = NewObject<USupertalkScript>(GetTransientPackage(), *FString::Printf(TEXT("Benchmark_%s"), *Scenario.Name));
+
+	const double CompileStart = FPlatformTime::Seconds();
+	if (!FSupertalkParser::ParseIntoScript(Scenario.Name, Scenario.Source, Script, GLog))
+	{
+		return false;
+	}
+
+	OutResult.CompileSeconds = FPlatformTime::Seconds() - CompileStart;
+	OutResult.NumInstructions = Script->Program.Instructions.Num();
+
+	USupertalkPlayer* Player = NewObject<USupertalkPlayer>(GetTransientPackage());
+	Player->OnPlayLineEvent.BindUObject(this, &ThisClass::HandlePlayLine, Player);
+	Player->OnPlayChoiceEvent.BindUObject(this, &ThisClass::HandlePlayChoice, Player);
+
+	MaxChoicesPerRun = Scenario.MaxChoicesPerRun;
+
+	// The first run binds the script and resolves everything that's cached per player.
+	RunToCompletion(Player, Script);
+
+	NumLines = 0;
+	NumChoices = 0;
+	const uint64 StartActions = Player->GetNumExecutedActions();
+	{
+		FScopedObjectCreateCounter ObjectCounter;
+		LLM_SCOPE_BYTAG(Supertalk);
+		const int64 StartBytes = GetTrackedBytes();
+
+		{
+			FScopedAllocationCounter AllocationCounter;
+
+			const double RunStart = FPlatformTime::Seconds();
+			for (int32 Run = 0; Run < Iterations; ++Run)
+			{
+				RunToCompletion(Player, Script);
+			}
+
+			OutResult.RunSeconds = FPlatformTime::Seconds() - RunStart;
+			OutResult.NumAllocations = AllocationCounter.NumAllocations;
+		}
+
+		OutResult.RetainedBytes = GetTrackedBytes() - StartBytes;
+		OutResult.NumObjectsCreated = ObjectCounter.NumCreated;
+	}
+
+	OutResult.PlayerBytes = Player->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+
+	OutResult.NumRuns = Iterations;
+	OutResult.NumActions = Player->GetNumExecutedActions() - StartActions;
+	OutResult.NumLines = NumLines;
+	OutResult.NumChoices = NumChoices;
+
+	Player->OnPlayLineEvent.Unbind();
+	Player->OnPlayChoiceEvent.Unbind();
+	Player->MarkAsGarbage();
+	Script->MarkAsGarbage();
+
+	return true;
+}
+
+void USupertalkBenchmarkCommandlet::RunToCompletion(USupertalkPlayer* Player, const USupertalkScript* Script)
+{
+	NumChoicesThisRun = 0;
+	Player->ClearVariables();
+	Player->RunScript(Script);
+
+	// Everything completes immediately, anything that's still running is stuck.
+	if (Player->IsRunningScript())
+	{
+		UE_LOG(LogSupertalk, Warning, TEXT("Benchmark script '%s' didn't run to completion"), *Script->GetName());
+		Player->Stop();
+	}
+}
+
+void USupertalkBenchmarkCommandlet::HandlePlayLine(const FSupertalkLine& Line, FSupertalkEventCompletedDelegate Completed, USupertalkPlayer* Player)
+{
+	++NumLines;
+	Line.FormatText(Player);
+	Completed.ExecuteIfBound();
+}
+
+void USupertalkBenchmarkCommandlet::HandlePlayChoice(const FSupertalkLine& Line, const TArray<FText>& Choices, FSupertalkChoiceCompletedDelegate Completed, USupertalkPlayer* Player)
+{
+	++NumChoices;
+	Line.FormatText(Player);
+
+	int32 Choice = Choices.Num() - 1;
+	if (NumChoicesThisRun < MaxChoicesPerRun && Choices.Num() > 1)
+	{
+		Choice = NumChoicesThisRun % (Choices.Num() - 1);
+	}
+
+	++NumChoicesThisRun;
+	Completed.ExecuteIfBound(Choice);
+}
+
+bool USupertalkBenchmarkCommandlet::WriteResults(const FString& Path, int32 Scale, int32 Iterations, const TArray<FScenarioResult>& Results)
+{
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	if (TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("Supertalk")))
+	{
+		Root->SetStringField(TEXT("pluginVersion"), Plugin->GetDescriptor().VersionName);
+	}
+
+	Root->SetStringField(TEXT("engineVersion"), FEngineVersion::Current().ToString());
+	Root->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Root->SetNumberField(TEXT("scale"), Scale);
+	Root->SetNumberField(TEXT("iterations"), Iterations);
+
+	TArray<TSharedPtr<FJsonValue>> Scenarios;
+	for (const FScenarioResult& Result : Results)
+	{
+		TSharedRef<FJsonObject> Scenario = MakeShared<FJsonObject>();
+		Scenario->SetStringField(TEXT("name"), Result.Name);
+		Scenario->SetNumberField(TEXT("instructions"), Result.NumInstructions);
+		Scenario->SetNumberField(TEXT("runs"), Result.NumRuns);
+		Scenario->SetNumberField(TEXT("compileSeconds"), Result.CompileSeconds);
+		Scenario->SetNumberField(TEXT("runSeconds"), Result.RunSeconds);
+		Scenario->SetNumberField(TEXT("actions"), static_cast<double>(Result.NumActions));
+		Scenario->SetNumberField(TEXT("actionsPerSecond"), Result.RunSeconds > 0.0 ? Result.NumActions / Result.RunSeconds : 0.0);
+		Scenario->SetNumberField(TEXT("lines"), static_cast<double>(Result.NumLines));
+		Scenario->SetNumberField(TEXT("choices"), static_cast<double>(Result.NumChoices));
+		Scenario->SetNumberField(TEXT("allocations"), static_cast<double>(Result.NumAllocations));
+		Scenario->SetNumberField(TEXT("allocationsPerRun"), static_cast<double>(Result.NumAllocations) / Result.NumRuns);
+		if (IsMemoryTracked())
+		{
+			Scenario->SetNumberField(TEXT("retainedBytes"), static_cast<double>(Result.RetainedBytes));
+		}
+
+		Scenario->SetNumberField(TEXT("playerBytes"), static_cast<double>(Result.PlayerBytes));
+		Scenario->SetNumberField(TEXT("objectsCreated"), Result.NumObjectsCreated);
+		Scenario->SetNumberField(TEXT("objectsCreatedPerRun"), static_cast<double>(Result.NumObjectsCreated) / Result.NumRuns);
+		Scenarios.Add(MakeShared<FJsonValueObject>(Scenario));
+	}
+
+	Root->SetArrayField(TEXT("scenarios"), Scenarios);
+
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (!FJsonSerializer::Serialize(Root, Writer))
+	{
+		return false;
+	}
+
+	return FFileHelper::SaveStringToFile(Output, *Path);
+}
+
+USupertalkParserBenchmarkCommandlet::USupertalkParserBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USupertalkParserBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Iterations = 5;
+	double Threshold = 1.25;
+	FString CorpusDir;
+	FString Generated = TEXT("10000,50000,100000");
+	FString OutputPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Supertalk"), TEXT("ParserBenchmark.json"));
+	FString BaselinePath;
+
+	if (TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("Supertalk")))
+	{
+		CorpusDir = FPaths::Combine(Plugin->GetBaseDir(), TEXT("Extras"), TEXT("Benchmark"), TEXT("Corpus"));
+	}
+
+	FParse::Value(*Params, TEXT("iterations="), Iterations);
+	FParse::Value(*Params, TEXT("threshold="), Threshold);
+	FParse::Value(*Params, TEXT("corpus="), CorpusDir);
+	FParse::Value(*Params, TEXT("generated="), Generated);
+	FParse::Value(*Params, TEXT("output="), OutputPath);
+	FParse::Value(*Params, TEXT("baseline="), BaselinePath);
+
+	Iterations = FMath::Max(Iterations, 1);
+
+	TArray<FInput> Inputs;
+
+	TArray<FString> CorpusFiles;
+	IFileManager::Get().FindFiles(CorpusFiles, *FPaths::Combine(CorpusDir, TEXT("*.sts")), true, false);
+	CorpusFiles.Sort();
+	for (const FString& File : CorpusFiles)
+	{
+		FInput& Input = Inputs.AddDefaulted_GetRef();
+		Input.Name = File;
+		if (!FFileHelper::LoadFileToString(Input.Source, *FPaths::Combine(CorpusDir, File)))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Unable to read corpus file '%s'"), *File);
+			return 1;
+		}
+	}
+
+	if (CorpusFiles.Num() == 0)
+	{
+		UE_LOG(LogSupertalk, Warning, TEXT("No corpus files found in '%s'"), *CorpusDir);
+	}
+
+	TArray<FString> GeneratedSizes;
+	Generated.ParseIntoArray(GeneratedSizes, TEXT(","));
+	for (const FString& Size : GeneratedSizes)
+	{
+		const int32 NumLines = FCString::Atoi(*Size);
+		if (NumLines > 0)
+		{
+			FInput& Input = Inputs.AddDefaulted_GetRef();
+			Input.Name = FString::Printf(TEXT("Generated_%d.sts"), NumLines);
+			Input.Source = GenerateScript(NumLines);
+		}
+	}
+
+	TArray<FInputResult> Results;
+	for (const FInput& Input : Inputs)
+	{
+		FInputResult& Result = Results.AddDefaulted_GetRef();
+		if (!RunInput(Input, Iterations, Result))
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Failed to parse benchmark script '%s'"), *Input.Name);
+			return 1;
+		}
+
+		const double LexMiBPerSecond = Result.NumChars * sizeof(TCHAR) / (1024.0 * 1024.0) / FMath::Max(Result.LexSeconds, UE_DOUBLE_SMALL_NUMBER);
+		UE_LOG(LogSupertalk, Display, TEXT("%-24s %7d lines, %8d tokens, lex %8.2f ms (%7.1f MiB/s, scalar %8.2f ms, %6lld allocs, tokens %8.1f KiB), parse %8.2f ms (%8lld allocs), held %8.1f KiB, %6d objects"),
+			*Result.Name, Result.NumLines, Result.NumTokens, Result.LexSeconds * 1000.0, LexMiBPerSecond, Result.ScalarLexSeconds * 1000.0,
+			Result.NumLexAllocations, Result.TokenBytes / 1024.0, Result.ParseSeconds * 1000.0, Result.NumAllocations - Result.NumLexAllocations,
+			Result.HeldBytes / 1024.0, Result.NumObjectsCreated);
+	}
+
+	if (!WriteResults(OutputPath, Iterations, Results))
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Unable to write benchmark results to '%s'"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogSupertalk, Display, TEXT("Wrote benchmark results to '%s'"), *OutputPath);
+
+	if (!BaselinePath.IsEmpty() && CompareToBaseline(BaselinePath, Threshold, Results) > 0)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+FString USupertalkParserBenchmarkCommandlet::GenerateScript(int32 NumLines)
+{
+	// Scenes are written the way writers tend to write them: some dialogue with attributes, localization keys, and
+	// continuation lines, a few commands, a choice, a conditional, and a parallel block, then a jump to the next scene.
+	FString Result;
+	Result.Reserve(NumLines * 48);
+	Result += TEXT("!namespace Benchmark.Generated\n\n");
+
+	int32 Lines = 2;
+	for (int32 Scene = 0; Lines < NumLines; ++Scene)
+	{
+		const FString Source = FString::Printf(TEXT(
+			"# Scene_%d\n"
+			"-- Scene %d, generated.\n"
+			"Met_%d = false\n"
+			"Person1 [Left, Happy] @S%d_L1: Hello {PlayerName}, it's been a while since scene %d.\n"
+			"         I had a lot to tell you, but it can wait.\n"
+			"Person2 [Right] @S%d_L2: It has. {Person1.Title} sends their regards.\n"
+			"> Wait 1\n"
+			"> PlayAnimation(Person1, \"Wave\", 1.5)\n"
+			"Person1 @S%d_L3: Where should we go next?\n"
+			"* @S%d_C1 To the market.\n"
+			"  Person2: The market it is.\n"
+			"* @S%d_C2 Back home.\n"
+			"  {\n"
+			"      Person2 [Sad]: Home, then.\n"
+			"      Met_%d = true\n"
+			"  }\n"
+			"if Met_%d then Person1: We've met before, haven't we?\n"
+			"else if ~Met_%d then Person2: I don't think we've met.\n"
+			"else Person1: Strange.\n"
+			"[\n"
+			"    > WalkTo Person2\n"
+			"    Person1 @S%d_L4: Let's keep moving while we talk.\n"
+			"]\n"
+			"Person2 [Happy];\n"),
+			Scene, Scene, Scene, Scene, Scene, Scene, Scene, Scene, Scene, Scene, Scene, Scene, Scene);
+
+		Result += Source;
+		Lines += 24;
+
+		Result += Lines < NumLines ? FString::Printf(TEXT("-> Scene_%d\n\n"), Scene + 1) : FString(TEXT("-> None\n"));
+		Lines += 2;
+	}
+
+	return Result;
+}
+
+bool USupertalkParserBenchmarkCommandlet::RunInput(const FInput& Input, int32 Iterations, FInputResult& OutResult)
+{
+	OutResult.Name = Input.Name;
+	OutResult.NumChars = Input.Source.Len();
+	OutResult.NumLines = 1;
+	for (TCHAR Char : Input.Source)
+	{
+		OutResult.NumLines += Char == TEXT('\n') ? 1 : 0;
+	}
+
+	OutResult.LexSeconds = MAX_dbl;
+	OutResult.ParseSeconds = MAX_dbl;
+
+	// The fastest of each is reported, anything slower is noise from the rest of the machine.
+	FOutputDeviceNull NullOutput;
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		// Only report errors once.
+		TSharedRef<FSupertalkParser> Parser = FSupertalkParser::Create(Iteration == 0 ? static_cast<FOutputDevice*>(GLog) : &NullOutput);
+
+		TArray<FSupertalkParser::FToken> Tokens;
+		const double LexStart = FPlatformTime::Seconds();
+		if (!Parser->RunLexer(Input.Name, Input.Source, Tokens))
+		{
+			return false;
+		}
+
+		OutResult.LexSeconds = FMath::Min(OutResult.LexSeconds, FPlatformTime::Seconds() - LexStart);
+
+		USupertalkScript* Script = NewObject<USupertalkScript>(GetTransientPackage());
+		const double ParseStart = FPlatformTime::Seconds();
+		if (!Parser->RunParser(Script, Tokens))
+		{
+			return false;
+		}
+
+		OutResult.ParseSeconds = FMath::Min(OutResult.ParseSeconds, FPlatformTime::Seconds() - ParseStart);
+		OutResult.NumTokens = Tokens.Num();
+		OutResult.NumInstructions = Script->Program.Instructions.Num();
+		Script->MarkAsGarbage();
+	}
+
+	// Scalar scanning is the reference, the vectorized lexer has to produce exactly the same tokens.
+	{
+		TSharedRef<FSupertalkParser> Parser = FSupertalkParser::Create(&NullOutput);
+		TArray<FSupertalkParser::FToken> VectorTokens;
+		Parser->RunLexer(Input.Name, Input.Source, VectorTokens);
+
+		Parser->CharScanMode = FSupertalkCharScan::EMode::Scalar;
+		TArray<FSupertalkParser::FToken> ScalarTokens;
+		OutResult.ScalarLexSeconds = MAX_dbl;
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			ScalarTokens.Reset();
+			const double LexStart = FPlatformTime::Seconds();
+			Parser->RunLexer(Input.Name, Input.Source, ScalarTokens);
+			OutResult.ScalarLexSeconds = FMath::Min(OutResult.ScalarLexSeconds, FPlatformTime::Seconds() - LexStart);
+		}
+
+		if (!TokensMatch(ScalarTokens, VectorTokens, Input.Name))
+		{
+			return false;
+		}
+	}
+
+	// Counting slows everything down, so memory is measured on a separate run.
+	{
+		TSharedRef<FSupertalkParser> Parser = FSupertalkParser::Create(&NullOutput);
+		USupertalkScript* Script = nullptr;
+
+		FScopedObjectCreateCounter ObjectCounter;
+		LLM_SCOPE_BYTAG(Supertalk);
+		const int64 StartBytes = GetTrackedBytes();
+		{
+			TArray<FSupertalkParser::FToken> Tokens;
+			{
+				FScopedAllocationCounter AllocationCounter;
+				Parser->RunLexer(Input.Name, Input.Source, Tokens);
+				OutResult.NumLexAllocations = AllocationCounter.NumAllocations;
+
+				Script = NewObject<USupertalkScript>(GetTransientPackage());
+				Parser->RunParser(Script, Tokens);
+				OutResult.NumAllocations = AllocationCounter.NumAllocations;
+			}
+
+			OutResult.TokenBytes = Tokens.GetAllocatedSize();
+
+			// Measured while the tokens are still alive, so this is what lexing and parsing hold on to at the end.
+			OutResult.HeldBytes = GetTrackedBytes() - StartBytes;
+		}
+
+		OutResult.NumObjectsCreated = ObjectCounter.NumCreated;
+		Script->MarkAsGarbage();
+	}
+
+	CollectGarbage(RF_NoFlags);
+	return true;
+}
+
+bool USupertalkParserBenchmarkCommandlet::WriteResults(const FString& Path, int32 Iterations, const TArray<FInputResult>& Results)
+{
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+
+	if (TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("Supertalk")))
+	{
+		Root->SetStringField(TEXT("pluginVersion"), Plugin->GetDescriptor().VersionName);
+	}
+
+	Root->SetStringField(TEXT("engineVersion"), FEngineVersion::Current().ToString());
+	Root->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+	Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Root->SetNumberField(TEXT("iterations"), Iterations);
+
+	TArray<TSharedPtr<FJsonValue>> Scripts;
+	for (const FInputResult& Result : Results)
+	{
+		TSharedRef<FJsonObject> Script = MakeShared<FJsonObject>();
+		Script->SetStringField(TEXT("name"), Result.Name);
+		Script->SetNumberField(TEXT("lines"), Result.NumLines);
+		Script->SetNumberField(TEXT("characters"), Result.NumChars);
+		Script->SetNumberField(TEXT("tokens"), Result.NumTokens);
+		Script->SetNumberField(TEXT("instructions"), Result.NumInstructions);
+		Script->SetNumberField(TEXT("lexSeconds"), Result.LexSeconds);
+		Script->SetNumberField(TEXT("scalarLexSeconds"), Result.ScalarLexSeconds);
+		Script->SetNumberField(TEXT("parseSeconds"), Result.ParseSeconds);
+		Script->SetNumberField(TEXT("allocations"), static_cast<double>(Result.NumAllocations));
+		Script->SetNumberField(TEXT("lexAllocations"), static_cast<double>(Result.NumLexAllocations));
+		Script->SetNumberField(TEXT("tokenBytes"), static_cast<double>(Result.TokenBytes));
+		if (IsMemoryTracked())
+		{
+			Script->SetNumberField(TEXT("heldBytes"), static_cast<double>(Result.HeldBytes));
+		}
+
+		Script->SetNumberField(TEXT("objectsCreated"), Result.NumObjectsCreated);
+		Scripts.Add(MakeShared<FJsonValueObject>(Script));
+	}
+
+	Root->SetArrayField(TEXT("scripts"), Scripts);
+
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (!FJsonSerializer::Serialize(Root, Writer))
+	{
+		return false;
+	}
+
+	return FFileHelper::SaveStringToFile(Output, *Path);
+}
+
+int32 USupertalkParserBenchmarkCommandlet::CompareToBaseline(const FString& Path, double Threshold, const TArray<FInputResult>& Results)
+{
+	FString Contents;
+	TSharedPtr<FJsonObject> Baseline;
+	if (!FFileHelper::LoadFileToString(Contents, *Path) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Contents), Baseline) || !Baseline.IsValid())
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("Unable to read benchmark baseline '%s'"), *Path);
+		return 1;
+	}
+
+	TMap<FString, TSharedPtr<FJsonObject>> BaselineScripts;
+	const TArray<TSharedPtr<FJsonValue>>* Scripts = nullptr;
+	if (Baseline->TryGetArrayField(TEXT("scripts"), Scripts))
+	{
+		for (const TSharedPtr<FJsonValue>& Script : *Scripts)
+		{
+			const TSharedPtr<FJsonObject>* Object = nullptr;
+			if (Script->TryGetObject(Object))
+			{
+				BaselineScripts.Add((*Object)->GetStringField(TEXT("name")), *Object);
+			}
+		}
+	}
+
+	int32 NumRegressions = 0;
+	for (const FInputResult& Result : Results)
+	{
+		const TSharedPtr<FJsonObject>* Script = BaselineScripts.Find(Result.Name);
+		if (Script == nullptr)
+		{
+			continue;
+		}
+
+		const double BaselineLex = (*Script)->GetNumberField(TEXT("lexSeconds"));
+		const double BaselineParse = (*Script)->GetNumberField(TEXT("parseSeconds"));
+		if (BaselineLex > 0.0 && Result.LexSeconds > BaselineLex * Threshold)
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Lexing '%s' regressed: %.2f ms, baseline %.2f ms"), *Result.Name, Result.LexSeconds * 1000.0, BaselineLex * 1000.0);
+			++NumRegressions;
+		}
+
+		if (BaselineParse > 0.0 && Result.ParseSeconds > BaselineParse * Threshold)
+		{
+			UE_LOG(LogSupertalk, Error, TEXT("Parsing '%s' regressed: %.2f ms, baseline %.2f ms"), *Result.Name, Result.ParseSeconds * 1000.0, BaselineParse * 1000.0);
+			++NumRegressions;
+		}
+	}
+
+	return NumRegressions;
+}
@@ -0,0 +1,137 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "Supertalk/SupertalkPlayer.h"
+#include "SupertalkBenchmarkCommandlet.generated.h"
+
+// Runs generated scripts through a USupertalkPlayer and writes out how fast they ran, as JSON, so that VM performance can be
+// compared between versions of the plugin. Every line and choice completes immediately. Allocations are counted on the
+// benchmark thread only, and memory that runs leave behind is measured through the Supertalk LLM tag when LLM is enabled (-llm).
+//
+// Before running anything, checks that USupertalkPlayer::RestoreState rejects saved state that's been cut off or corrupted,
+// and that a player running a long script doesn't use any more memory than one running a short script. Fails if either
+// doesn't hold.
+//
+// UnrealEditor-Cmd.exe <Project> -run=SupertalkBenchmark [-iterations=20] [-scale=1000] [-scenarios=Linear,HubLoop] [-output=<File>]
+UCLASS()
+class USupertalkBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USupertalkBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FScenario
+	{
+		FString Name;
+		FString Source;
+
+		// Scripts that loop until they're told to leave, see MaxChoicesPerRun.
+		int32 MaxChoicesPerRun = MAX_int32;
+	};
+
+	struct FScenarioResult
+	{
+		FString Name;
+		int32 NumInstructions = 0;
+		int32 NumRuns = 0;
+		double CompileSeconds = 0.0;
+		double RunSeconds = 0.0;
+		uint64 NumActions = 0;
+		uint64 NumLines = 0;
+		uint64 NumChoices = 0;
+		// Allocations made on the benchmark thread during all runs.
+		int64 NumAllocations = 0;
+
+		// Bytes still held under the Supertalk LLM tag after all runs that weren't held before them, only measured with -llm.
+		int64 RetainedBytes = 0;
+		int64 PlayerBytes = 0;
+		int32 NumObjectsCreated = 0;
+	};
+
+	static void GenerateScenarios(int32 Scale, TArray<FScenario>& OutScenarios);
+
+	static bool CheckStateRestore();
+	static bool CheckPlayerFootprint();
+
+	bool RunScenario(const FScenario& Scenario, int32 Iterations, FScenarioResult& OutResult);
+	void RunToCompletion(USupertalkPlayer* Player, const USupertalkScript* Script);
+
+	static bool WriteResults(const FString& Path, int32 Scale, int32 Iterations, const TArray<FScenarioResult>& Results);
+
+	void HandlePlayLine(const FSupertalkLine& Line, FSupertalkEventCompletedDelegate Completed, USupertalkPlayer* Player);
+	void HandlePlayChoice(const FSupertalkLine& Line, const TArray<FText>& Choices, FSupertalkChoiceCompletedDelegate Completed, USupertalkPlayer* Player);
+
+	// Choices pick one of the first N - 1 options until this many have been made in a run, then the last one. Generated
+	// scripts put the way out last.
+	int32 MaxChoicesPerRun;
+	int32 NumChoicesThisRun;
+
+	uint64 NumLines;
+	uint64 NumChoices;
+};
+
+// Times the lexer and the parser separately on every .sts file in a corpus (Extras/Benchmark/Corpus by default) and on
+// generated scripts, and writes the results out as JSON. Given the results of an earlier run with -baseline, fails when
+// lexing or parsing any script got slower than the baseline by more than -threshold (a ratio, 1.25 by default).
+//
+// Allocations are counted on the benchmark thread only. Memory held by the tokens and the parsed script is measured through
+// the Supertalk LLM tag when LLM is enabled (-llm).
+//
+// The lexer is also timed with vectorized scanning turned off (see FSupertalkCharScan), and fails if that produces
+// different tokens.
+//
+// UnrealEditor-Cmd.exe <Project> -run=SupertalkParserBenchmark [-iterations=5] [-corpus=<Dir>] [-generated=10000,100000]
+//     [-output=<File>] [-baseline=<File>] [-threshold=1.25]
+UCLASS()
+class USupertalkParserBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USupertalkParserBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FInput
+	{
+		FString Name;
+		FString Source;
+	};
+
+	struct FInputResult
+	{
+		FString Name;
+		int32 NumLines = 0;
+		int32 NumChars = 0;
+		int32 NumTokens = 0;
+		int32 NumInstructions = 0;
+		double LexSeconds = 0.0;
+		double ScalarLexSeconds = 0.0;
+		double ParseSeconds = 0.0;
+		// Allocations made on the benchmark thread while lexing and parsing, and while lexing alone.
+		int64 NumAllocations = 0;
+		int64 NumLexAllocations = 0;
+		int64 TokenBytes = 0;
+
+		// Bytes held under the Supertalk LLM tag after lexing and parsing, only measured with -llm.
+		int64 HeldBytes = 0;
+		int32 NumObjectsCreated = 0;
+	};
+
+	static FString GenerateScript(int32 NumLines);
+
+	static bool RunInput(const FInput& Input, int32 Iterations, FInputResult& OutResult);
+
+	static bool WriteResults(const FString& Path, int32 Iterations, const TArray<FInputResult>& Results);
+
+	// Returns the number of scripts that regressed.
+	static int32 CompareToBaseline(const FString& Path, double Threshold, const TArray<FInputResult>& Results);
+};
@@ -0,0 +1,80 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkCharScan.h"
+
+#if SUPERTALK_CHARSCAN_SSE2
+#include <emmintrin.h>
+#elif SUPERTALK_CHARSCAN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	template <bool bMatch>
+	int32 Find(FStringView View, TCHAR A, TCHAR B, FSupertalkCharScan::EMode Mode)
+	{
+		const TCHAR* Data = View.GetData();
+		const int32 Len = View.Len();
+		int32 Idx = 0;
+
+#if SUPERTALK_CHARSCAN_SSE2
+		if (Mode == FSupertalkCharScan::EMode::Vectorized)
+		{
+			const __m128i VecA = _mm_set1_epi16(static_cast<int16>(A));
+			const __m128i VecB = _mm_set1_epi16(static_cast<int16>(B));
+			for (; Idx + 8 <= Len; Idx += 8)
+			{
+				const __m128i Chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data + Idx));
+				const __m128i Matches = _mm_or_si128(_mm_cmpeq_epi16(Chars, VecA), _mm_cmpeq_epi16(Chars, VecB));
+
+				// Two mask bits per character.
+				uint32 Mask = static_cast<uint32>(_mm_movemask_epi8(Matches));
+				Mask = bMatch ? Mask : ~Mask & 0xFFFF;
+				if (Mask != 0)
+				{
+					return Idx + static_cast<int32>(FMath::CountTrailingZeros(Mask)) / 2;
+				}
+			}
+		}
+#elif SUPERTALK_CHARSCAN_NEON
+		if (Mode == FSupertalkCharScan::EMode::Vectorized)
+		{
+			const uint16x8_t VecA = vdupq_n_u16(static_cast<uint16>(A));
+			const uint16x8_t VecB = vdupq_n_u16(static_cast<uint16>(B));
+			for (; Idx + 8 <= Len; Idx += 8)
+			{
+				const uint16x8_t Chars = vld1q_u16(reinterpret_cast<const uint16*>(Data + Idx));
+				uint16x8_t Matches = vorrq_u16(vceqq_u16(Chars, VecA), vceqq_u16(Chars, VecB));
+				Matches = bMatch ? Matches : vmvnq_u16(Matches);
+
+				// NEON has no movemask, narrowing each lane to a byte packs the whole comparison into 64 bits.
+				const uint64 Mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(Matches)), 0);
+				if (Mask != 0)
+				{
+					return Idx + static_cast<int32>(FMath::CountTrailingZeros64(Mask)) / 8;
+				}
+			}
+		}
+#endif
+
+		for (; Idx < Len; ++Idx)
+		{
+			if ((Data[Idx] == A || Data[Idx] == B) == bMatch)
+			{
+				return Idx;
+			}
+		}
+
+		return INDEX_NONE;
+	}
+}
+
+int32 FSupertalkCharScan::FindFirstOf(FStringView View, TCHAR A, TCHAR B, EMode Mode)
+{
+	return Find<true>(View, A, B, Mode);
+}
+
+int32 FSupertalkCharScan::FindFirstNotOf(FStringView View, TCHAR A, TCHAR B, EMode Mode)
+{
+	return Find<false>(View, A, B, Mode);
+}
@@ -0,0 +1,27 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StringView.h"
+
+#define SUPERTALK_CHARSCAN_SSE2 (PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY && !PLATFORM_TCHAR_IS_4_BYTES)
+#define SUPERTALK_CHARSCAN_NEON (PLATFORM_ENABLE_VECTORINTRINSICS_NEON && !PLATFORM_TCHAR_IS_4_BYTES)
+
+// Finds characters in script source 8 at a time with SSE2 or NEON, used by the lexer for the runs of characters that
+// it would otherwise read one by one (line endings, indentation, quoted text). Platforms without either use a plain loop.
+struct FSupertalkCharScan
+{
+	// Scalar always uses the plain loop, so that the parser benchmark can compare the two.
+	enum class EMode : uint8
+	{
+		Vectorized,
+		Scalar,
+	};
+
+	// Returns the index of the first character in View that is A or B, or INDEX_NONE.
+	static int32 FindFirstOf(FStringView View, TCHAR A, TCHAR B, EMode Mode = EMode::Vectorized);
+
+	// Returns the index of the first character in View that is neither A nor B, or INDEX_NONE.
+	static int32 FindFirstNotOf(FStringView View, TCHAR A, TCHAR B, EMode Mode = EMode::Vectorized);
+};
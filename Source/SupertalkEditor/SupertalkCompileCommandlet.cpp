@@ -0,0 +1,327 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkCompileCommandlet.h"
+#include "SupertalkParser.h"
+#include "SupertalkScriptCompiler.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "EditorFramework/AssetImportData.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/ScopeExit.h"
+#include "Supertalk/Supertalk.h"
+#include "Supertalk/SupertalkPlayer.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+#include "UObject/StrongObjectPtr.h"
+#include "UObject/UnrealType.h"
+
+namespace
+{
+	struct FCompileJob
+	{
+		TStrongObjectPtr<USupertalkScript> Script;
+		FString Name;
+
+		// What the parser is told the script is called. Generated localization keys are made from this, so it has to be
+		// the same as FSupertalkScriptCompiler::CompileScript, which compiles every script that's saved.
+		FString File;
+
+		// Only set with -reimport.
+		FString SourceFile;
+		FString Source;
+
+		// Every job gets its own parser and output since they're used from worker threads. The tokens are views into Name
+		// and Source, so jobs are never moved once they're made.
+		TSharedPtr<FSupertalkParser> Parser;
+		FBufferedOutputDevice Output;
+		TArray<FSupertalkParser::FToken> Tokens;
+
+		// Localization keys of the compiled script before it's compiled again, when its source hasn't changed.
+		FString PreviousSource;
+		TArray<FString> PreviousTextKeys;
+
+		// Empty if the script compiled (and saved, if it was asked to).
+		FString Failure;
+
+		double ValidateSeconds = 0.0;
+		double CompileSeconds = 0.0;
+		double SaveSeconds = 0.0;
+	};
+
+	void CollectTextKeys(const UStruct* Struct, const void* Container, const USupertalkScript* Script, TSet<const UObject*>& Visited, TArray<FString>& OutKeys);
+
+	void CollectTextKeys(const FProperty* Property, const void* Value, const USupertalkScript* Script, TSet<const UObject*>& Visited, TArray<FString>& OutKeys)
+	{
+		if (const FTextProperty* TextProperty = CastField<FTextProperty>(Property))
+		{
+			const FText& Text = TextProperty->GetPropertyValue(Value);
+			const TOptional<FString> Namespace = FTextInspector::GetNamespace(Text);
+			const TOptional<FString> Key = FTextInspector::GetKey(Text);
+			if (Key.IsSet())
+			{
+				OutKeys.Add(FString::Printf(TEXT("%s/%s"), *Namespace.Get(FString()), *Key.GetValue()));
+			}
+		}
+		else if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+		{
+			CollectTextKeys(StructProperty->Struct, Value, Script, Visited, OutKeys);
+		}
+		else if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+		{
+			FScriptArrayHelper Helper(ArrayProperty, Value);
+			for (int32 Idx = 0; Idx < Helper.Num(); ++Idx)
+			{
+				CollectTextKeys(ArrayProperty->Inner, Helper.GetRawPtr(Idx), Script, Visited, OutKeys);
+			}
+		}
+		else if (const FObjectPropertyBase* ObjectProperty = CastField<FObjectPropertyBase>(Property))
+		{
+			const UObject* Object = ObjectProperty->GetObjectPropertyValue(Value);
+			bool bAlreadyVisited = true;
+			if (Object && Object->IsIn(Script))
+			{
+				Visited.Add(Object, &bAlreadyVisited);
+			}
+
+			if (!bAlreadyVisited)
+			{
+				CollectTextKeys(Object->GetClass(), Object, Script, Visited, OutKeys);
+			}
+		}
+	}
+
+	void CollectTextKeys(const UStruct* Struct, const void* Container, const USupertalkScript* Script, TSet<const UObject*>& Visited, TArray<FString>& OutKeys)
+	{
+		for (TFieldIterator<FProperty> It(Struct); It; ++It)
+		{
+			for (int32 Idx = 0; Idx < It->ArrayDim; ++Idx)
+			{
+				CollectTextKeys(*It, It->ContainerPtrToValuePtr<void>(Container, Idx), Script, Visited, OutKeys);
+			}
+		}
+	}
+
+	// The localization keys of everything in a compiled script. Walks the program rather than every object in the script,
+	// which would include whatever was left over from compiling it before.
+	TArray<FString> GetTextKeys(const USupertalkScript* Script)
+	{
+		TSet<const UObject*> Visited;
+		TArray<FString> Keys;
+		CollectTextKeys(FSupertalkProgram::StaticStruct(), &Script->Program, Script, Visited, Keys);
+		Keys.Sort();
+		return Keys;
+	}
+}
+
+USupertalkCompileCommandlet::USupertalkCompileCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 USupertalkCompileCommandlet::Main(const FString& Params)
+{
+	FString Paths = TEXT("/Game");
+	FParse::Value(*Params, TEXT("paths="), Paths);
+	const bool bReimport = FParse::Param(*Params, TEXT("reimport"));
+	const bool bSave = !FParse::Param(*Params, TEXT("nosave"));
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(USupertalkScript::StaticClass()->GetClassPathName());
+	Filter.bRecursivePaths = true;
+
+	TArray<FString> PackagePaths;
+	Paths.ParseIntoArray(PackagePaths, TEXT(","));
+	for (const FString& Path : PackagePaths)
+	{
+		Filter.PackagePaths.Add(FName(*Path));
+	}
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+	Assets.Sort([](const FAssetData& Lhs, const FAssetData& Rhs) { return Lhs.PackageName.LexicalLess(Rhs.PackageName); });
+
+	UE_LOG(LogSupertalk, Display, TEXT("Found %d scripts in '%s'"), Assets.Num(), *Paths);
+
+	// Loading has to happen on the game thread, and so does reading anything off the scripts.
+	const double LoadStart = FPlatformTime::Seconds();
+	TArray<TUniquePtr<FCompileJob>> Jobs;
+	Jobs.Reserve(Assets.Num());
+	for (const FAssetData& Asset : Assets)
+	{
+		FCompileJob& Job = *Jobs.Add_GetRef(MakeUnique<FCompileJob>());
+		Job.Name = Asset.PackageName.ToString();
+		Job.Script.Reset(Cast<USupertalkScript>(Asset.GetAsset()));
+		Job.File = Job.Script ? Job.Script->GetName() : Job.Name;
+
+		if (!Job.Script)
+		{
+			Job.Failure = TEXT("could not be loaded");
+		}
+		else if (bReimport)
+		{
+			Job.SourceFile = Job.Script->AssetImportData ? Job.Script->AssetImportData->GetFirstFilename() : FString();
+			if (Job.SourceFile.IsEmpty())
+			{
+				Job.Failure = TEXT("has no source file to reimport from");
+			}
+		}
+		else if (!Job.Script->bCanCompileFromSource)
+		{
+			Job.Failure = TEXT("cannot be compiled, please reimport or recreate it");
+		}
+		else
+		{
+			Job.Source = Job.Script->SourceData;
+		}
+
+		if (Job.Failure.IsEmpty())
+		{
+			Job.PreviousSource = Job.Script->SourceData;
+			Job.PreviousTextKeys = GetTextKeys(Job.Script.Get());
+		}
+	}
+	const double LoadSeconds = FPlatformTime::Seconds() - LoadStart;
+
+	// Lexing and validating touch nothing but the source, see FSupertalkParser::Validate.
+	const double ValidateStart = FPlatformTime::Seconds();
+	ParallelFor(Jobs.Num(), [&Jobs](int32 Idx)
+	{
+		FCompileJob& Job = *Jobs[Idx];
+		if (!Job.Failure.IsEmpty())
+		{
+			return;
+		}
+
+		const double Start = FPlatformTime::Seconds();
+		if (!Job.SourceFile.IsEmpty() && !FFileHelper::LoadFileToString(Job.Source, *Job.SourceFile))
+		{
+			Job.Failure = FString::Printf(TEXT("could not read '%s'"), *Job.SourceFile);
+			return;
+		}
+
+		Job.Parser = FSupertalkParser::Create(&Job.Output);
+		if (!Job.Parser->Validate(Job.File, Job.Source, Job.Tokens))
+		{
+			Job.Failure = TEXT("failed validation");
+		}
+
+		Job.ValidateSeconds = FPlatformTime::Seconds() - Start;
+	});
+	const double ValidateSeconds = FPlatformTime::Seconds() - ValidateStart;
+
+	// Scripts are compiled right here, saving them shouldn't compile them again.
+	FSupertalkScriptCompiler::Shutdown();
+	ON_SCOPE_EXIT
+	{
+		FSupertalkScriptCompiler::Initialize();
+	};
+
+	double CompileSeconds = 0.0;
+	double SaveSeconds = 0.0;
+	for (const TUniquePtr<FCompileJob>& JobPtr : Jobs)
+	{
+		FCompileJob& Job = *JobPtr;
+		if (!Job.Failure.IsEmpty())
+		{
+			continue;
+		}
+
+		USupertalkScript* Script = Job.Script.Get();
+
+		const double CompileStart = FPlatformTime::Seconds();
+		const bool bCompiled = Job.Parser->ParseTokens(Job.File, Job.Tokens, Script);
+		Job.CompileSeconds = FPlatformTime::Seconds() - CompileStart;
+		CompileSeconds += Job.CompileSeconds;
+
+		if (!bCompiled)
+		{
+			Job.Failure = TEXT("failed to compile");
+			continue;
+		}
+
+		// A recompile of a script that hasn't changed must keep its localization keys, or existing translations are lost.
+		if (Job.Source == Job.PreviousSource && GetTextKeys(Script) != Job.PreviousTextKeys)
+		{
+			// Not saved, so the asset on disk keeps its keys.
+			Job.Failure = TEXT("changed localization keys without any change to its source, it was not saved");
+			continue;
+		}
+
+		if (!Job.SourceFile.IsEmpty())
+		{
+			Script->SourceData = Job.Source;
+			Script->bCanCompileFromSource = true;
+			Script->AssetImportData->Update(Job.SourceFile);
+		}
+
+		Script->MarkPackageDirty();
+
+		if (bSave)
+		{
+			const double SaveStart = FPlatformTime::Seconds();
+
+			UPackage* Package = Script->GetPackage();
+			const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+
+			FSavePackageArgs SaveArgs;
+			SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+			SaveArgs.SaveFlags = SAVE_NoError;
+			if (!UPackage::SavePackage(Package, Script, *Filename, SaveArgs))
+			{
+				Job.Failure = FString::Printf(TEXT("could not be saved to '%s'"), *Filename);
+			}
+
+			Job.SaveSeconds = FPlatformTime::Seconds() - SaveStart;
+			SaveSeconds += Job.SaveSeconds;
+		}
+	}
+
+	// Parser output was buffered per script so that scripts validated at the same time don't interleave. Only warnings, errors
+	// and optimization reports are worth repeating.
+	int32 NumFailed = 0;
+	for (const TUniquePtr<FCompileJob>& JobPtr : Jobs)
+	{
+		FCompileJob& Job = *JobPtr;
+
+		TArray<FBufferedLine> Lines;
+		Job.Output.GetContents(Lines);
+		for (const FBufferedLine& Line : Lines)
+		{
+			if (Line.Verbosity <= ELogVerbosity::Display)
+			{
+				GLog->Serialize(Line.Data, Line.Verbosity, Line.Category);
+			}
+		}
+
+		if (Job.Failure.IsEmpty())
+		{
+			UE_LOG(LogSupertalk, Display, TEXT("%s: %d tokens, validated in %.2f ms, compiled in %.2f ms, saved in %.2f ms"),
+				*Job.Name, Job.Tokens.Num(), Job.ValidateSeconds * 1000.0, Job.CompileSeconds * 1000.0, Job.SaveSeconds * 1000.0);
+		}
+		else
+		{
+			++NumFailed;
+			UE_LOG(LogSupertalk, Error, TEXT("%s %s (validated in %.2f ms, compiled in %.2f ms)"),
+				*Job.Name, *Job.Failure, Job.ValidateSeconds * 1000.0, Job.CompileSeconds * 1000.0);
+		}
+	}
+
+	UE_LOG(LogSupertalk, Display, TEXT("Compiled %d of %d scripts: loading took %.2f s, validating %.2f s on %d threads, compiling %.2f s, saving %.2f s"),
+		Jobs.Num() - NumFailed, Jobs.Num(), LoadSeconds, ValidateSeconds, FTaskGraphInterface::Get().GetNumWorkerThreads() + 1, CompileSeconds, SaveSeconds);
+
+	if (NumFailed > 0)
+	{
+		UE_LOG(LogSupertalk, Error, TEXT("%d scripts failed to compile"), NumFailed);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SupertalkCompileCommandlet.generated.h"
+
+// Recompiles every Supertalk script found through the asset registry (under /Game by default), and saves the ones that
+// compiled. Scripts are lexed and validated in parallel, then parsed into their assets on the game thread, since that
+// creates objects. With -reimport, sources are read again from the files that scripts were imported from. With -nosave,
+// nothing is saved. A script whose source didn't change fails if compiling it again changes its localization keys.
+//
+// Reports how long each script took and which ones failed, and returns non-zero if any did.
+//
+// UnrealEditor-Cmd.exe <Project> -run=SupertalkCompile [-paths=/Game/Dialogue,/Game/Quests] [-reimport] [-nosave]
+UCLASS()
+class USupertalkCompileCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USupertalkCompileCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -23,11 +23,14 @@ public class SupertalkEditor : ModuleRules
 			new string[]
 			{
 				"UnrealEd",
+				"AssetRegistry",
 				"AssetTools",
 				"Engine",
 				"MessageLog",
 				"EditorStyle",
 				"SourceControl",
+				"Json",
+				"Projects",
 			});
 	}
 }
\ No newline at end of file
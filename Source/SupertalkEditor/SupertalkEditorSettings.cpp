@@ -6,4 +6,6 @@ USupertalkEditorSettings::USupertalkEditorSettings()
 {
 	bEnableScriptEditor = false;
 	bSaveSourceFilesInScriptEditor = false;
+	ValidationDelay = 0.5f;
+	bOptimizeScripts = false;
 }
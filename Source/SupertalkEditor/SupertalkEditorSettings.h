@@ -23,4 +23,14 @@ public:
 	// This will attempt to checkout the source file in source control if necessary.
 	UPROPERTY(EditAnywhere, Config, Category = Experimental, meta = (EditCondition = "bEnableScriptEditor"))
 	uint8 bSaveSourceFilesInScriptEditor : 1;
+
+	// How long after the last edit the script editor waits before checking the script for errors in the background.
+	UPROPERTY(EditAnywhere, Config, Category = Experimental, meta = (EditCondition = "bEnableScriptEditor", ClampMin = "0", Units = "s"))
+	float ValidationDelay;
+
+	// If enabled, scripts are optimized when they're compiled: nested blocks are flattened, constant conditionals are folded,
+	// jumps skip over sections that only jump somewhere else, and sections that nothing can reach are removed.
+	// Scripts started from a section other than their default section must mark it with `!entry` for it to be kept.
+	UPROPERTY(EditAnywhere, Config, Category = Compiler)
+	uint8 bOptimizeScripts : 1;
 };
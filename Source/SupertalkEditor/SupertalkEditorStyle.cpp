@@ -2,6 +2,7 @@
 
 #include "SupertalkEditorStyle.h"
 
+#include "Brushes/SlateColorBrush.h"
 #include "Styling/SlateStyleRegistry.h"
 
 TSharedPtr<FSlateStyleSet> FSupertalkEditorStyle::StyleSet = nullptr;
@@ -45,6 +46,7 @@ void FSupertalkEditorStyle::Initialize()
 		StyleSet->Set("SyntaxHighlight.STS.Command", FTextBlockStyle(NormalText).SetColorAndOpacity(FLinearColor(FColor(0xfff7d67c))));
 		StyleSet->Set("SyntaxHighlight.STS.Jump", FTextBlockStyle(NormalText).SetColorAndOpacity(FLinearColor(FColor(0xff7dfa9e))));
 		StyleSet->Set("SyntaxHighlight.STS.Error", FTextBlockStyle(NormalText).SetColorAndOpacity(FLinearColor(FColor(0xffff7083))));
+		StyleSet->Set("SyntaxHighlight.STS.DiagnosticUnderline", new FSlateColorBrush(FLinearColor::White));
 
 		const FEditableTextBoxStyle EditableTextBoxStyle = FEditableTextBoxStyle()
 			.SetTextStyle(NormalText)
@@ -1,7 +1,12 @@
 ﻿// Copyright (c) MissiveArts LLC
 
 #include "SupertalkParser.h"
+#include "SupertalkCharScan.h"
+#include "SupertalkEditorSettings.h"
+#include "SupertalkScriptOptimizer.h"
+#include "AssetRegistry/IAssetRegistry.h"
 #include "Misc/FeedbackContext.h"
+#include "Misc/PackageName.h"
 #include "Supertalk/Supertalk.h"
 #include "Supertalk/SupertalkPlayer.h"
 #include "Supertalk/SupertalkValue.h"
@@ -92,6 +97,92 @@ bool IsTokenSymbol(TCHAR Char)
     }
 }
 
+// Same rules as FCString::IsNumeric, for content that isn't null terminated.
+static bool IsNumeric(FStringView Content)
+{
+	if (!Content.IsEmpty() && (Content[0] == TEXT('-') || Content[0] == TEXT('+')))
+	{
+		Content.RightChopInline(1);
+	}
+
+	bool bHasDot = false;
+	for (TCHAR Char : Content)
+	{
+		if (Char == TEXT('.'))
+		{
+			if (bHasDot)
+			{
+				return false;
+			}
+
+			bHasDot = true;
+		}
+		else if (!FChar::IsDigit(Char))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Finds the asset named by an asset token in the asset registry, without loading it. Off the game thread only the registry's
+// on-disk data is used, finding an object that's already loaded isn't safe there (it may be mid garbage collection or save).
+// The object name can be left out (/Game/Characters/Mayor), which names the package's main asset. Subobjects
+// (/Game/Maps/Town.Town:PersistentLevel.Mayor) aren't in the registry, so only the asset they're in is looked up.
+static bool FindAssetPath(FStringView Content, FSoftObjectPath& OutPath)
+{
+	FString Path(Content);
+	Path.ReplaceCharInline(TEXT('\\'), TEXT('/'));
+
+	FString OuterPath;
+	FString SubObjectPath;
+	if (Path.Split(SUBOBJECT_DELIMITER, &OuterPath, &SubObjectPath))
+	{
+		Path = OuterPath;
+	}
+
+	const FString PackageName = FPackageName::ObjectPathToPackageName(Path);
+	if (Path == PackageName)
+	{
+		Path = FString::Printf(TEXT("%s.%s"), *PackageName, *FPackageName::GetShortName(PackageName));
+	}
+
+	const FString FullPath = SubObjectPath.IsEmpty() ? Path : Path + SUBOBJECT_DELIMITER + SubObjectPath;
+
+	// Classes and other compiled in objects aren't assets, they always exist.
+	if (FPackageName::IsScriptPackage(PackageName))
+	{
+		OutPath = FSoftObjectPath(FullPath);
+		return true;
+	}
+
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		const bool bIncludeOnlyOnDiskAssets = !IsInGameThread();
+		const FAssetData Asset = AssetRegistry->GetAssetByObjectPath(FSoftObjectPath(Path), bIncludeOnlyOnDiskAssets);
+		if (Asset.IsValid())
+		{
+			OutPath = SubObjectPath.IsEmpty() ? Asset.ToSoftObjectPath() : FSoftObjectPath(Asset.ToSoftObjectPath().ToString() + SUBOBJECT_DELIMITER + SubObjectPath);
+			return true;
+		}
+
+		if (!AssetRegistry->IsLoadingAssets())
+		{
+			return false;
+		}
+	}
+
+	// The registry hasn't found every asset yet (i.e. while the editor is starting), settle for the package existing.
+	if (!FPackageName::DoesPackageExist(PackageName))
+	{
+		return false;
+	}
+
+	OutPath = FSoftObjectPath(FullPath);
+	return true;
+}
+
 static TMap<FName, ESupertalkTokenType> NameToTokenOverrideMap = {
 	{ TEXT("if"), ESupertalkTokenType::If },
 	{ TEXT("then"), ESupertalkTokenType::Then },
@@ -114,6 +205,18 @@ bool FSupertalkParser::ParseIntoScript(FString File, FString Input, USupertalkSc
 	return Parser->Parse(File, Input, Script);
 }
 
+bool FSupertalkParser::ValidateScript(const FString& File, const FString& Input, FOutputDevice* Ar, TArray<int32>* OutDiagnosticLines)
+{
+	TSharedRef<FSupertalkParser> Parser = Create(Ar);
+	const bool bResult = Parser->Validate(File, Input);
+	if (OutDiagnosticLines)
+	{
+		*OutDiagnosticLines = Parser->GetDiagnosticLines();
+	}
+
+	return bResult;
+}
+
 bool FSupertalkParser::IsReservedName(FName Input)
 {
 	static TSet<FName> ReservedNames = {
@@ -125,9 +228,35 @@ bool FSupertalkParser::IsReservedName(FName Input)
 	return ReservedNames.Contains(Input);
 }
 
+void FSupertalkParser::SplitLines(FStringView Input, TArray<FStringView>& OutLines, FSupertalkCharScan::EMode CharScanMode)
+{
+	OutLines.Reset();
+	if (Input.IsEmpty())
+	{
+		return;
+	}
+
+	const TCHAR* Data = Input.GetData();
+	const int32 Len = Input.Len();
+	int32 LineStart = 0;
+	for (int32 Found; (Found = FSupertalkCharScan::FindFirstOf(Input.RightChop(LineStart), TEXT('\r'), TEXT('\n'), CharScanMode)) != INDEX_NONE;)
+	{
+		int32 Idx = LineStart + Found;
+		OutLines.Emplace(Data + LineStart, Idx - LineStart);
+		if (Data[Idx] == TEXT('\r') && Idx + 1 < Len && Data[Idx + 1] == TEXT('\n'))
+		{
+			++Idx;
+		}
+
+		LineStart = Idx + 1;
+	}
+
+	OutLines.Emplace(Data + LineStart, Len - LineStart);
+}
+
 FString FSupertalkParser::FTokenContext::ToString() const
 {
-	return FString::Format(TEXT("{0}:{1}:{2}"), { File, Line, Col });
+	return FString::Format(TEXT("{0}:{1}:{2}"), { FString(File), Line, Col });
 }
 
 FString FSupertalkParser::FToken::GetDisplayName() const
@@ -152,7 +281,7 @@ bool FSupertalkParser::FToken::IsIgnorable() const
 FString FSupertalkParser::FToken::GetGeneratedLocalizationKey() const
 {
 	FString GameContentDir = FPaths::ProjectContentDir();
-	FString FileLocation = Context.File;
+	FString FileLocation(Context.File);
 	FPaths::MakePathRelativeTo(FileLocation, *GameContentDir);
 	return FString::Format(TEXT("{0}_L{1}C{2}"), { FileLocation, Context.Line, Context.Col });
 }
@@ -175,20 +304,20 @@ TCHAR FSupertalkParser::FLxStream::ReadChar()
 	return Lines[CurrentLine][CurrentChar++];
 }
 
-FString FSupertalkParser::FLxStream::ReadToEndOfLine()
+FStringView FSupertalkParser::FLxStream::ReadToEndOfLine()
 {
 	if (IsEOF())
 	{
-		return FString();
+		return FStringView();
 	}
 
 	if (!Lines[CurrentLine].IsValidIndex(CurrentChar))
 	{
 		ReadChar();
-		return FString();
+		return FStringView();
 	}
 
-	FString Result = Lines[CurrentLine].Mid(CurrentChar);
+	FStringView Result = Lines[CurrentLine].Mid(CurrentChar);
 	
 	CurrentChar = 0;
 	++CurrentLine;
@@ -196,47 +325,53 @@ FString FSupertalkParser::FLxStream::ReadToEndOfLine()
 	return Result;
 }
 
-FString FSupertalkParser::FLxStream::ReadToEndOfFile()
+void FSupertalkParser::FLxStream::ReadUntilAnyOf(FStringView& Span, TCHAR A, TCHAR B)
 {
-	FString Str = ReadToEndOfLine();
-	while (Lines.IsValidIndex(CurrentLine))
+	if (IsEOF())
+	{
+		return;
+	}
+
+	const FStringView Rest = Lines[CurrentLine].RightChop(CurrentChar);
+	int32 Count = FSupertalkCharScan::FindFirstOf(Rest, A, B, CharScanMode);
+	Count = Count == INDEX_NONE ? Rest.Len() : Count;
+	if (Count == 0)
 	{
-		Str += TEXT("\n") + ReadToEndOfLine();
+		return;
 	}
 
-	return Str;
+	Span = Span.IsEmpty() ? Rest.Left(Count) : FStringView(Span.GetData(), UE_PTRDIFF_TO_INT32(Rest.GetData() + Count - Span.GetData()));
+	CurrentChar += Count;
 }
 
-FString FSupertalkParser::FLxStream::ReadBetweenContexts(const FTokenContext& Left, const FTokenContext& Right)
+FStringView FSupertalkParser::FLxStream::ReadToEndOfFile()
 {
-	FString Str;
-	for (int32 LineIdx = Left.Line; LineIdx <= Right.Line; ++LineIdx)
-	{
-		if (!Lines.IsValidIndex(LineIdx - 1))
-		{
-			break;
-		}
+	FTokenContext Start;
+	Start.Line = CurrentLine + 1;
+	Start.Col = CurrentChar + 1;
 
-		FString& Line = Lines[LineIdx - 1];
-		int32 ColStart = LineIdx == Left.Line ? Left.Col : 1;
-		int32 ColEnd = LineIdx == Right.Line ? Right.Col : INT32_MAX;
-		for (int32 ColIdx = ColStart; ColIdx < ColEnd; ++ColIdx)
-		{
-			if (!Line.IsValidIndex(ColIdx - 1))
-			{
-				break;
-			}
+	CurrentLine = Lines.Num();
+	CurrentChar = 0;
 
-			Str += Line[ColIdx - 1];
-		}
+	return Input.RightChop(GetOffset(Start));
+}
 
-		if (LineIdx != Right.Line)
-		{
-			Str += "\n";
-		}
+FStringView FSupertalkParser::FLxStream::ReadBetweenContexts(const FTokenContext& Left, const FTokenContext& Right) const
+{
+	const int32 Start = GetOffset(Left);
+	return Input.Mid(Start, FMath::Max(GetOffset(Right) - Start, 0));
+}
+
+int32 FSupertalkParser::FLxStream::GetOffset(const FTokenContext& Context) const
+{
+	if (!Lines.IsValidIndex(Context.Line - 1))
+	{
+		return Input.Len();
 	}
 
-	return Str;
+	// Columns past the end of a line are clamped to it, so that a span starting there includes the line ending.
+	const FStringView& Line = Lines[Context.Line - 1];
+	return UE_PTRDIFF_TO_INT32(Line.GetData() - Input.GetData()) + FMath::Clamp(Context.Col - 1, 0, Line.Len());
 }
 
 void FSupertalkParser::FLxStream::GoBack(int32 Count)
@@ -276,29 +411,25 @@ bool FSupertalkParser::FLxStream::IsOnEmptyLine()
 	return false;
 }
 
-FSupertalkParser::FToken FSupertalkParser::FPaStream::ReadToken()
+const FSupertalkParser::FToken& FSupertalkParser::FPaStream::ReadToken()
 {
 	if (IsEOF())
 	{
-		FToken Token;
-		Token.Type = ESupertalkTokenType::Eof;
 		++CurrentToken; // so that GoBack works correctly at Eof
-		return Token;
+		return EofToken;
 	}
 
-	return Tokens[CurrentToken++];
+	return *Tokens[CurrentToken++];
 }
 
-FSupertalkParser::FToken FSupertalkParser::FPaStream::PeekToken() const
+const FSupertalkParser::FToken& FSupertalkParser::FPaStream::PeekToken() const
 {
 	if (IsEOF())
 	{
-		FToken Token;
-		Token.Type = ESupertalkTokenType::Eof;
-		return Token;
+		return EofToken;
 	}
 
-	return Tokens[CurrentToken];
+	return *Tokens[CurrentToken];
 }
 
 void FSupertalkParser::FPaStream::GoBack(int32 Count)
@@ -323,6 +454,8 @@ bool FSupertalkParser::Parse(const FString& File, const FString& Input, USuperta
 		return false;
 	}
 
+	DiagnosticLines.Reset();
+
 	TArray<FToken> Tokens;
 	if (!RunLexer(File, Input, Tokens))
 	{
@@ -330,6 +463,41 @@ bool FSupertalkParser::Parse(const FString& File, const FString& Input, USuperta
 		return false;
 	}
 
+	return ParseTokens(File, Tokens, Script);
+}
+
+bool FSupertalkParser::Validate(const FString& File, const FString& Input)
+{
+	TArray<FToken> Tokens;
+	return Validate(File, Input, Tokens);
+}
+
+bool FSupertalkParser::Validate(const FString& File, const FString& Input, TArray<FToken>& OutTokens)
+{
+	DiagnosticLines.Reset();
+
+	if (!RunLexer(File, Input, OutTokens))
+	{
+		STP_LOG(Error, TEXT("Validation of '%s' failed to a lexer error."), *File);
+		return false;
+	}
+
+	if (!RunParser(nullptr, OutTokens))
+	{
+		STP_LOG(Error, TEXT("Validation of '%s' failed to a parser error."), *File);
+		return false;
+	}
+
+	return true;
+}
+
+bool FSupertalkParser::ParseTokens(const FString& File, const TArray<FToken>& Tokens, USupertalkScript* Script)
+{
+	if (!ensure(Script))
+	{
+		return false;
+	}
+
 	if (!RunParser(Script, Tokens))
 	{
 		STP_LOG(Error, TEXT("Compilation of '%s' failed to a parser error."), *File);
@@ -345,6 +513,11 @@ bool FSupertalkParser::TokenizeSyntax(const FString& File, const FString& Input,
 	return RunLexer(File, Input, OutTokens, true);
 }
 
+bool FSupertalkParser::TokenizeSyntax(const FString& File, const FString& Input, int32 StartLine, TFunctionRef<bool(int32 Line)> ShouldStopAtLine, TArray<FToken>& OutTokens)
+{
+	return RunLexer(File, Input, StartLine, ShouldStopAtLine, OutTokens, true);
+}
+
 /*
 void FSupertalkParser::RunTest()
 {
@@ -356,7 +529,7 @@ void FSupertalkParser::RunTest()
 	{
 		for (const FToken& Token : Tokens)
 		{
-			UE_LOG(LogSupertalk, Log, TEXT("Token at %d:%d %s with content %s"), Token.Context.Line, Token.Context.Col, *Token.GetDisplayName().ToString(), *Token.Content);
+			UE_LOG(LogSupertalk, Log, TEXT("Token at %d:%d %s with content %s"), Token.Context.Line, Token.Context.Col, *Token.GetDisplayName().ToString(), *FString(Token.GetContent()));
 		}
 	}
 	else
@@ -386,16 +559,29 @@ void FSupertalkParser::Initialize()
 }
 
 bool FSupertalkParser::RunLexer(const FString& File, const FString& Input, TArray<FToken>& OutTokens, bool bIgnoreErrors)
+{
+	return RunLexer(File, Input, 0, [](int32) { return false; }, OutTokens, bIgnoreErrors);
+}
+
+bool FSupertalkParser::RunLexer(const FString& File, const FString& Input, int32 StartLine, TFunctionRef<bool(int32 Line)> ShouldStopAtLine, TArray<FToken>& OutTokens, bool bIgnoreErrors)
 {
 	FLxContext Ctx;
 	Ctx.File = File;
 	Ctx.Stream.CurrentChar = 0;
-	Ctx.Stream.CurrentLine = 0;
+	Ctx.Stream.CurrentLine = StartLine;
+	Ctx.Stream.Input = Input;
+	Ctx.Stream.CharScanMode = CharScanMode;
 
-	Input.ParseIntoArrayLines(Ctx.Stream.Lines, false);
+	SplitLines(Input, Ctx.Stream.Lines, CharScanMode);
 
 	while (!Ctx.Stream.IsEOF())
 	{
+		// Indentation is measured again at the start of every line, the choice hack is the only state that can carry over.
+		if (Ctx.Stream.CurrentChar == 0 && !Ctx.bIsChoiceLine && ShouldStopAtLine(Ctx.Stream.CurrentLine))
+		{
+			return true;
+		}
+
 		FTokenContext CurrentContext = Ctx.CreateContext();
 
 		FToken Token;
@@ -410,16 +596,17 @@ bool FSupertalkParser::RunLexer(const FString& File, const FString& Input, TArra
 				{
 					// Continuing would result in an infinite loop, we can't continue ignoring errors.
 					Token.Type = ESupertalkTokenType::Unknown;
-					Token.Source += Ctx.Stream.ReadToEndOfFile();
-					OutTokens.Add(Token);
+					Token.Source = Ctx.Stream.ReadToEndOfFile();
+					OutTokens.Add(MoveTemp(Token));
 					return false;
 				}
 
-				OutTokens.Add(Token);
+				OutTokens.Add(MoveTemp(Token));
 				continue;
 			}
 
-			STP_LOG(Error, TEXT("%s - lexer: unexpected content '%s'"), *Token.Context.ToString(), *Token.Content);
+			STP_LOG(Error, TEXT("%s - lexer: unexpected content '%s'"), *Token.Context.ToString(), *FString(Token.GetContent()));
+			DiagnosticLines.Add(Token.Context.Line);
 			return false;
 		}
 
@@ -431,18 +618,19 @@ bool FSupertalkParser::RunLexer(const FString& File, const FString& Input, TArra
 				Token = FToken();
 				Token.Context = CurrentContext;
 				Token.Type = ESupertalkTokenType::Unknown;
-				Token.Source += Ctx.Stream.ReadToEndOfFile();
-				OutTokens.Add(Token);
+				Token.Source = Ctx.Stream.ReadToEndOfFile();
+				OutTokens.Add(MoveTemp(Token));
 			}
 			else
 			{
 				STP_LOG(Error, TEXT("%s - lexer: repeated token, potentially caught in infinite loop. Talk to a developer!"), *Token.Context.ToString());
+				DiagnosticLines.Add(Token.Context.Line);
 			}
 
 			return false;
 		}
 
-		OutTokens.Add(Token);
+		OutTokens.Add(MoveTemp(Token));
 	}
 
 	return true;
@@ -450,19 +638,29 @@ bool FSupertalkParser::RunLexer(const FString& File, const FString& Input, TArra
 
 bool FSupertalkParser::RunParser(USupertalkScript* Script, const TArray<FToken>& InTokens)
 {
-	check(Script);
-	
+	// Without a script the tokens are only validated.
 	FPaContext Ctx;
 	Ctx.Script = Script;
 	Ctx.DefaultNamespace = TEXT("Supertalk.Script.Default");
-	Ctx.Stream.Tokens = InTokens;
 
-	// Reset the state of the script
-	Ctx.Script->Sections.Empty();
-	Ctx.Script->DefaultSection = NAME_None;
+	if (Ctx.Script)
+	{
+		// Reset the state of the script
+		Ctx.Script->Sections.Empty();
+		Ctx.Script->Program.Reset();
+		Ctx.Script->Variables.Empty();
+		Ctx.Script->DefaultSection = NAME_None;
+	}
 
-	// Remove any ignorable tokens (for example, comments) from the stream.
-	Ctx.Stream.Tokens.RemoveAll([](const FToken& Token) { return Token.IsIgnorable(); });
+	// Leave any ignorable tokens (for example, comments) out of the stream.
+	Ctx.Stream.Tokens.Reserve(InTokens.Num());
+	for (const FToken& Token : InTokens)
+	{
+		if (!Token.IsIgnorable())
+		{
+			Ctx.Stream.Tokens.Add(&Token);
+		}
+	}
 
 	FName DefaultSection = NAME_None;
 	TMap<FName, FSupertalkSection> Sections;
@@ -493,19 +691,29 @@ bool FSupertalkParser::RunParser(USupertalkScript* Script, const TArray<FToken>&
 			return false;
 		}
 
-		if (!PaSection(Ctx, SectionName))
+		FSupertalkSection Section;
+		Section.Name = SectionName;
+		Ctx.CurrentSection = bIsUnnamedSection ? NAME_None : SectionName;
+		if (!PaSection(Ctx, Section))
 		{
 			return false;
 		}
 
 		// Certain actions (specifically, directives) don't actually compile to anything and as such
 		// shouldn't cause an unnamed default section to be created.
-		if (bIsUnnamedSection && Ctx.Script->Sections[SectionName].Actions.Num() == 0)
+		if (bIsUnnamedSection && Section.Actions.Num() == 0)
+		{
+			continue;
+		}
+
+		Ctx.SectionNames.Add(SectionName);
+		if (Ctx.IsValidating())
 		{
-			Ctx.Script->Sections.Remove(SectionName);
 			continue;
 		}
 
+		Ctx.Script->Sections.Add(SectionName, MoveTemp(Section));
+
 		if (Ctx.Script->DefaultSection == NAME_None)
 		{
 			Ctx.Script->DefaultSection = SectionName;
@@ -517,47 +725,73 @@ bool FSupertalkParser::RunParser(USupertalkScript* Script, const TArray<FToken>&
 	for (const auto& Jump : Ctx.Jumps)
 	{
 		// Always allow None as a jump destination, as it is used to signal the script to end.
-		if (Jump.Value != NAME_None && !Ctx.Script->Sections.Contains(Jump.Value))
+		if (Jump.Value != NAME_None && !Ctx.SectionNames.Contains(Jump.Value))
 		{
 			bAllValidJumps = false;
-			ParseError(Ctx, Jump.Key, FString::Format(TEXT("jump to unknown section '{0}'"), { Jump.Value.ToString() }));
+			ParseError(Ctx, *Jump.Key, FString::Format(TEXT("jump to unknown section '{0}'"), { Jump.Value.ToString() }));
 		}
 	}
 
+	TSet<FName> EntrySections;
+	for (const auto& Entry : Ctx.EntrySections)
+	{
+		if (!Ctx.SectionNames.Contains(Entry.Value))
+		{
+			bAllValidJumps = false;
+			ParseError(Ctx, *Entry.Key, FString::Format(TEXT("entry directive names unknown section '{0}'"), { Entry.Value.ToString() }));
+		}
+
+		EntrySections.Add(Entry.Value);
+	}
+
 	if (!bAllValidJumps)
 	{
 		return false;
 	}
 
+	if (Ctx.Script)
+	{
+		if (GetDefault<USupertalkEditorSettings>()->bOptimizeScripts)
+		{
+			const FSupertalkOptimizationReport Report = FSupertalkScriptOptimizer::Optimize(Ctx.Script, EntrySections);
+			STP_LOG(Display, TEXT("Optimized '%s': %s."), *Ctx.Script->GetName(), *Report.ToString());
+		}
+
+		Ctx.Script->CompileProgram();
+	}
+
 	return true;
 }
 
 void FSupertalkParser::ConsumeEmptyLines(FLxContext& InCtx)
 {
-	int32 InitialLine = InCtx.Stream.CurrentLine;
-	int32 InitialChar = InCtx.Stream.CurrentChar;
-	while (!InCtx.Stream.IsEOF())
+	FLxStream& Stream = InCtx.Stream;
+	int32 InitialLine = Stream.CurrentLine;
+	while (!Stream.IsEOF())
 	{
-		switch (InCtx.Stream.ReadChar())
+		const FStringView Rest = Stream.Lines[Stream.CurrentLine].RightChop(Stream.CurrentChar);
+		int32 Found = FSupertalkCharScan::FindFirstNotOf(Rest, TEXT(' '), TEXT('\t'), Stream.CharScanMode);
+
+		// Stray nulls count as whitespace too. Lines never contain line endings.
+		while (Found != INDEX_NONE && Rest[Found] == TEXT('\0'))
 		{
-		default:
-			if (InitialLine != InCtx.Stream.CurrentLine)
-			{
-				InCtx.Stream.CurrentChar = 0;
-			}
-			else
+			const int32 Next = FSupertalkCharScan::FindFirstNotOf(Rest.RightChop(Found + 1), TEXT(' '), TEXT('\t'), Stream.CharScanMode);
+			Found = Next == INDEX_NONE ? INDEX_NONE : Found + 1 + Next;
+		}
+
+		if (Found != INDEX_NONE)
+		{
+			// Nothing is consumed from the line the next token is on, the whitespace before it is consumed as indentation.
+			if (InitialLine != Stream.CurrentLine)
 			{
-				InCtx.Stream.CurrentChar = InitialChar;
+				Stream.CurrentChar = 0;
 			}
-			return;
 
-		case TEXT('\0'):
-		case TEXT('\n'):
-		case TEXT('\r'):
-		case TEXT(' '):
-		case TEXT('\t'):
-			break;
+			return;
 		}
+
+		++Stream.CurrentLine;
+		Stream.CurrentChar = 0;
 	}
 
 	// HACK
@@ -580,28 +814,25 @@ int32 FSupertalkParser::ConsumeWhitespaceUpdateIndentation(FLxContext& InCtx)
 
 int32 FSupertalkParser::ConsumeWhitespace(FLxContext& InCtx)
 {
-	if (InCtx.Stream.IsEOF())
+	FLxStream& Stream = InCtx.Stream;
+	if (Stream.IsEOF())
 	{
 		return 0;
 	}
 
-	int32 Consumed = 0;
-	while (!InCtx.Stream.IsEOF())
+	const FStringView Line = Stream.Lines[Stream.CurrentLine];
+	const FStringView Rest = Line.RightChop(Stream.CurrentChar);
+	const int32 Consumed = FSupertalkCharScan::FindFirstNotOf(Rest, TEXT(' '), TEXT('\t'), Stream.CharScanMode);
+	if (Consumed != INDEX_NONE)
 	{
-		switch (InCtx.Stream.ReadChar())
-		{
-		default:
-			InCtx.Stream.GoBack(1);
-			return Consumed;
-
-        case ' ':
-        case '\t':
-			++Consumed;
-            break;
-		}
+		Stream.CurrentChar += Consumed;
+		return Consumed;
 	}
 
-	return Consumed;
+	// Only whitespace left on the line. This used to read the line ending and go back over it, which leaves the stream on
+	// the last character of the line rather than after it, and the rest of the lexer expects that.
+	Stream.CurrentChar = FMath::Max(Line.Len() - 1, 0);
+	return Rest.Len();
 }
 
 bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
@@ -626,7 +857,9 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 	}
 
 	TCHAR Char = InCtx.Stream.ReadChar();
-	OutToken.Content = FString() + Char;
+	FStringView Content;
+	InCtx.Stream.ExtendSpan(Content);
+	OutToken.SetContent(Content);
 
 	// HACK: choices need to have special handling to consume all the text left on the line, except if we find a
 	// localization key. Eventually this should be rewritten because not only is it hacky but it also means each choice
@@ -644,7 +877,7 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 			OutToken.Type = ESupertalkTokenType::Text;
 			if (!LxTokenText(InCtx, OutToken, ETextParseMode::SingleLine))
 			{
-				OutToken.Content = FString();
+				OutToken.SetContent(FStringView());
 			}
 
 			InCtx.bIsChoiceLine = false;
@@ -663,7 +896,7 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 			return false;
 		}
 
-		if (ESupertalkTokenType* Override = NameToTokenOverrideMap.Find(*OutToken.Content))
+		if (ESupertalkTokenType* Override = NameToTokenOverrideMap.Find(FName(OutToken.GetContent(), FNAME_Find)))
 		{
 			OutToken.Type = *Override;
 		}
@@ -686,7 +919,8 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 	case Symbols::Equals:
 		if (InCtx.Stream.ReadChar() == Symbols::Equals)
 		{
-			OutToken.Content = TEXT("==");
+			InCtx.Stream.ExtendSpan(Content);
+			OutToken.SetContent(Content);
 			OutToken.Type = ESupertalkTokenType::Equal;
 		}
 		else
@@ -701,7 +935,7 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 		OutToken.Type = ESupertalkTokenType::Text;
 		if (!LxTokenText(InCtx, OutToken, ETextParseMode::MultiLine))
 		{
-			OutToken.Content = FString();
+			OutToken.SetContent(FStringView());
 		}
 		
 		return true;
@@ -729,7 +963,8 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 
 	case Symbols::Comment:
 		Char = InCtx.Stream.ReadChar();
-		OutToken.Content = OutToken.Content + Char;
+		InCtx.Stream.ExtendSpan(Content);
+		OutToken.SetContent(Content);
 		switch (Char)
 		{
 		default:
@@ -746,6 +981,11 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 		}
 
 	case Symbols::CommandStart:
+		if (LxTokenFunctionCall(InCtx, OutToken))
+		{
+			return true;
+		}
+
 		OutToken.Type = ESupertalkTokenType::Command;
 		return LxTokenText(InCtx, OutToken, ETextParseMode::SingleLine);
 
@@ -795,7 +1035,8 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 			break;
 
 		case Symbols::Equals:
-			OutToken.Content = TEXT("~=");
+			InCtx.Stream.ExtendSpan(Content);
+			OutToken.SetContent(Content);
 			OutToken.Type = ESupertalkTokenType::NotEqual;
 			break;
 		}
@@ -806,7 +1047,7 @@ bool FSupertalkParser::LxToken(FLxContext& InCtx, FToken& OutToken)
 
 bool FSupertalkParser::LxTokenName(FLxContext& InCtx, FToken& OutName, bool AllowWhitespace)
 {
-	FString Content;
+	FStringView Content;
 	bool bHasStarted = false;
 	while (!InCtx.Stream.IsEOF())
 	{
@@ -825,7 +1066,7 @@ bool FSupertalkParser::LxTokenName(FLxContext& InCtx, FToken& OutName, bool Allo
 			
 			break;
 		}
-		else if (NameToTokenOverrideMap.Contains(*Content) && FChar::IsWhitespace(Char))
+		else if (FChar::IsWhitespace(Char) && NameToTokenOverrideMap.Contains(FName(Content, FNAME_Find)))
 		{
 			InCtx.Stream.GoBack(1);
 			break;
@@ -833,23 +1074,60 @@ bool FSupertalkParser::LxTokenName(FLxContext& InCtx, FToken& OutName, bool Allo
 		else
 		{
 			bHasStarted = true;
-			Content += Char;
+			InCtx.Stream.ExtendSpan(Content);
 		}
 	}
 
-	Content.TrimStartAndEndInline();
+	Content = Content.TrimStartAndEnd();
 	if (Content.IsEmpty())
 	{
 		return false;
 	}
 
-	OutName.Content = Content;
+	OutName.SetContent(Content);
+	return true;
+}
+
+bool FSupertalkParser::LxTokenFunctionCall(FLxContext& InCtx, FToken& OutFunctionCall)
+{
+	// Commands written as `> Func(...)` have their arguments parsed as expressions. The open paren has to immediately
+	// follow the name, anything else is lexed as a plain text command.
+	const int32 StartLine = InCtx.Stream.CurrentLine;
+	const int32 StartChar = InCtx.Stream.CurrentChar;
+	const FStringView Line = InCtx.Stream.Lines[StartLine];
+
+	int32 Idx = StartChar;
+	while (Line.IsValidIndex(Idx) && FChar::IsWhitespace(Line[Idx]))
+	{
+		++Idx;
+	}
+
+	const int32 NameStart = Idx;
+	while (Line.IsValidIndex(Idx) && (FChar::IsAlnum(Line[Idx]) || Line[Idx] == TEXT('_')))
+	{
+		++Idx;
+	}
+
+	if (Idx == NameStart || !Line.IsValidIndex(Idx) || Line[Idx] != Symbols::GroupStart)
+	{
+		return false;
+	}
+
+	OutFunctionCall.Type = ESupertalkTokenType::FunctionCall;
+	OutFunctionCall.SetContent(Line.Mid(NameStart, Idx - NameStart));
+	InCtx.Stream.CurrentChar = Idx;
 	return true;
 }
 
 bool FSupertalkParser::LxTokenText(FLxContext& InCtx, FToken& OutText, ETextParseMode Mode)
 {
-	FString Content;
+	// Text on a single line is a view into the input. Once multi-line text actually carries on to another line, everything
+	// read so far is copied into Joined along with the separators, which are held back until then so that text ending
+	// with a line break doesn't need a copy.
+	FStringView Content;
+	FString Joined;
+	int32 NumPendingNewLines = 0;
+	bool bPendingSpace = false;
 	int32 InitialIndentation = InCtx.CurrentIndentation;
 	bool bOnNewLine = false;
 
@@ -858,6 +1136,9 @@ bool FSupertalkParser::LxTokenText(FLxContext& InCtx, FToken& OutText, ETextPars
 	{
 		QuoteChar = InCtx.Stream.ReadChar();
 	}
+
+	// Only the closing quote can end the text before the end of the line, everything up to either is read in one go.
+	const TCHAR StopChar = Mode == ETextParseMode::Quoted ? QuoteChar : TEXT('\n');
 	
 	while (!InCtx.Stream.IsEOF())
 	{
@@ -885,8 +1166,27 @@ bool FSupertalkParser::LxTokenText(FLxContext& InCtx, FToken& OutText, ETextPars
 
 		textChar:
 		default:
+			if (bPendingSpace || NumPendingNewLines > 0)
+			{
+				Joined.Append(Content.GetData(), Content.Len());
+				if (bPendingSpace)
+				{
+					Joined.AppendChar(TEXT(' '));
+				}
+
+				for (; NumPendingNewLines > 0; --NumPendingNewLines)
+				{
+					Joined.AppendChar(TEXT('\n'));
+				}
+
+				Content = FStringView();
+				bPendingSpace = false;
+			}
+
 			bOnNewLine = false;
-			Content += Char;
+			InCtx.Stream.ExtendSpan(Content);
+
+			InCtx.Stream.ReadUntilAnyOf(Content, StopChar, StopChar);
 			break;
 
 		case TEXT('\n'):
@@ -894,7 +1194,7 @@ bool FSupertalkParser::LxTokenText(FLxContext& InCtx, FToken& OutText, ETextPars
 			{
 				if (bOnNewLine)
 				{
-					Content += TEXT('\n');
+					++NumPendingNewLines;
 				}
 
 				if (InCtx.Stream.IsOnEmptyLine())
@@ -905,7 +1205,7 @@ bool FSupertalkParser::LxTokenText(FLxContext& InCtx, FToken& OutText, ETextPars
 				{
 					if (!bOnNewLine)
 					{
-						Content += TEXT(' ');
+						bPendingSpace = true;
 					}
 
 					if (ConsumeWhitespace(InCtx) <= InitialIndentation)
@@ -930,25 +1230,38 @@ bool FSupertalkParser::LxTokenText(FLxContext& InCtx, FToken& OutText, ETextPars
 	}
 
 complete:
-	Content.TrimStartAndEndInline();
+	if (!Joined.IsEmpty())
+	{
+		Joined.Append(Content.GetData(), Content.Len());
+		Joined.TrimStartAndEndInline();
+		if (Joined.IsEmpty())
+		{
+			return false;
+		}
+
+		OutText.SetContent(MoveTemp(Joined));
+		return true;
+	}
+
+	Content = Content.TrimStartAndEnd();
 	if (Content.IsEmpty())
 	{
 		return false;
 	}
 
-	OutText.Content = Content;
+	OutText.SetContent(Content);
 	return true;
 }
 
 bool FSupertalkParser::LxTokenAsset(FLxContext& InCtx, FToken& OutAsset)
 {
-	FString Content = FString();
+	FStringView Content;
 	while (!InCtx.Stream.IsEOF())
 	{
 		TCHAR Char = InCtx.Stream.ReadChar();
 		if (FChar::IsIdentifier(Char) || Char == TEXT('/') || Char == TEXT('\\') || Char == TEXT(' ') || Char == TEXT('.'))
 		{
-			Content += Char;
+			InCtx.Stream.ExtendSpan(Content);
 		}
 		else
 		{
@@ -960,50 +1273,38 @@ bool FSupertalkParser::LxTokenAsset(FLxContext& InCtx, FToken& OutAsset)
 		}
 	}
 
-	Content.TrimStartAndEndInline();
+	Content = Content.TrimStartAndEnd();
 	if (Content.IsEmpty())
 	{
 		return false;
 	}
 
-	OutAsset.Content = Content;
+	OutAsset.SetContent(Content);
 	return true;
 }
 
 bool FSupertalkParser::LxTokenComment(FLxContext& InCtx, FToken& OutComment)
 {
-	OutComment.Content = InCtx.Stream.ReadToEndOfLine();
+	OutComment.SetContent(InCtx.Stream.ReadToEndOfLine());
 	return true;
 }
 
 bool FSupertalkParser::LxTokenDirective(FLxContext& InCtx, FToken& OutDirective)
 {
-	FString Content = FString();
-	while (!InCtx.Stream.IsEOF())
-	{
-		TCHAR Char = InCtx.Stream.ReadChar();
-		if (Char == '\n')
-		{
-			break;
-		}
-
-		Content += Char;
-	}
-
-	Content.TrimStartAndEndInline();
+	const FStringView Content = InCtx.Stream.ReadToEndOfLine().TrimStartAndEnd();
 	if (Content.IsEmpty())
 	{
 		return false;
 	}
 
-	OutDirective.Content = Content;
+	OutDirective.SetContent(Content);
 	return true;
 }
 
 bool FSupertalkParser::LxTokenLocalizationKey(FLxContext& InCtx, FToken& OutLocalizationKey)
 {
-	FString Content = FString();
-	FString Namespace;
+	FStringView Content;
+	FStringView Namespace;
 	while (!InCtx.Stream.IsEOF())
 	{
 		TCHAR Char = InCtx.Stream.ReadChar();
@@ -1015,7 +1316,7 @@ bool FSupertalkParser::LxTokenLocalizationKey(FLxContext& InCtx, FToken& OutLoca
 			}
 
 			Namespace = Content;
-			Content = FString();
+			Content = FStringView();
 		}
 		else if (Char == Symbols::SingleQuote
 			|| Char == Symbols::DoubleQuote
@@ -1027,23 +1328,22 @@ bool FSupertalkParser::LxTokenLocalizationKey(FLxContext& InCtx, FToken& OutLoca
 		}
 		else
 		{
-			Content += Char;
+			InCtx.Stream.ExtendSpan(Content);
 		}
 	}
 	
-	Content.TrimStartAndEndInline();
+	Content = Content.TrimStartAndEnd();
 	if (Content.IsEmpty())
 	{
 		return false;
 	}
 
-	Namespace.TrimStartAndEndInline();
-	OutLocalizationKey.Content = Content;
-	OutLocalizationKey.Namespace = Namespace;
+	OutLocalizationKey.SetContent(Content);
+	OutLocalizationKey.Namespace = Namespace.TrimStartAndEnd();
 	return true;
 }
 
-void FSupertalkParser::ParseTokenError(const FPaContext& InCtx, const FToken& Token, ESupertalkTokenType ExpectedTokenType) const
+void FSupertalkParser::ParseTokenError(const FPaContext& InCtx, const FToken& Token, ESupertalkTokenType ExpectedTokenType)
 {
 	FToken ExpectedToken;
 	ExpectedToken.Type = ExpectedTokenType;
@@ -1051,49 +1351,48 @@ void FSupertalkParser::ParseTokenError(const FPaContext& InCtx, const FToken& To
 	ParseTokenError(InCtx, Token, ExpectedToken.GetDisplayName());
 }
 
-void FSupertalkParser::ParseTokenError(const FPaContext& InCtx, const FToken& Token, const FString& Expected) const
+void FSupertalkParser::ParseTokenError(const FPaContext& InCtx, const FToken& Token, const FString& Expected)
 {
-	ParseError(InCtx, Token, FString::Format(TEXT("expected token {0} but found {1} near '{2}'"), { Expected, Token.GetDisplayName(), Token.Content }));
+	ParseError(InCtx, Token, FString::Format(TEXT("expected token {0} but found {1} near '{2}'"), { Expected, Token.GetDisplayName(), FString(Token.GetContent()) }));
 }
 
-void FSupertalkParser::ParseError(const FPaContext& InCtx, const FToken& Token, const FString& Message) const
+void FSupertalkParser::ParseError(const FPaContext& InCtx, const FToken& Token, const FString& Message)
 {
 	STP_LOG(Error, TEXT("%s - parser: %s"), *Token.Context.ToString(), *Message);
+	DiagnosticLines.Add(Token.Context.Line);
 }
 
-void FSupertalkParser::ParseError(const FPaContext& InCtx, const FString& Message) const
+void FSupertalkParser::ParseError(const FPaContext& InCtx, const FString& Message)
 {
 	ParseError(InCtx, InCtx.Stream.PeekToken(), Message);
 }
 
-void FSupertalkParser::ParseWarning(const FPaContext& InCtx, const FToken& Token, const FString& Message) const
+void FSupertalkParser::ParseWarning(const FPaContext& InCtx, const FToken& Token, const FString& Message)
 {
 	STP_LOG(Warning, TEXT("%s - parser: %s"), *Token.Context.ToString(), *Message);
+	DiagnosticLines.Add(Token.Context.Line);
 }
 
-void FSupertalkParser::ParseWarning(const FPaContext& InCtx, const FString& Message) const
+void FSupertalkParser::ParseWarning(const FPaContext& InCtx, const FString& Message)
 {
 	ParseWarning(InCtx, InCtx.Stream.PeekToken(), Message);
 }
 
 bool FSupertalkParser::PaTrySectionName(FPaContext& InCtx, FName& OutName)
 {
-	FToken Token = InCtx.Stream.ReadToken();
+	const FToken& Token = InCtx.Stream.ReadToken();
 	if (Token.Type != ESupertalkTokenType::Section)
 	{
 		InCtx.Stream.GoBack(1);
 		return false;
 	}
 
-	OutName = FName(Token.Content);
+	OutName = FName(Token.GetContent());
 	return true;
 }
 
-bool FSupertalkParser::PaSection(FPaContext& InCtx, FName Name)
+bool FSupertalkParser::PaSection(FPaContext& InCtx, FSupertalkSection& OutSection)
 {
-	FSupertalkSection Section;
-	Section.Name = Name;
-	
 	while (!InCtx.Stream.IsEOF() && InCtx.Stream.PeekToken().Type != ESupertalkTokenType::Section)
 	{
 		FSupertalkAction Action;
@@ -1104,18 +1403,18 @@ bool FSupertalkParser::PaSection(FPaContext& InCtx, FName Name)
 
 		if (Action.Operation != ESupertalkOperation::Noop)
 		{
-			Section.Actions.Add(Action);
+			OutSection.Actions.Add(Action);
 		}
 	}
 
-	InCtx.Script->Sections.Add(Section.Name, Section);
-
 	return true;
 }
 
 bool FSupertalkParser::PaAction(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken Token = InCtx.Stream.ReadToken();
+	const FToken& Token = InCtx.Stream.ReadToken();
+	OutAction.SourceLine = Token.Context.Line;
+
 	switch (Token.Type)
 	{
 	default:
@@ -1128,7 +1427,7 @@ bool FSupertalkParser::PaAction(FPaContext& InCtx, FSupertalkAction& OutAction)
 
 	case ESupertalkTokenType::Name:
 		{
-			FToken Token2 = InCtx.Stream.ReadToken();
+			const FToken& Token2 = InCtx.Stream.ReadToken();
 			switch (Token2.Type)
 			{
 			default:
@@ -1153,6 +1452,7 @@ bool FSupertalkParser::PaAction(FPaContext& InCtx, FSupertalkAction& OutAction)
 		return PaConditional(InCtx, OutAction);
 
 	case ESupertalkTokenType::Command:
+	case ESupertalkTokenType::FunctionCall:
 		InCtx.Stream.GoBack(1);
 		return PaCommand(InCtx, OutAction);
 
@@ -1172,14 +1472,15 @@ bool FSupertalkParser::PaAction(FPaContext& InCtx, FSupertalkAction& OutAction)
 
 bool FSupertalkParser::PaDirective(FPaContext& InCtx)
 {
-	FToken Token = InCtx.Stream.ReadToken();
+	const FToken& Token = InCtx.Stream.ReadToken();
 	check(Token.Type == ESupertalkTokenType::Directive);
 
+	const FString Text(Token.GetContent());
 	FString Directive;
 	FString Content;
-	if (!Token.Content.Split(TEXT(" "), &Directive, &Content))
+	if (!Text.Split(TEXT(" "), &Directive, &Content))
 	{
-		Directive = Token.Content;
+		Directive = Text;
 	}
 
 	if (Directive.Compare(TEXT("namespace"), ESearchCase::IgnoreCase) == 0)
@@ -1194,6 +1495,35 @@ bool FSupertalkParser::PaDirective(FPaContext& InCtx)
 		InCtx.DefaultNamespace = Content;
 		return true;
 	}
+	else if (Directive.Compare(TEXT("entry"), ESearchCase::IgnoreCase) == 0)
+	{
+		// Marks sections that are run from outside of the script, so that optimizing the script keeps them even if nothing
+		// jumps to them. Without arguments, marks the section the directive is in.
+		Content.TrimStartAndEndInline();
+		if (Content.IsEmpty())
+		{
+			// The implicit first section is the default section, which is always kept.
+			if (InCtx.CurrentSection != NAME_None)
+			{
+				InCtx.EntrySections.Add(TTuple<const FToken*, FName>(&Token, InCtx.CurrentSection));
+			}
+
+			return true;
+		}
+
+		TArray<FString> Names;
+		Content.ParseIntoArray(Names, TEXT(","));
+		for (FString& Name : Names)
+		{
+			Name.TrimStartAndEndInline();
+			if (!Name.IsEmpty())
+			{
+				InCtx.EntrySections.Add(TTuple<const FToken*, FName>(&Token, FName(Name)));
+			}
+		}
+
+		return true;
+	}
 	else if (Directive.Compare(TEXT("error"), ESearchCase::IgnoreCase) == 0)
 	{
 		Content.TrimStartAndEndInline();
@@ -1207,17 +1537,17 @@ bool FSupertalkParser::PaDirective(FPaContext& InCtx)
 
 bool FSupertalkParser::PaAssign(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken VarToken = InCtx.Stream.ReadToken();
+	const FToken& VarToken = InCtx.Stream.ReadToken();
 	check(VarToken.Type == ESupertalkTokenType::Name);
 
-	FName VarName = FName(VarToken.Content);
+	FName VarName = FName(VarToken.GetContent());
 	if (IsReservedName(VarName))
 	{
 		ParseError(InCtx, VarToken, TEXT("invalid variable name"));
 		return false;
 	}
 
-	FToken AssignToken = InCtx.Stream.ReadToken();
+	const FToken& AssignToken = InCtx.Stream.ReadToken();
 	if (AssignToken.Type != ESupertalkTokenType::Assign)
 	{
 		ParseTokenError(InCtx, AssignToken, ESupertalkTokenType::Assign);
@@ -1231,9 +1561,14 @@ bool FSupertalkParser::PaAssign(FPaContext& InCtx, FSupertalkAction& OutAction)
 	}
 
 	OutAction.Operation = ESupertalkOperation::Assign;
-	
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
 	USupertalkAssignParams* Params = NewObject<USupertalkAssignParams>(InCtx.Script);
-	Params->Variable = FName(VarToken.Content);
+	Params->Variable = FName(VarToken.GetContent());
+	Params->VariableSlot = InCtx.Script->Variables.AddUnique(Params->Variable);
 	Params->Expression = Expr;
 	OutAction.Params = Params;
 
@@ -1248,18 +1583,18 @@ bool FSupertalkParser::PaLine(FPaContext& InCtx, FSupertalkAction& OutAction)
 		return false;
 	}
 
-	FToken Token = InCtx.Stream.ReadToken();
-	if (Token.Type == ESupertalkTokenType::Separator)
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	if (Token->Type == ESupertalkTokenType::Separator)
 	{
 		if (!PaValue(InCtx, Line.SpeakerNameOverride))
 		{
 			return false;
 		}
 
-		Token = InCtx.Stream.ReadToken();
+		Token = &InCtx.Stream.ReadToken();
 	}
 
-	if (Token.Type == ESupertalkTokenType::AttrStart)
+	if (Token->Type == ESupertalkTokenType::AttrStart)
 	{
 		InCtx.Stream.GoBack(1);
 		if (!PaAttributeList(InCtx, Line.Attributes))
@@ -1267,14 +1602,19 @@ bool FSupertalkParser::PaLine(FPaContext& InCtx, FSupertalkAction& OutAction)
 			return false;
 		}
 
-		Token = InCtx.Stream.ReadToken();
+		Token = &InCtx.Stream.ReadToken();
 	}
 
-	if (Token.Type == ESupertalkTokenType::StatementEnd)
+	if (Token->Type == ESupertalkTokenType::StatementEnd)
 	{
 		Line.bIsBlankLine = true;
+		Line.CompileFormat(InCtx.Script);
 
 		OutAction.Operation = ESupertalkOperation::Line;
+		if (InCtx.IsValidating())
+		{
+			return true;
+		}
 
 		USupertalkPlayLineParams* Params = NewObject<USupertalkPlayLineParams>(InCtx.Script);
 		Params->Line = Line;
@@ -1285,36 +1625,41 @@ bool FSupertalkParser::PaLine(FPaContext& InCtx, FSupertalkAction& OutAction)
 
 	FString Namespace = InCtx.DefaultNamespace;
 	FString Key;
-	if (Token.Type == ESupertalkTokenType::LocalizationKey)
+	if (Token->Type == ESupertalkTokenType::LocalizationKey)
 	{
-		if (!Token.Namespace.IsEmpty())
+		if (!Token->Namespace.IsEmpty())
 		{
-			Namespace = Token.Namespace;
+			Namespace = FString(Token->Namespace);
 		}
 
-		Key = Token.Content;
+		Key = FString(Token->GetContent());
 
-		Token = InCtx.Stream.ReadToken();
+		Token = &InCtx.Stream.ReadToken();
 	}
 
-	if (Token.Type != ESupertalkTokenType::Text)
+	if (Token->Type != ESupertalkTokenType::Text)
 	{
-		ParseTokenError(InCtx, Token, ESupertalkTokenType::Text);
+		ParseTokenError(InCtx, *Token, ESupertalkTokenType::Text);
 		return false;
 	}
 
 	// Is there a better way to initialize an FText with a variable namespace/key? The FText constructor we want isn't
 	// accessible sadly, and double-constructing an FText (due to the FText::FromString call) seems inefficient.
-	Line.Text = FText::ChangeKey(FTextKey(Namespace), FTextKey(Key.IsEmpty() ? Token.GetGeneratedLocalizationKey() : Key), FText::FromString(Token.Content));
+	Line.Text = FText::ChangeKey(FTextKey(Namespace), FTextKey(Key.IsEmpty() ? Token->GetGeneratedLocalizationKey() : Key), FText::FromString(FString(Token->GetContent())));
+	Line.CompileFormat(InCtx.Script);
 
-	FToken NextToken = InCtx.Stream.PeekToken();
-	if (NextToken.Type == ESupertalkTokenType::Choice && NextToken.Indentation >= Token.Indentation)
+	const FToken& NextToken = InCtx.Stream.PeekToken();
+	if (NextToken.Type == ESupertalkTokenType::Choice && NextToken.Indentation >= Token->Indentation)
 	{
 		// Choice uses a different operation + params, so pass our line off to it.
 		return PaChoice(InCtx, OutAction, Line);
 	}
 
 	OutAction.Operation = ESupertalkOperation::Line;
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
 
 	USupertalkPlayLineParams* Params = NewObject<USupertalkPlayLineParams>(InCtx.Script);
 	Params->Line = Line;
@@ -1325,37 +1670,35 @@ bool FSupertalkParser::PaLine(FPaContext& InCtx, FSupertalkAction& OutAction)
 
 bool FSupertalkParser::PaChoice(FPaContext& InCtx, FSupertalkAction& OutAction, FSupertalkLine& Line)
 {
-	USupertalkPlayChoiceParams* Params = NewObject<USupertalkPlayChoiceParams>(InCtx.Script);
-	Params->Line = Line;
-	
-	FToken Token = InCtx.Stream.ReadToken();
-	check(Token.Type == ESupertalkTokenType::Choice);
-	while (Token.Type == ESupertalkTokenType::Choice)
+	TArray<FSupertalkChoice> Choices;
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	check(Token->Type == ESupertalkTokenType::Choice);
+	while (Token->Type == ESupertalkTokenType::Choice)
 	{
 		FSupertalkChoice Choice;
-		Token = InCtx.Stream.ReadToken();
+		Token = &InCtx.Stream.ReadToken();
 		FString Namespace = InCtx.DefaultNamespace;
 		FString Key;
-		if (Token.Type == ESupertalkTokenType::LocalizationKey)
+		if (Token->Type == ESupertalkTokenType::LocalizationKey)
 		{
-			if (!Token.Namespace.IsEmpty())
+			if (!Token->Namespace.IsEmpty())
 			{
-				Namespace = Token.Namespace;
+				Namespace = FString(Token->Namespace);
 			}
 
-			Key = Token.Content;
-			Token = InCtx.Stream.ReadToken();
+			Key = FString(Token->GetContent());
+			Token = &InCtx.Stream.ReadToken();
 		}
 
-		if (Token.Type != ESupertalkTokenType::Text)
+		if (Token->Type != ESupertalkTokenType::Text)
 		{
-			ParseTokenError(InCtx, Token, ESupertalkTokenType::Text);
+			ParseTokenError(InCtx, *Token, ESupertalkTokenType::Text);
 			return false;
 		}
 
-		Choice.Text = FText::ChangeKey(FTextKey(Namespace), FTextKey(Key.IsEmpty() ? Token.GetGeneratedLocalizationKey() : Key), FText::FromString(Token.Content));
+		Choice.Text = FText::ChangeKey(FTextKey(Namespace), FTextKey(Key.IsEmpty() ? Token->GetGeneratedLocalizationKey() : Key), FText::FromString(FString(Token->GetContent())));
 
-		if (InCtx.Stream.PeekToken().Indentation >= Token.Indentation)
+		if (InCtx.Stream.PeekToken().Indentation >= Token->Indentation)
 		{
 			if (!PaAction(InCtx, Choice.SubAction))
 			{
@@ -1367,14 +1710,22 @@ bool FSupertalkParser::PaChoice(FPaContext& InCtx, FSupertalkAction& OutAction,
 			Choice.SubAction.Operation = ESupertalkOperation::Noop;
 		}
 
-		Params->Choices.Add(Choice);
+		Choices.Add(Choice);
 
-		Token = InCtx.Stream.ReadToken();
+		Token = &InCtx.Stream.ReadToken();
 	}
 
 	InCtx.Stream.GoBack(1);
 
 	OutAction.Operation = ESupertalkOperation::Choice;
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
+	USupertalkPlayChoiceParams* Params = NewObject<USupertalkPlayChoiceParams>(InCtx.Script);
+	Params->Line = Line;
+	Params->Choices = MoveTemp(Choices);
 	OutAction.Params = Params;
 
 	return true;
@@ -1382,45 +1733,122 @@ bool FSupertalkParser::PaChoice(FPaContext& InCtx, FSupertalkAction& OutAction,
 
 bool FSupertalkParser::PaCommand(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken CommandToken = InCtx.Stream.ReadToken();
-	check(CommandToken.Type == ESupertalkTokenType::Command);
+	const FToken& CommandToken = InCtx.Stream.ReadToken();
+	check(CommandToken.Type == ESupertalkTokenType::Command || CommandToken.Type == ESupertalkTokenType::FunctionCall);
 	
 	OutAction.Operation = ESupertalkOperation::Call;
+
+	if (CommandToken.Type == ESupertalkTokenType::Command)
+	{
+		if (!InCtx.IsValidating())
+		{
+			USupertalkCallParams* Params = NewObject<USupertalkCallParams>(InCtx.Script);
+			Params->Arguments = FString(CommandToken.GetContent());
+			Params->CompileArguments(InCtx.Script);
+			OutAction.Params = Params;
+		}
+
+		return true;
+	}
+
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	if (Token->Type != ESupertalkTokenType::GroupStart)
+	{
+		ParseTokenError(InCtx, *Token, ESupertalkTokenType::GroupStart);
+		return false;
+	}
+
+	// Arguments keeps the call as written so that errors at runtime are still readable.
+	TArray<TObjectPtr<USupertalkExpression>> ArgumentExpressions;
+	FString Arguments = FString(CommandToken.GetContent()) + TEXT("(");
+	if (InCtx.Stream.PeekToken().Type == ESupertalkTokenType::GroupEnd)
+	{
+		InCtx.Stream.ReadToken();
+	}
+	else
+	{
+		while (true)
+		{
+			const int32 ArgumentStart = InCtx.Stream.CurrentToken;
+
+			TObjectPtr<USupertalkExpression> Expression;
+			if (!PaExpression(InCtx, Expression))
+			{
+				return false;
+			}
+
+			ArgumentExpressions.Add(Expression);
+
+			for (int32 Idx = ArgumentStart; Idx < InCtx.Stream.CurrentToken; ++Idx)
+			{
+				const FToken& ArgumentToken = *InCtx.Stream.Tokens[Idx];
+				const FStringView ArgumentContent = ArgumentToken.GetContent();
+				Arguments += ArgumentToken.Type == ESupertalkTokenType::Text
+					? FString::Printf(TEXT("\"%.*s\""), ArgumentContent.Len(), ArgumentContent.GetData())
+					: FString(ArgumentContent);
+			}
+
+			Token = &InCtx.Stream.ReadToken();
+			if (Token->Type == ESupertalkTokenType::GroupEnd)
+			{
+				break;
+			}
+			else if (Token->Type != ESupertalkTokenType::Separator)
+			{
+				ParseTokenError(InCtx, *Token, TEXT("Separator, GroupEnd"));
+				return false;
+			}
+
+			Arguments += TEXT(", ");
+		}
+	}
+
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
 	USupertalkCallParams* Params = NewObject<USupertalkCallParams>(InCtx.Script);
-	Params->Arguments = CommandToken.Content;
+	Params->bIsFunctionCall = true;
+	Params->FunctionName = FName(CommandToken.GetContent());
+	Params->ArgumentExpressions = MoveTemp(ArgumentExpressions);
+	Params->Arguments = Arguments + TEXT(")");
 	OutAction.Params = Params;
-	
 	return true;
 }
 
 bool FSupertalkParser::PaJump(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken Token = InCtx.Stream.ReadToken();
+	const FToken& Token = InCtx.Stream.ReadToken();
 	check(Token.Type == ESupertalkTokenType::Jump);
 
 	OutAction.Operation = ESupertalkOperation::Jump;
+	const FName JumpTarget(Token.GetContent());
+	InCtx.Jumps.Add(TTuple<const FToken*, FName>(&Token, JumpTarget));
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
 	USupertalkJumpParams* Params = NewObject<USupertalkJumpParams>(InCtx.Script);
-	Params->JumpTarget = FName(Token.Content);
+	Params->JumpTarget = JumpTarget;
 	OutAction.Params = Params;
 
-	InCtx.Jumps.Add(TTuple<FToken, FName>(Token, Params->JumpTarget));
-
 	return true;
 }
 
 bool FSupertalkParser::PaParallel(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken Token = InCtx.Stream.ReadToken();
-	check(Token.Type == ESupertalkTokenType::ParallelStart);
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	check(Token->Type == ESupertalkTokenType::ParallelStart);
 
 	OutAction.Operation = ESupertalkOperation::Parallel;
-	USupertalkParallelParams* Params = NewObject<USupertalkParallelParams>(InCtx.Script);
-	OutAction.Params = Params;
 
+	TArray<FSupertalkAction> SubActions;
 	while (!InCtx.Stream.IsEOF())
 	{
-		Token = InCtx.Stream.ReadToken();
-		if (Token.Type == ESupertalkTokenType::ParallelEnd)
+		Token = &InCtx.Stream.ReadToken();
+		if (Token->Type == ESupertalkTokenType::ParallelEnd)
 		{
 			break;
 		}
@@ -1433,31 +1861,39 @@ bool FSupertalkParser::PaParallel(FPaContext& InCtx, FSupertalkAction& OutAction
 			return false;
 		}
 
-		Params->SubActions.Add(SubAction);
+		SubActions.Add(SubAction);
 	}
 
-	if (Token.Type != ESupertalkTokenType::ParallelEnd)
+	if (Token->Type != ESupertalkTokenType::ParallelEnd)
 	{
-		ParseTokenError(InCtx, Token, ESupertalkTokenType::ParallelEnd);
+		ParseTokenError(InCtx, *Token, ESupertalkTokenType::ParallelEnd);
 		return false;
 	}
 
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
+	USupertalkParallelParams* Params = NewObject<USupertalkParallelParams>(InCtx.Script);
+	Params->SubActions = MoveTemp(SubActions);
+	OutAction.Params = Params;
+
 	return true;
 }
 
 bool FSupertalkParser::PaQueue(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken Token = InCtx.Stream.ReadToken();
-	check(Token.Type == ESupertalkTokenType::QueueStart);
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	check(Token->Type == ESupertalkTokenType::QueueStart);
 
 	OutAction.Operation = ESupertalkOperation::Queue;
-	USupertalkQueueParams* Params = NewObject<USupertalkQueueParams>(InCtx.Script);
-	OutAction.Params = Params;
 
+	TArray<FSupertalkAction> SubActions;
 	while (!InCtx.Stream.IsEOF())
 	{
-		Token = InCtx.Stream.ReadToken();
-		if (Token.Type == ESupertalkTokenType::QueueEnd)
+		Token = &InCtx.Stream.ReadToken();
+		if (Token->Type == ESupertalkTokenType::QueueEnd)
 		{
 			break;
 		}
@@ -1470,51 +1906,75 @@ bool FSupertalkParser::PaQueue(FPaContext& InCtx, FSupertalkAction& OutAction)
 			return false;
 		}
 
-		Params->SubActions.Add(SubAction);
+		SubActions.Add(SubAction);
 	}
 
-	if (Token.Type != ESupertalkTokenType::QueueEnd)
+	if (Token->Type != ESupertalkTokenType::QueueEnd)
 	{
-		ParseTokenError(InCtx, Token, ESupertalkTokenType::QueueEnd);
+		ParseTokenError(InCtx, *Token, ESupertalkTokenType::QueueEnd);
 		return false;
 	}
 
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
+	USupertalkQueueParams* Params = NewObject<USupertalkQueueParams>(InCtx.Script);
+	Params->SubActions = MoveTemp(SubActions);
+	OutAction.Params = Params;
+
 	return true;
 }
 
 bool FSupertalkParser::PaConditional(FPaContext& InCtx, FSupertalkAction& OutAction)
 {
-	FToken Token = InCtx.Stream.ReadToken();
-	check(Token.Type == ESupertalkTokenType::If);
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	check(Token->Type == ESupertalkTokenType::If);
 	
 	OutAction.Operation = ESupertalkOperation::Conditional;
-	USupertalkConditionalParams* Params = NewObject<USupertalkConditionalParams>(InCtx.Script);
-	OutAction.Params = Params;
 
-	if (!PaExpression(InCtx, Params->Expression))
+	TObjectPtr<USupertalkExpression> Expression;
+	if (!PaExpression(InCtx, Expression))
 	{
 		return false;
 	}
 
-	Token = InCtx.Stream.ReadToken();
-	if (Token.Type != ESupertalkTokenType::Then)
+	Token = &InCtx.Stream.ReadToken();
+	if (Token->Type != ESupertalkTokenType::Then)
 	{
-		ParseTokenError(InCtx, Token, ESupertalkTokenType::Then);
+		ParseTokenError(InCtx, *Token, ESupertalkTokenType::Then);
 		return false;
 	}
 
-	if (!PaAction(InCtx, Params->TrueAction))
+	FSupertalkAction TrueAction;
+	if (!PaAction(InCtx, TrueAction))
 	{
 		return false;
 	}
 
-	Token = InCtx.Stream.PeekToken();
-	if (Token.Type == ESupertalkTokenType::Else)
+	FSupertalkAction FalseAction;
+	Token = &InCtx.Stream.PeekToken();
+	if (Token->Type == ESupertalkTokenType::Else)
 	{
 		InCtx.Stream.ReadToken();
-		return PaAction(InCtx, Params->FalseAction);
+		if (!PaAction(InCtx, FalseAction))
+		{
+			return false;
+		}
+	}
+
+	if (InCtx.IsValidating())
+	{
+		return true;
 	}
 
+	USupertalkConditionalParams* Params = NewObject<USupertalkConditionalParams>(InCtx.Script);
+	Params->Expression = Expression;
+	Params->TrueAction = MoveTemp(TrueAction);
+	Params->FalseAction = MoveTemp(FalseAction);
+	OutAction.Params = Params;
+
 	return true;
 }
 
@@ -1528,7 +1988,7 @@ bool FSupertalkParser::PaEqualityExpression(FPaContext& InCtx, TObjectPtr<USuper
 	TArray<TObjectPtr<USupertalkExpression>> Expressions;
 	TArray<ESupertalkExpression_Equality_Operation> Operations;
 	TObjectPtr<USupertalkExpression> Expr;
-	FToken Token;
+	const FToken* Token = nullptr;
 	do
 	{
 		if (!PaUnaryExpression(InCtx, Expr))
@@ -1537,10 +1997,10 @@ bool FSupertalkParser::PaEqualityExpression(FPaContext& InCtx, TObjectPtr<USuper
 		}
 
 		Expressions.Add(Expr);
-		Token = InCtx.Stream.ReadToken();
-		Operations.Add(Token.Type == ESupertalkTokenType::Equal ? ESupertalkExpression_Equality_Operation::Equal : ESupertalkExpression_Equality_Operation::NotEqual);
+		Token = &InCtx.Stream.ReadToken();
+		Operations.Add(Token->Type == ESupertalkTokenType::Equal ? ESupertalkExpression_Equality_Operation::Equal : ESupertalkExpression_Equality_Operation::NotEqual);
 	}
-	while (Token.Type == ESupertalkTokenType::Equal || Token.Type == ESupertalkTokenType::NotEqual);
+	while (Token->Type == ESupertalkTokenType::Equal || Token->Type == ESupertalkTokenType::NotEqual);
 	InCtx.Stream.GoBack(1);
 	Operations.RemoveAt(Operations.Num() - 1);
 
@@ -1555,6 +2015,11 @@ bool FSupertalkParser::PaEqualityExpression(FPaContext& InCtx, TObjectPtr<USuper
 		return true;
 	}
 
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
 	USupertalkExpression_Equality* Equality = NewObject<USupertalkExpression_Equality>(InCtx.Script);
 	Equality->SubExpressions = Expressions;
 	Equality->Operations = Operations;
@@ -1565,24 +2030,37 @@ bool FSupertalkParser::PaEqualityExpression(FPaContext& InCtx, TObjectPtr<USuper
 
 bool FSupertalkParser::PaUnaryExpression(FPaContext& InCtx, TObjectPtr<USupertalkExpression>& OutExpression)
 {
-	FToken Token = InCtx.Stream.PeekToken();
+	const FToken& Token = InCtx.Stream.PeekToken();
 	switch (Token.Type)
 	{
 	default:
 		return PaGroupExpression(InCtx, OutExpression);
 
 	case ESupertalkTokenType::Not:
-		InCtx.Stream.ReadToken();
-		USupertalkExpression_Not* Unary = NewObject<USupertalkExpression_Not>(InCtx.Script);
-		OutExpression = Unary;
-		return PaUnaryExpression(InCtx, Unary->Value);
+		{
+			InCtx.Stream.ReadToken();
+			TObjectPtr<USupertalkExpression> Value;
+			if (!PaUnaryExpression(InCtx, Value))
+			{
+				return false;
+			}
+
+			if (!InCtx.IsValidating())
+			{
+				USupertalkExpression_Not* Unary = NewObject<USupertalkExpression_Not>(InCtx.Script);
+				Unary->Value = Value;
+				OutExpression = Unary;
+			}
+
+			return true;
+		}
 	}
 }
 
 bool FSupertalkParser::PaGroupExpression(FPaContext& InCtx, TObjectPtr<USupertalkExpression>& OutExpression)
 {
-	FToken Token = InCtx.Stream.PeekToken();
-	if (Token.Type == ESupertalkTokenType::GroupStart)
+	const FToken* Token = &InCtx.Stream.PeekToken();
+	if (Token->Type == ESupertalkTokenType::GroupStart)
 	{
 		InCtx.Stream.ReadToken();
 		if (!PaExpression(InCtx, OutExpression))
@@ -1590,10 +2068,10 @@ bool FSupertalkParser::PaGroupExpression(FPaContext& InCtx, TObjectPtr<USupertal
 			return false;
 		}
 
-		Token = InCtx.Stream.ReadToken();
-		if (Token.Type != ESupertalkTokenType::GroupEnd)
+		Token = &InCtx.Stream.ReadToken();
+		if (Token->Type != ESupertalkTokenType::GroupEnd)
 		{
-			ParseTokenError(InCtx, Token, ESupertalkTokenType::GroupEnd);
+			ParseTokenError(InCtx, *Token, ESupertalkTokenType::GroupEnd);
 			return false;
 		}
 	}
@@ -1609,6 +2087,11 @@ bool FSupertalkParser::PaValueExpression(FPaContext& InCtx, TObjectPtr<USupertal
 		return false;
 	}
 
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
+
 	USupertalkExpression_Value* Expr = NewObject<USupertalkExpression_Value>(InCtx.Script);
 	Expr->Value = Value;
 
@@ -1618,7 +2101,7 @@ bool FSupertalkParser::PaValueExpression(FPaContext& InCtx, TObjectPtr<USupertal
 
 bool FSupertalkParser::PaValue(FPaContext& InCtx, TObjectPtr<USupertalkValue>& OutValue)
 {
-	FToken Token = InCtx.Stream.PeekToken();
+	const FToken& Token = InCtx.Stream.PeekToken();
 	switch (Token.Type)
 	{
 	default:
@@ -1639,13 +2122,13 @@ bool FSupertalkParser::PaValue(FPaContext& InCtx, TObjectPtr<USupertalkValue>& O
 
 bool FSupertalkParser::PaVariableValue(FPaContext& InCtx, TObjectPtr<USupertalkValue>& OutValue)
 {
-	FToken Token = InCtx.Stream.ReadToken();
-	check(Token.Type == ESupertalkTokenType::Name);
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	check(Token->Type == ESupertalkTokenType::Name);
 
-	FName VarName = FName(Token.Content);
+	FName VarName = FName(Token->GetContent());
 	if (IsReservedName(VarName))
 	{
-		if (VarName == NAME_None)
+		if (VarName == NAME_None || InCtx.IsValidating())
 		{
 			OutValue = nullptr;
 			return true;
@@ -1668,36 +2151,75 @@ bool FSupertalkParser::PaVariableValue(FPaContext& InCtx, TObjectPtr<USupertalkV
 		}
 
 		checkNoEntry();
-		ParseTokenError(InCtx, Token, TEXT("Unknown (reserved name found but not implemented)"));
+		ParseTokenError(InCtx, *Token, TEXT("Unknown (reserved name found but not implemented)"));
 		return false;
 	}
-	else if (InCtx.Stream.PeekToken().Type == ESupertalkTokenType::Member)
+	else if (IsNumeric(Token->GetContent()))
 	{
-		USupertalkMemberValue* Member = NewObject<USupertalkMemberValue>(InCtx.Script);
-		Member->Variable = VarName;
+		// The member symbol doubles as a decimal point, so `1.5` arrives as three tokens.
+		FString Number(Token->GetContent());
+		if (InCtx.Stream.PeekToken().Type == ESupertalkTokenType::Member)
+		{
+			InCtx.Stream.ReadToken();
+			Token = &InCtx.Stream.ReadToken();
+			if (Token->Type != ESupertalkTokenType::Name || !IsNumeric(Token->GetContent()))
+			{
+				ParseTokenError(InCtx, *Token, TEXT("Number"));
+				return false;
+			}
+
+			Number += TEXT(".") + FString(Token->GetContent());
+		}
 
+		if (InCtx.IsValidating())
+		{
+			return true;
+		}
+
+		USupertalkNumberValue* NumberValue = NewObject<USupertalkNumberValue>(InCtx.Script);
+		NumberValue->Number = FCString::Atod(*Number);
+		OutValue = NumberValue;
+		return true;
+	}
+	else if (InCtx.Stream.PeekToken().Type == ESupertalkTokenType::Member)
+	{
+		TArray<FName> Members;
 		while (!InCtx.Stream.IsEOF() && InCtx.Stream.PeekToken().Type == ESupertalkTokenType::Member)
 		{
-			Token = InCtx.Stream.ReadToken();
-			check(Token.Type == ESupertalkTokenType::Member);
+			Token = &InCtx.Stream.ReadToken();
+			check(Token->Type == ESupertalkTokenType::Member);
 
-			Token = InCtx.Stream.ReadToken();
-			if (Token.Type != ESupertalkTokenType::Name)
+			Token = &InCtx.Stream.ReadToken();
+			if (Token->Type != ESupertalkTokenType::Name)
 			{
-				ParseTokenError(InCtx, Token, ESupertalkTokenType::Name);
+				ParseTokenError(InCtx, *Token, ESupertalkTokenType::Name);
 				return false;
 			}
 
-			Member->Members.Add(FName(Token.Content));
+			Members.Add(FName(Token->GetContent()));
+		}
+
+		if (InCtx.IsValidating())
+		{
+			return true;
 		}
 
+		USupertalkMemberValue* Member = NewObject<USupertalkMemberValue>(InCtx.Script);
+		Member->Variable = VarName;
+		Member->VariableSlot = InCtx.Script->Variables.AddUnique(VarName);
+		Member->Members = MoveTemp(Members);
 		OutValue = Member;
 		return true;
 	}
+	else if (InCtx.IsValidating())
+	{
+		return true;
+	}
 	else
 	{
 		USupertalkVariableValue* Variable = NewObject<USupertalkVariableValue>(InCtx.Script);
 		Variable->Variable = VarName;
+		Variable->VariableSlot = InCtx.Script->Variables.AddUnique(VarName);
 		OutValue = Variable;
 		return true;
 	}
@@ -1705,69 +2227,78 @@ bool FSupertalkParser::PaVariableValue(FPaContext& InCtx, TObjectPtr<USupertalkV
 
 bool FSupertalkParser::PaTextValue(FPaContext& InCtx, TObjectPtr<USupertalkValue>& OutValue)
 {
-	FToken Token = InCtx.Stream.ReadToken();
+	const FToken* Token = &InCtx.Stream.ReadToken();
 	FString Namespace = InCtx.DefaultNamespace;
 	FString Key;
-	if (Token.Type == ESupertalkTokenType::LocalizationKey)
+	if (Token->Type == ESupertalkTokenType::LocalizationKey)
 	{
-		if (!Token.Namespace.IsEmpty())
+		if (!Token->Namespace.IsEmpty())
 		{
-			Namespace = Token.Namespace;
+			Namespace = FString(Token->Namespace);
 		}
 
-		Key = Token.Content;
+		Key = FString(Token->GetContent());
 
-		Token = InCtx.Stream.ReadToken();
+		Token = &InCtx.Stream.ReadToken();
 	}
 	
-	check(Token.Type == ESupertalkTokenType::Text);
+	check(Token->Type == ESupertalkTokenType::Text);
+	if (InCtx.IsValidating())
+	{
+		return true;
+	}
 
 	USupertalkTextValue* Text = NewObject<USupertalkTextValue>(InCtx.Script);
-	Text->Text = FText::ChangeKey(FTextKey(Namespace), FTextKey(Key.IsEmpty() ? Token.GetGeneratedLocalizationKey() : Key), FText::FromString(Token.Content));
+	Text->Text = FText::ChangeKey(FTextKey(Namespace), FTextKey(Key.IsEmpty() ? Token->GetGeneratedLocalizationKey() : Key), FText::FromString(FString(Token->GetContent())));
 	OutValue = Text;
 	return true;
 }
 
 bool FSupertalkParser::PaAssetValue(FPaContext& InCtx, TObjectPtr<USupertalkValue>& OutValue)
 {
-	FToken Token = InCtx.Stream.ReadToken();
+	const FToken& Token = InCtx.Stream.ReadToken();
 	check(Token.Type == ESupertalkTokenType::Asset);
 
-	UObject* Asset = LoadObject<UObject>(nullptr, *Token.Content);
-	//UObject* Asset = FindObject<UObject>(nullptr, *Token.Content, false);
-	if (Asset == nullptr)
+	// Assets are only looked up, not loaded. They're loaded when the script runs, see USupertalkSoftObjectValue.
+	FSoftObjectPath AssetPath;
+	if (!FindAssetPath(Token.GetContent(), AssetPath))
+	{
+		ParseWarning(InCtx, Token, FString::Format(TEXT("Failed to find asset '{0}'"), { FString(Token.GetContent()) }));
+		return true;
+	}
+
+	if (InCtx.IsValidating())
 	{
-		ParseWarning(InCtx, Token, FString::Format(TEXT("Failed to find asset '{0}'"), { Token.Content }));
 		return true;
 	}
 	
-	USupertalkObjectValue* Value = NewObject<USupertalkObjectValue>(InCtx.Script);
-	Value->Object = Asset;
+	USupertalkSoftObjectValue* Value = NewObject<USupertalkSoftObjectValue>(InCtx.Script);
+	Value->Object = TSoftObjectPtr<UObject>(AssetPath);
 	OutValue = Value;
 	return true;
 }
 
 bool FSupertalkParser::PaAttributeList(FPaContext& InCtx, TArray<FSupertalkAttribute>& OutAttributes)
 {
-	FToken Token = InCtx.Stream.ReadToken();
-	check(Token.Type == ESupertalkTokenType::AttrStart);
+	const FToken* Token = &InCtx.Stream.ReadToken();
+	check(Token->Type == ESupertalkTokenType::AttrStart);
 
 	while (!InCtx.Stream.IsEOF())
 	{
-		Token = InCtx.Stream.ReadToken();
-		if (Token.Type != ESupertalkTokenType::Name)
+		Token = &InCtx.Stream.ReadToken();
+		if (Token->Type != ESupertalkTokenType::Name)
 		{
-			ParseTokenError(InCtx, Token, ESupertalkTokenType::Name);
+			ParseTokenError(InCtx, *Token, ESupertalkTokenType::Name);
 			return false;
 		}
 
 		FSupertalkAttribute Attr;
-		Attr.Name = FName(Token.Content);
+		Attr.Name = FName(Token->GetContent());
 
 		OutAttributes.Add(Attr);
 
-		Token = InCtx.Stream.ReadToken();
-		switch (Token.Type)
+		Token = &InCtx.Stream.ReadToken();
+		switch (Token->Type)
 		{
 		default:
 			InCtx.Stream.GoBack(1);
@@ -1782,9 +2313,9 @@ bool FSupertalkParser::PaAttributeList(FPaContext& InCtx, TArray<FSupertalkAttri
 	}
 
 complete:
-	if (Token.Type != ESupertalkTokenType::AttrEnd)
+	if (Token->Type != ESupertalkTokenType::AttrEnd)
 	{
-		ParseTokenError(InCtx, Token, ESupertalkTokenType::AttrEnd);
+		ParseTokenError(InCtx, *Token, ESupertalkTokenType::AttrEnd);
 		return false;
 	}
 
@@ -3,6 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Containers/StringView.h"
+#include "SupertalkCharScan.h"
 #include "Supertalk/SupertalkExpression.h"
 #include "Supertalk/SupertalkLine.h"
 #include "SupertalkParser.generated.h"
@@ -10,6 +12,7 @@
 class USupertalkScript;
 class USupertalkValue;
 struct FSupertalkAction;
+struct FSupertalkSection;
 
 UENUM()
 enum class ESupertalkTokenType : uint8
@@ -43,6 +46,7 @@ enum class ESupertalkTokenType : uint8
 	Equal,
 	NotEqual,
 	Not,
+	FunctionCall,
 
 	AttrStart = ParallelStart,
 	AttrEnd = ParallelEnd
@@ -58,8 +62,16 @@ public:
 	static TSharedRef<FSupertalkParser> Create(FOutputDevice* Ar);
 	static bool ParseIntoScript(FString File, FString Input, class USupertalkScript* Script, FOutputDevice* Ar);
 
+	// Lexes and parses Input without creating a script or loading assets, so that it can run on any thread. The lines (starting
+	// at 1) that errors and warnings were reported on are added to OutDiagnosticLines.
+	static bool ValidateScript(const FString& File, const FString& Input, FOutputDevice* Ar, TArray<int32>* OutDiagnosticLines = nullptr);
+
 	static bool IsReservedName(FName Input);
 
+	// Splits Input into lines on \r\n, \r and \n the same way FString::ParseIntoArrayLines does when it keeps empty lines,
+	// but without copying anything.
+	static void SplitLines(FStringView Input, TArray<FStringView>& OutLines, FSupertalkCharScan::EMode CharScanMode = FSupertalkCharScan::EMode::Vectorized);
+
 public:
 	enum class ETextParseMode : uint8
 	{
@@ -70,7 +82,7 @@ public:
 
 	struct FTokenContext
 	{
-		FString File;
+		FStringView File;
 		int32 Line = -1;
 		int32 Col = -1;
 
@@ -82,14 +94,34 @@ public:
 		FString ToString() const;
 	};
 
+	// Tokens are views into the file name and input that they were lexed from, and can't outlive either of them.
 	struct FToken
 	{
 		FTokenContext Context;
 		ESupertalkTokenType Type = ESupertalkTokenType::Unknown;
-		FString Content;
-		FString Source;
-		FString Namespace;
-		int32 Indentation;
+
+		// Everything the lexer consumed for this token, including any whitespace or empty lines skipped before it.
+		FStringView Source;
+		FStringView Namespace;
+		int32 Indentation = 0;
+
+		// The part of the token that matters to the parser, e.g. a name without the whitespace around it or text without its quotes.
+		FStringView GetContent() const
+		{
+			return JoinedContent.IsEmpty() ? Content : FStringView(JoinedContent);
+		}
+
+		void SetContent(FStringView InContent)
+		{
+			Content = InContent;
+			JoinedContent.Empty();
+		}
+
+		void SetContent(FString&& InContent)
+		{
+			Content = FStringView();
+			JoinedContent = MoveTemp(InContent);
+		}
 
 		FString GetDisplayName() const;
 
@@ -100,8 +132,14 @@ public:
 		static bool IsPotentialLoop(const FToken& Lhs, const FToken& Rhs)
 		{
 			// Used to test if the same token is being emitted over and over again.
-			return Lhs.Context == Rhs.Context && Lhs.Type == Rhs.Type && Lhs.Content == Rhs.Content;
+			return Lhs.Context == Rhs.Context && Lhs.Type == Rhs.Type && Lhs.GetContent() == Rhs.GetContent();
 		}
+
+	private:
+		FStringView Content;
+
+		// Text that carries on over several lines has to be joined back together, so it can't be a view into the input.
+		FString JoinedContent;
 	};
 
 	struct FLxStream
@@ -112,19 +150,39 @@ public:
 			CurrentChar = 0;
 		}
 		
-		TArray<FString> Lines;
+		FStringView Input;
+		TArray<FStringView> Lines;
 		int32 CurrentLine;
 		int32 CurrentChar;
+		FSupertalkCharScan::EMode CharScanMode = FSupertalkCharScan::EMode::Vectorized;
 
 		FORCEINLINE bool IsEOF() const
 		{
 			return !Lines.IsValidIndex(CurrentLine);
 		}
 
+		// Grows Span to also cover the character that ReadChar just returned, unless that was the end of a line or the file.
+		// Characters have to be read one after another from the same line.
+		FORCEINLINE void ExtendSpan(FStringView& Span) const
+		{
+			if (IsEOF() || CurrentChar == 0)
+			{
+				return;
+			}
+
+			const TCHAR* Char = Lines[CurrentLine].GetData() + CurrentChar - 1;
+			Span = Span.IsEmpty() ? FStringView(Char, 1) : FStringView(Span.GetData(), UE_PTRDIFF_TO_INT32(Char - Span.GetData()) + 1);
+		}
+
 		TCHAR ReadChar();
-		FString ReadToEndOfLine();
-		FString ReadToEndOfFile();
-		FString ReadBetweenContexts(const FTokenContext& Left, const FTokenContext& Right);
+
+		// Reads up to the next A or B on the current line, or to the end of it, and grows Span to cover what was read.
+		void ReadUntilAnyOf(FStringView& Span, TCHAR A, TCHAR B);
+
+		FStringView ReadToEndOfLine();
+		FStringView ReadToEndOfFile();
+		FStringView ReadBetweenContexts(const FTokenContext& Left, const FTokenContext& Right) const;
+		int32 GetOffset(const FTokenContext& Context) const;
 
 		void GoBack(int32 Count);
 
@@ -133,7 +191,7 @@ public:
 
 	struct FLxContext
 	{
-		FString File;
+		FStringView File;
 		FLxStream Stream;
 		int32 CurrentIndentation;
 
@@ -160,18 +218,22 @@ public:
 		FPaStream()
 		{
 			CurrentToken = 0;
+			EofToken.Type = ESupertalkTokenType::Eof;
+			EofToken.Indentation = INDEX_NONE; // so that nothing is ever considered nested under the end of the file
 		}
 		
-		TArray<FToken> Tokens;
+		// Points into the token array given to RunParser, which outlives the stream.
+		TArray<const FToken*> Tokens;
 		int32 CurrentToken;
+		FToken EofToken;
 
 		FORCEINLINE bool IsEOF() const
 		{
 			return !Tokens.IsValidIndex(CurrentToken);
 		}
 
-		FToken ReadToken();
-		FToken PeekToken() const;
+		const FToken& ReadToken();
+		const FToken& PeekToken() const;
 		void GoBack(int32 Count);
 	};
 
@@ -179,29 +241,61 @@ public:
 	{
 		FPaStream Stream;
 
+		// Null when only validating, in which case nothing is created.
 		USupertalkScript* Script;
 
 		FString DefaultNamespace;
 
 		// Used for checking that all jumps are valid later.
-		TArray<TTuple<FToken, FName>> Jumps;
+		TArray<TTuple<const FToken*, FName>> Jumps;
+		TSet<FName> SectionNames;
+
+		// Sections marked with the entry directive, checked like jumps.
+		TArray<TTuple<const FToken*, FName>> EntrySections;
+
+		// None in the implicit first section.
+		FName CurrentSection;
+
+		FORCEINLINE bool IsValidating() const
+		{
+			return Script == nullptr;
+		}
 	};
 
 public:
 	~FSupertalkParser();
 
 	bool Parse(const FString& File, const FString& Input, USupertalkScript* Script);
+	bool Validate(const FString& File, const FString& Input);
+
+	// Same as above, but keeps the tokens so that they can be parsed into a script later with ParseTokens, on the game
+	// thread. The tokens are views into File and Input, see FToken.
+	bool Validate(const FString& File, const FString& Input, TArray<FToken>& OutTokens);
+	bool ParseTokens(const FString& File, const TArray<FToken>& Tokens, USupertalkScript* Script);
+
+	// The lines (starting at 1) that errors and warnings were reported on by the last Parse or Validate.
+	const TArray<int32>& GetDiagnosticLines() const { return DiagnosticLines; }
+
+	// The tokens are views into File and Input, see FToken.
 	bool TokenizeSyntax(const FString& File, const FString& Input, TArray<FToken>& OutTokens);
 
+	// Same as above, but starts from StartLine, which has to be a line that lexing can restart from. Those are lines where
+	// a token starts right at the beginning with nothing carried over from the line before. ShouldStopAtLine is called
+	// with each of them as they are reached, and lexing stops before the token on that line if it returns true.
+	bool TokenizeSyntax(const FString& File, const FString& Input, int32 StartLine, TFunctionRef<bool(int32 Line)> ShouldStopAtLine, TArray<FToken>& OutTokens);
+
 	//void RunTest();
 
 private:
+	friend class USupertalkParserBenchmarkCommandlet;
+
 	FSupertalkParser();
 	void Initialize();
 
 	// If bIgnoreErrors is true, attempts to ignore any problems with lexing.
 	// If an error can't be ignored, the rest of the input will be appended as a final "unknown" token.
 	bool RunLexer(const FString& File, const FString& Input, TArray<FToken>& OutTokens, bool bIgnoreErrors = false);
+	bool RunLexer(const FString& File, const FString& Input, int32 StartLine, TFunctionRef<bool(int32 Line)> ShouldStopAtLine, TArray<FToken>& OutTokens, bool bIgnoreErrors);
 	bool RunParser(USupertalkScript* Script, const TArray<FToken>& InTokens);
 
 	void ConsumeEmptyLines(FLxContext& InCtx);
@@ -211,21 +305,22 @@ private:
 	bool LxToken(FLxContext& InCtx, FToken& OutToken);
 
 	bool LxTokenName(FLxContext& InCtx, FToken& OutName, bool AllowWhitespace);
+	bool LxTokenFunctionCall(FLxContext& InCtx, FToken& OutFunctionCall);
 	bool LxTokenText(FLxContext& InCtx, FToken& OutText, ETextParseMode Mode);
 	bool LxTokenAsset(FLxContext& InCtx, FToken& OutAsset);
 	bool LxTokenComment(FLxContext& InCtx, FToken& OutComment);
 	bool LxTokenDirective(FLxContext& InCtx, FToken& OutDirective);
 	bool LxTokenLocalizationKey(FLxContext& InCtx, FToken& OutLocalizationKey);
 
-	void ParseTokenError(const FPaContext& InCtx, const FToken& Token, ESupertalkTokenType ExpectedTokenType) const;
-	void ParseTokenError(const FPaContext& InCtx, const FToken& Token, const FString& Expected) const;
-	void ParseError(const FPaContext& InCtx, const FToken& Token, const FString& Message) const;
-	void ParseError(const FPaContext& InCtx, const FString& Message) const;
-	void ParseWarning(const FPaContext& InCtx, const FToken& Token, const FString& Message) const;
-	void ParseWarning(const FPaContext& InCtx, const FString& Message) const;
+	void ParseTokenError(const FPaContext& InCtx, const FToken& Token, ESupertalkTokenType ExpectedTokenType);
+	void ParseTokenError(const FPaContext& InCtx, const FToken& Token, const FString& Expected);
+	void ParseError(const FPaContext& InCtx, const FToken& Token, const FString& Message);
+	void ParseError(const FPaContext& InCtx, const FString& Message);
+	void ParseWarning(const FPaContext& InCtx, const FToken& Token, const FString& Message);
+	void ParseWarning(const FPaContext& InCtx, const FString& Message);
 
 	bool PaTrySectionName(FPaContext& InCtx, FName& OutName);
-	bool PaSection(FPaContext& InCtx, FName Name);
+	bool PaSection(FPaContext& InCtx, FSupertalkSection& OutSection);
 	
 	bool PaAction(FPaContext& InCtx, FSupertalkAction& OutAction);
 	
@@ -254,4 +349,8 @@ private:
 	bool PaAttributeList(FPaContext& InCtx, TArray<FSupertalkAttribute>& OutAttributes);
 
 	FOutputDevice* Ar = nullptr;
+	TArray<int32> DiagnosticLines;
+
+	// Only changed by the parser benchmark. Each parser has its own so that lexing on other threads isn't affected.
+	FSupertalkCharScan::EMode CharScanMode = FSupertalkCharScan::EMode::Vectorized;
 };
\ No newline at end of file
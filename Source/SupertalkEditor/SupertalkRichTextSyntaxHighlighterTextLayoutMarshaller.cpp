@@ -5,6 +5,8 @@
 #include "SupertalkParser.h"
 #include "Framework/Text/ISlateRun.h"
 #include "Framework/Text/SlateTextRun.h"
+#include "Framework/Text/SlateTextUnderlineLineHighlighter.h"
+#include "Algo/BinarySearch.h"
 
 #define GET_TEXT_STYLE(Name) FSupertalkEditorStyle::Get().GetWidgetStyle<FTextBlockStyle>(Name)
 FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::FSyntaxTextStyle::FSyntaxTextStyle()
@@ -41,135 +43,348 @@ bool FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::RequiresLiveUpdate
 	return true;
 }
 
+void FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::SetDiagnosticLines(const TArray<int32>& InDiagnosticLines)
+{
+	TSet<int32> NewDiagnosticLines;
+	for (int32 Line : InDiagnosticLines)
+	{
+		NewDiagnosticLines.Add(Line - 1);
+	}
+
+	if (NewDiagnosticLines.Num() == DiagnosticLines.Num() && NewDiagnosticLines.Includes(DiagnosticLines))
+	{
+		return;
+	}
+
+	DiagnosticLines = MoveTemp(NewDiagnosticLines);
+	MakeDirty();
+}
+
 FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller(TSharedRef<class FSupertalkParser> InParser, const FSyntaxTextStyle& InSyntaxTextStyle)
-	: SyntaxTextStyle(InSyntaxTextStyle), Parser(InParser)
+	: SyntaxTextStyle(InSyntaxTextStyle)
+	, Parser(InParser)
+	, DiagnosticHighlighter(FSlateTextUnderlineLineHighlighter::Create(
+		*FSupertalkEditorStyle::Get().GetBrush("SyntaxHighlight.STS.DiagnosticUnderline"),
+		InSyntaxTextStyle.ErrorTextStyle.Font,
+		InSyntaxTextStyle.ErrorTextStyle.ColorAndOpacity,
+		InSyntaxTextStyle.ErrorTextStyle.ShadowOffset,
+		InSyntaxTextStyle.ErrorTextStyle.ShadowColorAndOpacity))
 {
 }
 
 void FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::ParseTokens(const FString& SourceString, FTextLayout& TargetTextLayout)
 {
-	// This entire function is *beyond* hacky, as the supertalk parser tokenizes things into a different format than what FTextLayout works with.
-	// It might be worth refactoring FSupertalkParser to use ranges or something at some point, but for now this is "good enough".
+	// The text layout is cleared and given the whole script again on every edit, so only the lines around the edit are
+	// lexed again. Everything else is handed back as it was last time.
+	TArray<FStringView> Lines;
+	FSupertalkParser::SplitLines(SourceString, Lines);
+	if (Lines.IsEmpty())
+	{
+		// The text layout needs a line to put the cursor on.
+		Lines.Emplace(*SourceString, 0);
+	}
 
-	TArray<FSupertalkParser::FToken> Tokens;
-	Parser->TokenizeSyntax(FString("Input"), SourceString, Tokens);
+	const int32 NumLines = Lines.Num();
+	const int32 NumOldLines = HighlightedLines.Num();
 
-	TArray<FTextLayout::FNewLineData> LinesToAdd;
-	TSharedRef<FString> ModelString = MakeShared<FString>();
-	TArray<TSharedRef<IRun>> Runs;
-	for (const FSupertalkParser::FToken& Token : Tokens)
+	int32 NumSameLeading = 0;
+	while (NumSameLeading < NumLines && NumSameLeading < NumOldLines
+		&& Lines[NumSameLeading].Equals(HighlightedLines[NumSameLeading].Text, ESearchCase::CaseSensitive))
 	{
-		TArray<FString> Lines;
-		Token.Source.ParseIntoArrayLines(Lines, false);
+		++NumSameLeading;
+	}
 
-		for (int32 LineIdx = 0; LineIdx < Lines.Num(); ++LineIdx)
+	int32 NumSameTrailing = 0;
+	while (NumSameTrailing < NumLines - NumSameLeading && NumSameTrailing < NumOldLines - NumSameLeading
+		&& Lines[NumLines - 1 - NumSameTrailing].Equals(HighlightedLines[NumOldLines - 1 - NumSameTrailing].Text, ESearchCase::CaseSensitive))
+	{
+		++NumSameTrailing;
+	}
+
+	TArray<FHighlightedLine> OldLines = MoveTemp(HighlightedLines);
+	HighlightedLines.SetNum(NumLines);
+
+	// Maps a line that didn't change to where it was last time.
+	const int32 FirstSameTrailing = NumLines - NumSameTrailing;
+	const int32 LineDelta = NumLines - NumOldLines;
+	auto GetOldLine = [&](int32 Line)
+	{
+		return Line < NumSameLeading ? Line : (Line >= FirstSameTrailing ? Line - LineDelta : INDEX_NONE);
+	};
+
+	int32 LexStart = NumLines;
+	int32 LexEnd = NumLines;
+	if (NumSameLeading != NumLines || NumLines != NumOldLines)
+	{
+		// The token that ended on a restart point may have read into the line after it to decide that, so that line has
+		// to be before the edit as well.
+		LexStart = 0;
+		for (int32 Line = NumSameLeading - 2; Line > 0; --Line)
 		{
-			if (LineIdx != 0)
+			if (OldLines[Line].bCanRestartLexing)
 			{
-				LinesToAdd.Emplace(ModelString, Runs);
-				ModelString = MakeShared<FString>();
-				Runs = TArray<TSharedRef<IRun>>();
+				LexStart = Line;
+				break;
 			}
+		}
 
-			FRunInfo RunInfo;
-			RunInfo.Name = TEXT("SyntaxHighlight.STS.Normal");
+		// Lexing from a restart point only depends on what comes after it, so once the lexer reaches one past the edit
+		// that was also a restart point last time, the rest of the script would come out the same as before.
+		const FString File = TEXT("Input");
+		TArray<FSupertalkParser::FToken> Tokens;
+		Parser->TokenizeSyntax(File, SourceString, LexStart, [&](int32 Line)
+		{
+			if (Line > LexStart && Line >= FirstSameTrailing && OldLines[Line - LineDelta].bCanRestartLexing)
+			{
+				LexEnd = Line;
+				return true;
+			}
 
-			FTextBlockStyle TextBlockStyle = SyntaxTextStyle.NormalTextStyle;
+			HighlightedLines[Line].bCanRestartLexing = true;
+			return false;
+		}, Tokens);
 
-			switch (Token.Type)
-			{
-			case ESupertalkTokenType::Comment:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Comment");
-				TextBlockStyle = SyntaxTextStyle.CommentTextStyle;
-				break;
+		HighlightedLines[LexStart].bCanRestartLexing = true;
 
-			case ESupertalkTokenType::If:
-			case ESupertalkTokenType::Then:
-			case ESupertalkTokenType::Else:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Keyword");
-				TextBlockStyle = SyntaxTextStyle.KeywordTextStyle;
-				break;
+		TArray<int32> LineStarts;
+		LineStarts.Reserve(NumLines);
+		for (const FStringView& Line : Lines)
+		{
+			LineStarts.Add(UE_PTRDIFF_TO_INT32(Line.GetData() - *SourceString));
+		}
+
+		// Tokens can span several lines, their source includes the whitespace and line breaks before them.
+		for (const FSupertalkParser::FToken& Token : Tokens)
+		{
+			if (Token.Source.IsEmpty())
+			{
+				continue;
+			}
 
+			const ESyntaxStyle Style = GetSyntaxStyle(Token.Type, Token.GetContent());
+			const int32 Begin = UE_PTRDIFF_TO_INT32(Token.Source.GetData() - *SourceString);
+			const int32 End = Begin + Token.Source.Len();
 
-			case ESupertalkTokenType::Directive:
-				if (Token.Content.StartsWith("error", ESearchCase::IgnoreCase))
-				{
-					RunInfo.Name = TEXT("SyntaxHighlight.STS.Error");
-					TextBlockStyle = SyntaxTextStyle.ErrorTextStyle;
-				}
-				else
+			for (int32 Line = FMath::Max(Algo::UpperBound(LineStarts, Begin) - 1, LexStart); Line < LexEnd && LineStarts[Line] < End; ++Line)
+			{
+				TArray<FStyledSpan>& Spans = HighlightedLines[Line].Spans;
+				const int32 SpanBegin = FMath::Max(Begin - LineStarts[Line], Spans.IsEmpty() ? 0 : Spans.Last().End);
+				const int32 SpanEnd = FMath::Min(End - LineStarts[Line], Lines[Line].Len());
+				if (SpanEnd > SpanBegin)
 				{
-					RunInfo.Name = TEXT("SyntaxHighlight.STS.Keyword");
-					TextBlockStyle = SyntaxTextStyle.KeywordTextStyle;
+					Spans.Add({ SpanBegin, SpanEnd, Style });
 				}
+			}
+		}
+	}
 
-				break;
+	TArray<FTextLayout::FNewLineData> LinesToAdd;
+	LinesToAdd.Reserve(NumLines);
+	for (int32 Line = 0; Line < NumLines; ++Line)
+	{
+		FHighlightedLine& Highlighted = HighlightedLines[Line];
+		const int32 OldLine = GetOldLine(Line);
 
-			case ESupertalkTokenType::Name:
-				if (FSupertalkParser::IsReservedName(FName(Token.Content)))
+		if (Line < LexStart || Line >= LexEnd)
+		{
+			check(OldLine != INDEX_NONE);
+			Highlighted = MoveTemp(OldLines[OldLine]);
+		}
+		else
+		{
+			Highlighted.Text = FString(Lines[Line]);
+
+			// Fill the gaps between tokens so that the runs cover the whole line.
+			TArray<FStyledSpan> Spans;
+			Spans.Reserve(Highlighted.Spans.Num() + 1);
+			int32 Pos = 0;
+			for (const FStyledSpan& Span : Highlighted.Spans)
+			{
+				if (Span.Begin > Pos)
 				{
-					RunInfo.Name = TEXT("SyntaxHighlight.STS.Keyword");
-					TextBlockStyle = SyntaxTextStyle.KeywordTextStyle;
+					Spans.Add({ Pos, Span.Begin, ESyntaxStyle::Normal });
 				}
 
-				break;
-
-			case ESupertalkTokenType::Separator:
-			case ESupertalkTokenType::Assign:
-			case ESupertalkTokenType::ParallelStart:
-			case ESupertalkTokenType::ParallelEnd:
-			case ESupertalkTokenType::QueueStart:
-			case ESupertalkTokenType::QueueEnd:
-			case ESupertalkTokenType::StatementEnd:
-			case ESupertalkTokenType::GroupStart:
-			case ESupertalkTokenType::GroupEnd:
-			case ESupertalkTokenType::Equal:
-			case ESupertalkTokenType::NotEqual:
-			case ESupertalkTokenType::Not:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Operator");
-				TextBlockStyle = SyntaxTextStyle.OperatorTextStyle;
-				break;
+				Spans.Add(Span);
+				Pos = Span.End;
+			}
 
-			case ESupertalkTokenType::Asset:
-			case ESupertalkTokenType::LocalizationKey:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Value");
-				TextBlockStyle = SyntaxTextStyle.ValueTextStyle;
-				break;
+			if (Pos < Highlighted.Text.Len() || Spans.IsEmpty())
+			{
+				Spans.Add({ Pos, Highlighted.Text.Len(), ESyntaxStyle::Normal });
+			}
 
-			case ESupertalkTokenType::Text:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.String");
-				TextBlockStyle = SyntaxTextStyle.StringTextStyle;
-				break;
+			Highlighted.Spans = MoveTemp(Spans);
 
-			case ESupertalkTokenType::Command:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Command");
-				TextBlockStyle = SyntaxTextStyle.CommandTextStyle;
-				break;
+			if (OldLine != INDEX_NONE && OldLines[OldLine].Spans == Highlighted.Spans)
+			{
+				Highlighted.ModelString = MoveTemp(OldLines[OldLine].ModelString);
+				Highlighted.Runs = MoveTemp(OldLines[OldLine].Runs);
+			}
+		}
 
-			case ESupertalkTokenType::Section:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Section");
-				TextBlockStyle = SyntaxTextStyle.SectionTextStyle;
-				break;
+		if (!HasIntactRuns(Highlighted))
+		{
+			BuildRuns(Highlighted);
+		}
 
-			case ESupertalkTokenType::Jump:
-				RunInfo.Name = TEXT("SyntaxHighlight.STS.Jump");
-				TextBlockStyle = SyntaxTextStyle.JumpTextStyle;
-				break;
-			}
+		LinesToAdd.Emplace(Highlighted.ModelString.ToSharedRef(), Highlighted.Runs);
+	}
 
-			const FString& Line = Lines[LineIdx];
-			const FTextRange ModelRange(ModelString->Len(), ModelString->Len() + Line.Len());
-			ModelString->Append(*Line);
+	TargetTextLayout.AddLines(LinesToAdd);
 
-			TSharedRef<ISlateRun> Run = FSlateTextRun::Create(RunInfo, ModelString, TextBlockStyle, ModelRange);
-			Runs.Add(Run);
+	// Line highlights belong to the lines, so these go away with them on the next update.
+	for (int32 Line : DiagnosticLines)
+	{
+		if (HighlightedLines.IsValidIndex(Line))
+		{
+			TargetTextLayout.AddLineHighlight(FTextLineHighlight(Line, FTextRange(0, HighlightedLines[Line].Text.Len()), FSlateTextUnderlineLineHighlighter::DefaultZIndex, DiagnosticHighlighter));
 		}
 	}
+}
 
-	if (!ModelString->IsEmpty())
+FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::ESyntaxStyle FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::GetSyntaxStyle(ESupertalkTokenType Type, FStringView Content)
+{
+	switch (Type)
 	{
-		LinesToAdd.Emplace(MoveTemp(ModelString), MoveTemp(Runs));
+	case ESupertalkTokenType::Comment:
+		return ESyntaxStyle::Comment;
+
+	case ESupertalkTokenType::If:
+	case ESupertalkTokenType::Then:
+	case ESupertalkTokenType::Else:
+		return ESyntaxStyle::Keyword;
+
+	case ESupertalkTokenType::Directive:
+		return Content.StartsWith(TEXT("error"), ESearchCase::IgnoreCase) ? ESyntaxStyle::Error : ESyntaxStyle::Keyword;
+
+	case ESupertalkTokenType::Name:
+		return FSupertalkParser::IsReservedName(FName(Content)) ? ESyntaxStyle::Keyword : ESyntaxStyle::Normal;
+
+	case ESupertalkTokenType::Separator:
+	case ESupertalkTokenType::Assign:
+	case ESupertalkTokenType::ParallelStart:
+	case ESupertalkTokenType::ParallelEnd:
+	case ESupertalkTokenType::QueueStart:
+	case ESupertalkTokenType::QueueEnd:
+	case ESupertalkTokenType::StatementEnd:
+	case ESupertalkTokenType::GroupStart:
+	case ESupertalkTokenType::GroupEnd:
+	case ESupertalkTokenType::Equal:
+	case ESupertalkTokenType::NotEqual:
+	case ESupertalkTokenType::Not:
+		return ESyntaxStyle::Operator;
+
+	case ESupertalkTokenType::Asset:
+	case ESupertalkTokenType::LocalizationKey:
+		return ESyntaxStyle::Value;
+
+	case ESupertalkTokenType::Text:
+		return ESyntaxStyle::String;
+
+	case ESupertalkTokenType::Command:
+	case ESupertalkTokenType::FunctionCall:
+		return ESyntaxStyle::Command;
+
+	case ESupertalkTokenType::Section:
+		return ESyntaxStyle::Section;
+
+	case ESupertalkTokenType::Jump:
+		return ESyntaxStyle::Jump;
+
+	default:
+		return ESyntaxStyle::Normal;
 	}
+}
 
-	TargetTextLayout.AddLines(LinesToAdd);
+bool FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::HasIntactRuns(const FHighlightedLine& Line)
+{
+	// The text layout edits the strings and runs it was given in place (and can point runs at new strings when it splits
+	// a line), so they are only reused if nothing but the runs refers to the string and the ranges still match.
+	if (!Line.ModelString.IsValid()
+		|| Line.Runs.Num() != Line.Spans.Num()
+		|| Line.ModelString.GetSharedReferenceCount() != 1 + Line.Runs.Num()
+		|| !Line.ModelString->Equals(Line.Text, ESearchCase::CaseSensitive))
+	{
+		return false;
+	}
+
+	for (int32 Idx = 0; Idx < Line.Runs.Num(); ++Idx)
+	{
+		if (Line.Runs[Idx]->GetTextRange() != FTextRange(Line.Spans[Idx].Begin, Line.Spans[Idx].End))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller::BuildRuns(FHighlightedLine& Line) const
+{
+	Line.Runs.Reset();
+
+	// The old runs may still be pointing at the old string, give them a new one.
+	Line.ModelString = MakeShared<FString>(Line.Text);
+	const TSharedRef<FString> ModelString = Line.ModelString.ToSharedRef();
+
+	for (const FStyledSpan& Span : Line.Spans)
+	{
+		FRunInfo RunInfo;
+		const FTextBlockStyle* TextBlockStyle = &SyntaxTextStyle.NormalTextStyle;
+
+		switch (Span.Style)
+		{
+		case ESyntaxStyle::Normal:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Normal");
+			break;
+
+		case ESyntaxStyle::Comment:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Comment");
+			TextBlockStyle = &SyntaxTextStyle.CommentTextStyle;
+			break;
+
+		case ESyntaxStyle::Keyword:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Keyword");
+			TextBlockStyle = &SyntaxTextStyle.KeywordTextStyle;
+			break;
+
+		case ESyntaxStyle::Operator:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Operator");
+			TextBlockStyle = &SyntaxTextStyle.OperatorTextStyle;
+			break;
+
+		case ESyntaxStyle::Value:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Value");
+			TextBlockStyle = &SyntaxTextStyle.ValueTextStyle;
+			break;
+
+		case ESyntaxStyle::String:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.String");
+			TextBlockStyle = &SyntaxTextStyle.StringTextStyle;
+			break;
+
+		case ESyntaxStyle::Command:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Command");
+			TextBlockStyle = &SyntaxTextStyle.CommandTextStyle;
+			break;
+
+		case ESyntaxStyle::Section:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Section");
+			TextBlockStyle = &SyntaxTextStyle.SectionTextStyle;
+			break;
+
+		case ESyntaxStyle::Jump:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Jump");
+			TextBlockStyle = &SyntaxTextStyle.JumpTextStyle;
+			break;
+
+		case ESyntaxStyle::Error:
+			RunInfo.Name = TEXT("SyntaxHighlight.STS.Error");
+			TextBlockStyle = &SyntaxTextStyle.ErrorTextStyle;
+			break;
+		}
+
+		Line.Runs.Add(FSlateTextRun::Create(RunInfo, ModelString, *TextBlockStyle, FTextRange(Span.Begin, Span.End)));
+	}
 }
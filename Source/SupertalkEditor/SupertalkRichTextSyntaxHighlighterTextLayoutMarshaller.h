@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "Framework/Text/PlainTextLayoutMarshaller.h"
 
+enum class ESupertalkTokenType : uint8;
+
 class FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller : public FPlainTextLayoutMarshaller
 {
 public:
@@ -55,6 +57,9 @@ public:
 
     virtual bool RequiresLiveUpdate() const override;
 
+    // Underlines these lines (starting at 1) until they are replaced, used for errors found while the script is edited.
+    void SetDiagnosticLines(const TArray<int32>& InDiagnosticLines);
+
 protected:
     FSupertalkRichTextSyntaxHighlighterTextLayoutMarshaller(TSharedRef<class FSupertalkParser> InParser, const FSyntaxTextStyle& InSyntaxTextStyle);
 
@@ -62,4 +67,55 @@ protected:
 
     FSyntaxTextStyle SyntaxTextStyle;
     TSharedRef<class FSupertalkParser> Parser;
+
+private:
+    enum class ESyntaxStyle : uint8
+    {
+        Normal,
+        Comment,
+        Keyword,
+        Operator,
+        Value,
+        String,
+        Command,
+        Section,
+        Jump,
+        Error,
+    };
+
+    struct FStyledSpan
+    {
+        int32 Begin = 0;
+        int32 End = 0;
+        ESyntaxStyle Style = ESyntaxStyle::Normal;
+
+        bool operator==(const FStyledSpan& Other) const
+        {
+            return Begin == Other.Begin && End == Other.End && Style == Other.Style;
+        }
+    };
+
+    // One line of the script as it was last handed to the text layout. Spans cover the whole line, one run each.
+    struct FHighlightedLine
+    {
+        FString Text;
+        TArray<FStyledSpan> Spans;
+
+        // A token started right at the beginning of this line with nothing carried over from the line before, so lexing
+        // can restart from here.
+        bool bCanRestartLexing = false;
+
+        TSharedPtr<FString> ModelString;
+        TArray<TSharedRef<IRun>> Runs;
+    };
+
+    static ESyntaxStyle GetSyntaxStyle(ESupertalkTokenType Type, FStringView Content);
+    static bool HasIntactRuns(const FHighlightedLine& Line);
+    void BuildRuns(FHighlightedLine& Line) const;
+
+    // Kept between updates so that an edit only re-lexes the lines around it.
+    TArray<FHighlightedLine> HighlightedLines;
+
+    TSet<int32> DiagnosticLines;
+    TSharedRef<class FSlateTextUnderlineLineHighlighter> DiagnosticHighlighter;
 };
@@ -3,10 +3,12 @@
 #include "SupertalkScriptCompiler.h"
 
 #include "SupertalkParser.h"
+#include "Async/Async.h"
 #include "Supertalk/Supertalk.h"
 #include "Supertalk/SupertalkPlayer.h"
 
 FOnSupertalkScriptCompiled FSupertalkScriptCompiler::OnScriptCompiled;
+FOnSupertalkScriptCompiled FSupertalkScriptCompiler::OnScriptValidated;
 
 void FSupertalkScriptCompiler::Initialize()
 {
@@ -45,7 +47,7 @@ bool FSupertalkScriptCompiler::CompileScript(USupertalkScript* Script)
 
 	if (bResult)
 	{
-		UE_LOG(LogSupertalk, Log, TEXT("Successfully compiled script '%s' (stats: %d sections)"), *Script->GetName(), Script->Sections.Num());
+		UE_LOG(LogSupertalk, Log, TEXT("Successfully compiled script '%s' (stats: %d sections, %d instructions)"), *Script->GetName(), Script->Sections.Num(), Script->Program.Instructions.Num());
 		OnScriptCompiled.Broadcast(Script, true, CompilerOutput);
 	}
 	else
@@ -57,6 +59,20 @@ bool FSupertalkScriptCompiler::CompileScript(USupertalkScript* Script)
 	return bResult;
 }
 
+TFuture<FSupertalkScriptValidation> FSupertalkScriptCompiler::ValidateScriptAsync(FString Name, FString Source)
+{
+	return Async(EAsyncExecution::ThreadPool, [Name = MoveTemp(Name), Source = MoveTemp(Source)]()
+	{
+		FBufferedOutputDevice Buffer;
+
+		FSupertalkScriptValidation Validation;
+		Validation.bSuccess = FSupertalkParser::ValidateScript(Name, Source, &Buffer, &Validation.DiagnosticLines);
+		Buffer.GetContents(Validation.CompilerOutput);
+
+		return Validation;
+	});
+}
+
 void FSupertalkScriptCompiler::OnScriptPreSave(USupertalkScript* Script)
 {
 	check(Script);
@@ -3,10 +3,20 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 
 // OnScriptCompiled(Script, bSuccess, CompilerOutput)
 DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnSupertalkScriptCompiled, class USupertalkScript*, bool, const TArray<FBufferedLine>&);
 
+struct FSupertalkScriptValidation
+{
+	bool bSuccess = false;
+	TArray<FBufferedLine> CompilerOutput;
+
+	// The lines (starting at 1) that errors and warnings were reported on.
+	TArray<int32> DiagnosticLines;
+};
+
 class FSupertalkScriptCompiler
 {
 public:
@@ -15,8 +25,15 @@ public:
 
 	static bool CompileScript(class USupertalkScript* Script);
 
+	// Lexes and parses Source on a worker thread without creating anything, for diagnostics while a script is being edited.
+	// Assets are looked up in the asset registry's on-disk data, not loaded, so unsaved assets aren't found.
+	static TFuture<FSupertalkScriptValidation> ValidateScriptAsync(FString Name, FString Source);
+
 	static FOnSupertalkScriptCompiled OnScriptCompiled;
 
+	// Broadcast by the script editor with the results of ValidateScriptAsync, same arguments as OnScriptCompiled.
+	static FOnSupertalkScriptCompiled OnScriptValidated;
+
 private:
 	FSupertalkScriptCompiler() {}
 
@@ -30,6 +30,7 @@ static const FName SupertalkCompilerOutputTabId("SupertalkCompilerOutput");
 FSupertalkScriptEditorToolkit::~FSupertalkScriptEditorToolkit()
 {
 	FSupertalkScriptCompiler::OnScriptCompiled.RemoveAll(this);
+	FSupertalkScriptCompiler::OnScriptValidated.RemoveAll(this);
 
 	FReimportManager::Instance()->OnPreReimport().RemoveAll(this);
 	FReimportManager::Instance()->OnPostReimport().RemoveAll(this);
@@ -109,6 +110,7 @@ void FSupertalkScriptEditorToolkit::Initialize(USupertalkScript* InScriptAsset,
 	RegenerateMenusAndToolbars();
 
 	FSupertalkScriptCompiler::OnScriptCompiled.AddRaw(this, &FSupertalkScriptEditorToolkit::OnScriptCompiled);
+	FSupertalkScriptCompiler::OnScriptValidated.AddRaw(this, &FSupertalkScriptEditorToolkit::OnScriptCompiled);
 }
 
 FString FSupertalkScriptEditorToolkit::GetDocumentationLink() const
@@ -0,0 +1,422 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#include "SupertalkScriptOptimizer.h"
+#include "Supertalk/SupertalkExpression.h"
+#include "Supertalk/SupertalkPlayer.h"
+#include "Supertalk/SupertalkValue.h"
+
+namespace
+{
+	// True if Expression evaluates to the same thing no matter which player runs it or what its variables are set to.
+	bool IsConstantExpression(const USupertalkExpression* Expression)
+	{
+		if (const USupertalkExpression_Value* ValueExpression = Cast<USupertalkExpression_Value>(Expression))
+		{
+			const USupertalkValue* Value = ValueExpression->Value;
+			return !IsValid(Value) || Value->IsA<USupertalkBooleanValue>() || Value->IsA<USupertalkNumberValue>() || Value->IsA<USupertalkTextValue>();
+		}
+
+		if (const USupertalkExpression_Not* NotExpression = Cast<USupertalkExpression_Not>(Expression))
+		{
+			return IsValid(NotExpression->Value) && IsConstantExpression(NotExpression->Value);
+		}
+
+		if (const USupertalkExpression_Equality* EqualityExpression = Cast<USupertalkExpression_Equality>(Expression))
+		{
+			for (const USupertalkExpression* SubExpression : EqualityExpression->SubExpressions)
+			{
+				if (!IsValid(SubExpression) || !IsConstantExpression(SubExpression))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	FORCEINLINE bool IsLeafOperation(ESupertalkOperation Operation)
+	{
+		return Operation == ESupertalkOperation::Line || Operation == ESupertalkOperation::Assign || Operation == ESupertalkOperation::Call;
+	}
+
+	void ForEachJump(const FSupertalkAction& Action, TFunctionRef<void(USupertalkJumpParams*)> Func)
+	{
+		switch (Action.Operation)
+		{
+		default:
+			break;
+
+		case ESupertalkOperation::Jump:
+			Func(CastChecked<USupertalkJumpParams>(Action.Params));
+			break;
+
+		case ESupertalkOperation::Choice:
+			for (const FSupertalkChoice& Choice : CastChecked<USupertalkPlayChoiceParams>(Action.Params)->Choices)
+			{
+				ForEachJump(Choice.SubAction, Func);
+			}
+			break;
+
+		case ESupertalkOperation::Parallel:
+			for (const FSupertalkAction& SubAction : CastChecked<USupertalkParallelParams>(Action.Params)->SubActions)
+			{
+				ForEachJump(SubAction, Func);
+			}
+			break;
+
+		case ESupertalkOperation::Queue:
+			for (const FSupertalkAction& SubAction : CastChecked<USupertalkQueueParams>(Action.Params)->SubActions)
+			{
+				ForEachJump(SubAction, Func);
+			}
+			break;
+
+		case ESupertalkOperation::Conditional:
+			{
+				const USupertalkConditionalParams* Params = CastChecked<USupertalkConditionalParams>(Action.Params);
+				ForEachJump(Params->TrueAction, Func);
+				ForEachJump(Params->FalseAction, Func);
+			}
+			break;
+		}
+	}
+
+	struct FSupertalkOptimizer
+	{
+		FSupertalkOptimizer(USupertalkScript* InScript, FSupertalkOptimizationReport& InReport)
+			: Script(InScript), Report(InReport)
+		{
+		}
+
+		USupertalkScript* Script;
+		FSupertalkOptimizationReport& Report;
+
+		// Flattens queues, drops no-ops and folds constant conditionals, in a list of actions that run one after another.
+		void SimplifyActions(TArray<FSupertalkAction>& Actions)
+		{
+			TArray<FSupertalkAction> Result;
+			Result.Reserve(Actions.Num());
+			for (FSupertalkAction& Action : Actions)
+			{
+				SimplifyAction(Action);
+
+				if (Action.Operation == ESupertalkOperation::Noop)
+				{
+					++Report.NumNoopsRemoved;
+				}
+				else if (Action.Operation == ESupertalkOperation::Queue)
+				{
+					// Already simplified, so there are no queues left inside of it.
+					Result.Append(CastChecked<USupertalkQueueParams>(Action.Params)->SubActions);
+					++Report.NumQueuesFlattened;
+				}
+				else
+				{
+					Result.Add(Action);
+				}
+			}
+
+			Actions = MoveTemp(Result);
+		}
+
+		void SimplifyAction(FSupertalkAction& Action)
+		{
+			switch (Action.Operation)
+			{
+			default:
+				break;
+
+			case ESupertalkOperation::Choice:
+				// An empty choice is a no-op on purpose, it continues after the choice.
+				for (FSupertalkChoice& Choice : CastChecked<USupertalkPlayChoiceParams>(Action.Params)->Choices)
+				{
+					SimplifyAction(Choice.SubAction);
+				}
+				break;
+
+			case ESupertalkOperation::Parallel:
+				{
+					// Each action is a separate branch, so queues in here can't be flattened.
+					TArray<FSupertalkAction>& SubActions = CastChecked<USupertalkParallelParams>(Action.Params)->SubActions;
+					for (FSupertalkAction& SubAction : SubActions)
+					{
+						SimplifyAction(SubAction);
+					}
+
+					Report.NumNoopsRemoved += SubActions.RemoveAll([](const FSupertalkAction& SubAction) { return SubAction.Operation == ESupertalkOperation::Noop; });
+					if (SubActions.Num() == 0)
+					{
+						Action = FSupertalkAction();
+					}
+				}
+				break;
+
+			case ESupertalkOperation::Queue:
+				{
+					TArray<FSupertalkAction>& SubActions = CastChecked<USupertalkQueueParams>(Action.Params)->SubActions;
+					SimplifyActions(SubActions);
+					if (SubActions.Num() <= 1)
+					{
+						Action = SubActions.Num() == 1 ? FSupertalkAction(SubActions[0]) : FSupertalkAction();
+						++Report.NumQueuesFlattened;
+					}
+				}
+				break;
+
+			case ESupertalkOperation::Conditional:
+				{
+					USupertalkConditionalParams* Params = CastChecked<USupertalkConditionalParams>(Action.Params);
+					SimplifyAction(Params->TrueAction);
+					SimplifyAction(Params->FalseAction);
+
+					if (!IsValid(Params->Expression) || !IsConstantExpression(Params->Expression))
+					{
+						break;
+					}
+
+					// Same as USupertalkPlayer::HandleBranch. Values that aren't booleans skip both branches with a warning,
+					// which is left for the player to report.
+					const FSupertalkValue Value = Params->Expression->Evaluate(nullptr, INDEX_NONE);
+					if (Value.IsNone() || Value.IsBoolean())
+					{
+						const bool bConditionalValue = !Value.IsNone() && Value.GetBoolean();
+						Action = bConditionalValue ? FSupertalkAction(Params->TrueAction) : FSupertalkAction(Params->FalseAction);
+						++Report.NumConditionalsFolded;
+					}
+				}
+				break;
+			}
+		}
+
+		// Where a jump to Section actually ends up once sections that only jump somewhere else are skipped. An empty section
+		// ends the stack, same as a jump to None.
+		FName FindFinalTarget(FName Section) const
+		{
+			TSet<FName> Visited;
+			while (Section != NAME_None)
+			{
+				const FSupertalkSection* Target = Script->Sections.Find(Section);
+				if (Target == nullptr || Target->Actions.Num() > 1)
+				{
+					break;
+				}
+
+				if (Target->Actions.Num() == 0)
+				{
+					return NAME_None;
+				}
+
+				const FSupertalkAction& Action = Target->Actions[0];
+				bool bAlreadyVisited;
+				Visited.Add(Section, &bAlreadyVisited);
+				if (Action.Operation != ESupertalkOperation::Jump || bAlreadyVisited)
+				{
+					break;
+				}
+
+				Section = CastChecked<USupertalkJumpParams>(Action.Params)->JumpTarget;
+			}
+
+			return Section;
+		}
+
+		void ThreadJumps()
+		{
+			// Resolve every jump before changing any, so that the result doesn't depend on the order sections are visited in.
+			TMap<USupertalkJumpParams*, FName> NewTargets;
+			for (const TPair<FName, FSupertalkSection>& Section : Script->Sections)
+			{
+				for (const FSupertalkAction& Action : Section.Value.Actions)
+				{
+					ForEachJump(Action, [this, &NewTargets](USupertalkJumpParams* Params)
+					{
+						const FName Target = FindFinalTarget(Params->JumpTarget);
+						if (Target != Params->JumpTarget)
+						{
+							NewTargets.Add(Params, Target);
+						}
+					});
+				}
+			}
+
+			for (const TPair<USupertalkJumpParams*, FName>& NewTarget : NewTargets)
+			{
+				NewTarget.Key->JumpTarget = NewTarget.Value;
+			}
+
+			Report.NumJumpsThreaded += NewTargets.Num();
+		}
+
+		// Replaces jumps to sections that are a single line, assignment, or call with that action. Only jumps that the stack
+		// would end right after are replaced, since a jump never comes back.
+		void InlineSections(TArray<FSupertalkAction>& Actions, bool bIsTail)
+		{
+			for (int32 Idx = 0; Idx < Actions.Num(); ++Idx)
+			{
+				InlineSections(Actions[Idx], bIsTail && Idx == Actions.Num() - 1);
+			}
+		}
+
+		void InlineSections(FSupertalkAction& Action, bool bIsTail)
+		{
+			switch (Action.Operation)
+			{
+			default:
+				break;
+
+			case ESupertalkOperation::Jump:
+				if (bIsTail)
+				{
+					const FSupertalkSection* Target = Script->Sections.Find(CastChecked<USupertalkJumpParams>(Action.Params)->JumpTarget);
+					if (Target && Target->Actions.Num() == 1 && IsLeafOperation(Target->Actions[0].Operation))
+					{
+						Action = Target->Actions[0];
+						++Report.NumJumpsInlined;
+					}
+				}
+				break;
+
+			case ESupertalkOperation::Choice:
+				for (FSupertalkChoice& Choice : CastChecked<USupertalkPlayChoiceParams>(Action.Params)->Choices)
+				{
+					InlineSections(Choice.SubAction, bIsTail);
+				}
+				break;
+
+			case ESupertalkOperation::Parallel:
+				// Each branch ends its own stack.
+				for (FSupertalkAction& SubAction : CastChecked<USupertalkParallelParams>(Action.Params)->SubActions)
+				{
+					InlineSections(SubAction, true);
+				}
+				break;
+
+			case ESupertalkOperation::Queue:
+				InlineSections(CastChecked<USupertalkQueueParams>(Action.Params)->SubActions, bIsTail);
+				break;
+
+			case ESupertalkOperation::Conditional:
+				{
+					USupertalkConditionalParams* Params = CastChecked<USupertalkConditionalParams>(Action.Params);
+					InlineSections(Params->TrueAction, bIsTail);
+					InlineSections(Params->FalseAction, bIsTail);
+				}
+				break;
+			}
+		}
+
+		void RemoveUnreachableSections(const TSet<FName>& EntrySections)
+		{
+			TArray<FName> Pending = EntrySections.Array();
+			Pending.Add(Script->DefaultSection);
+
+			TSet<FName> Reachable;
+			while (Pending.Num() > 0)
+			{
+				const FName Name = Pending.Pop(false);
+				bool bAlreadyReachable;
+				Reachable.Add(Name, &bAlreadyReachable);
+
+				const FSupertalkSection* Section = Script->Sections.Find(Name);
+				if (bAlreadyReachable || Section == nullptr)
+				{
+					continue;
+				}
+
+				for (const FSupertalkAction& Action : Section->Actions)
+				{
+					ForEachJump(Action, [&Pending](USupertalkJumpParams* Params)
+					{
+						Pending.Add(Params->JumpTarget);
+					});
+				}
+			}
+
+			for (auto It = Script->Sections.CreateIterator(); It; ++It)
+			{
+				if (!Reachable.Contains(It.Key()))
+				{
+					Report.RemovedSections.Add(It.Key());
+					It.RemoveCurrent();
+				}
+			}
+
+			Report.RemovedSections.Sort(FNameLexicalLess());
+		}
+	};
+}
+
+bool FSupertalkOptimizationReport::IsEmpty() const
+{
+	return NumQueuesFlattened == 0 && NumNoopsRemoved == 0 && NumConditionalsFolded == 0 && NumJumpsThreaded == 0 && NumJumpsInlined == 0 && RemovedSections.Num() == 0;
+}
+
+FString FSupertalkOptimizationReport::ToString() const
+{
+	if (IsEmpty())
+	{
+		return TEXT("nothing to optimize");
+	}
+
+	TArray<FString> Parts;
+	if (NumQueuesFlattened > 0)
+	{
+		Parts.Add(FString::Printf(TEXT("flattened %d queues"), NumQueuesFlattened));
+	}
+
+	if (NumNoopsRemoved > 0)
+	{
+		Parts.Add(FString::Printf(TEXT("removed %d no-ops"), NumNoopsRemoved));
+	}
+
+	if (NumConditionalsFolded > 0)
+	{
+		Parts.Add(FString::Printf(TEXT("folded %d constant conditionals"), NumConditionalsFolded));
+	}
+
+	if (NumJumpsThreaded > 0)
+	{
+		Parts.Add(FString::Printf(TEXT("threaded %d jumps"), NumJumpsThreaded));
+	}
+
+	if (NumJumpsInlined > 0)
+	{
+		Parts.Add(FString::Printf(TEXT("inlined %d jumps to single-action sections"), NumJumpsInlined));
+	}
+
+	if (RemovedSections.Num() > 0)
+	{
+		const FString Names = FString::JoinBy(RemovedSections, TEXT(", "), [](FName Name) { return Name.ToString(); });
+		Parts.Add(FString::Printf(TEXT("removed %d unreachable sections (%s)"), RemovedSections.Num(), *Names));
+	}
+
+	return FString::Join(Parts, TEXT(", "));
+}
+
+FSupertalkOptimizationReport FSupertalkScriptOptimizer::Optimize(USupertalkScript* Script, const TSet<FName>& EntrySections)
+{
+	check(Script);
+
+	FSupertalkOptimizationReport Report;
+	FSupertalkOptimizer Optimizer(Script, Report);
+
+	for (TPair<FName, FSupertalkSection>& Section : Script->Sections)
+	{
+		Optimizer.SimplifyActions(Section.Value.Actions);
+	}
+
+	// Threading first means that inlining only ever sees the final target of a jump.
+	Optimizer.ThreadJumps();
+
+	for (TPair<FName, FSupertalkSection>& Section : Script->Sections)
+	{
+		Optimizer.InlineSections(Section.Value.Actions, true);
+	}
+
+	Optimizer.RemoveUnreachableSections(EntrySections);
+
+	return Report;
+}
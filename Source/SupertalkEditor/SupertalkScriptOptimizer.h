@@ -0,0 +1,34 @@
+﻿// Copyright (c) MissiveArts LLC
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USupertalkScript;
+
+// What FSupertalkScriptOptimizer removed from a script.
+struct FSupertalkOptimizationReport
+{
+	int32 NumQueuesFlattened = 0;
+	int32 NumNoopsRemoved = 0;
+	int32 NumConditionalsFolded = 0;
+	int32 NumJumpsThreaded = 0;
+	int32 NumJumpsInlined = 0;
+	TArray<FName> RemovedSections;
+
+	bool IsEmpty() const;
+	FString ToString() const;
+};
+
+// Simplifies a script's sections after they're parsed and before they're compiled into a program, so that running the
+// script executes fewer actions and the saved script has fewer objects in it. Behavior is unchanged as long as the script
+// is only started from its default section or from a section marked as an entry point (the `!entry` directive), any
+// other section that nothing jumps to is removed.
+class FSupertalkScriptOptimizer
+{
+public:
+	static FSupertalkOptimizationReport Optimize(USupertalkScript* Script, const TSet<FName>& EntrySections);
+
+private:
+	FSupertalkScriptOptimizer() {}
+};